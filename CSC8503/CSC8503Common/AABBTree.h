@@ -0,0 +1,527 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		/*
+		A dynamic bounding volume tree, in the style of the one used by Box2D.
+
+		Unlike the QuadTree, this tree is persistent - objects are inserted once,
+		and only have to be reinserted when they move outside of their 'fat' AABB,
+		which is their real AABB grown by a small margin. Nodes are kept in a
+		single array and recycled via a free list, so updating the tree doesn't
+		touch the heap once it has grown to size.
+		*/
+		/*
+		Rays are cast through the tree in packets, with each node's box tested
+		against every ray in the packet at once - the loop over the packet has
+		a fixed size and no branches, so the compiler can vectorise it. Each
+		ray's direction is stored inverted, and its max distance shrinks as
+		closer hits are found, pruning the rest of the tree for that ray.
+		*/
+		struct RayPacket {
+			static constexpr int Size = 8; //constexpr, so it can be passed by reference (to std::min, say) without a definition
+
+			float originX[Size];
+			float originY[Size];
+			float originZ[Size];
+			float inverseDirX[Size];
+			float inverseDirY[Size];
+			float inverseDirZ[Size];
+			float maxDistance[Size];
+
+			unsigned int activeRays = 0; //a bit per ray still being cast
+
+			void SetRay(int i, const Vector3& origin, const Vector3& direction, float distance) {
+				originX[i]		= origin.x;
+				originY[i]		= origin.y;
+				originZ[i]		= origin.z;
+				inverseDirX[i]	= Inverse(direction.x);
+				inverseDirY[i]	= Inverse(direction.y);
+				inverseDirZ[i]	= Inverse(direction.z);
+				maxDistance[i]	= distance;
+				activeRays |= 1u << i;
+			}
+
+		protected:
+			//Axis aligned rays get a huge inverse rather than an infinite one, so the slab test never sees 0 * infinity
+			static float Inverse(float f) {
+				const float smallest = 1e-20f;
+				return 1.0f / (std::abs(f) > smallest ? f : (f < 0.0f ? -smallest : smallest));
+			}
+		};
+
+		template<class T>
+		struct AABBTreeNode {
+			Vector3 min;	//fat bounds
+			Vector3 max;
+
+			T		object;
+
+			int		parent;	//also used as the 'next' link when in the free list
+			int		child1;
+			int		child2;
+			int		height;	//leaf = 0, free node = -1
+			int		lastSeen;
+			bool	moved;
+
+			bool IsLeaf() const {
+				return child1 == -1;
+			}
+		};
+
+		template<class T>
+		class AABBTree {
+		public:
+			static const int NullNode	= -1;
+			static const int StackSize	= 256;
+
+			AABBTree(float margin = 0.5f) {
+				fatMargin = margin;
+				Clear();
+			}
+			~AABBTree() {}
+
+			void Clear() {
+				nodes.clear();
+				root		= NullNode;
+				freeList	= NullNode;
+				leafCount	= 0;
+			}
+
+			int Insert(T object, const Vector3& pos, const Vector3& halfSize) {
+				int proxy = AllocateNode();
+				AABBTreeNode<T>& n = nodes[proxy];
+				n.min		= pos - halfSize - Vector3(fatMargin, fatMargin, fatMargin);
+				n.max		= pos + halfSize + Vector3(fatMargin, fatMargin, fatMargin);
+				n.object	= object;
+				n.height	= 0;
+				n.moved		= true;
+				InsertLeaf(proxy);
+				leafCount++;
+				return proxy;
+			}
+
+			void Remove(int proxy) {
+				RemoveLeaf(proxy);
+				FreeNode(proxy);
+				leafCount--;
+			}
+
+			/*
+			Returns true if the object has left its fat AABB, and so has been
+			reinserted into the tree - only these objects can have gained any
+			new overlapping pairs since the last update.
+			*/
+			bool Update(int proxy, const Vector3& pos, const Vector3& halfSize) {
+				Vector3 tightMin = pos - halfSize;
+				Vector3 tightMax = pos + halfSize;
+
+				AABBTreeNode<T>& n = nodes[proxy];
+				if (n.min.x <= tightMin.x && n.min.y <= tightMin.y && n.min.z <= tightMin.z &&
+					n.max.x >= tightMax.x && n.max.y >= tightMax.y && n.max.z >= tightMax.z) {
+					return false;
+				}
+				RemoveLeaf(proxy);
+
+				AABBTreeNode<T>& moved = nodes[proxy];
+				moved.min	= tightMin - Vector3(fatMargin, fatMargin, fatMargin);
+				moved.max	= tightMax + Vector3(fatMargin, fatMargin, fatMargin);
+				moved.moved = true;
+
+				InsertLeaf(proxy);
+				return true;
+			}
+
+			bool IsValidProxy(int proxy, const T& object) const {
+				return proxy >= 0 && proxy < (int)nodes.size() &&
+					nodes[proxy].height == 0 && nodes[proxy].object == object;
+			}
+
+			T& GetObject(int proxy) {
+				return nodes[proxy].object;
+			}
+
+			bool HasMoved(int proxy) const {
+				return nodes[proxy].moved;
+			}
+
+			void ClearMoved(int proxy) {
+				nodes[proxy].moved = false;
+			}
+
+			void SetLastSeen(int proxy, int frame) {
+				nodes[proxy].lastSeen = frame;
+			}
+
+			void GetFatAABB(int proxy, Vector3& outMin, Vector3& outMax) const {
+				outMin = nodes[proxy].min;
+				outMax = nodes[proxy].max;
+			}
+
+			bool TestOverlap(int proxyA, int proxyB) const {
+				return Overlaps(nodes[proxyA].min, nodes[proxyA].max, nodes[proxyB].min, nodes[proxyB].max);
+			}
+
+			int GetLeafCount() const {
+				return leafCount;
+			}
+
+			int GetHeight() const {
+				return root == NullNode ? 0 : nodes[root].height;
+			}
+
+			/*
+			Calls func(proxy) for every leaf whose fat AABB overlaps the given box
+			*/
+			template<class Func>
+			void Query(const Vector3& boxMin, const Vector3& boxMax, Func func) const {
+				if (root == NullNode) {
+					return;
+				}
+				int stack[StackSize];
+				int count = 0;
+				stack[count++] = root;
+
+				while (count > 0) {
+					int index = stack[--count];
+					const AABBTreeNode<T>& n = nodes[index];
+
+					if (!Overlaps(n.min, n.max, boxMin, boxMax)) {
+						continue;
+					}
+					if (n.IsLeaf()) {
+						func(index);
+					}
+					else {
+						stack[count++] = n.child1;
+						stack[count++] = n.child2;
+					}
+				}
+			}
+
+			/*
+			Calls func(proxy, rays) for every leaf whose fat AABB is hit by any
+			of the packet's active rays, with a bit set in rays for each of them.
+			The function can shrink the packet's max distances or deactivate
+			rays as it finds hits.
+			*/
+			template<class Func>
+			void RayCast(RayPacket& packet, Func func) const {
+				if (root == NullNode) {
+					return;
+				}
+				int stack[StackSize];
+				int count = 0;
+				stack[count++] = root;
+
+				while (count > 0 && packet.activeRays) {
+					int index = stack[--count];
+					const AABBTreeNode<T>& n = nodes[index];
+
+					unsigned int hits = RayPacketHits(packet, n.min, n.max);
+					if (!hits) {
+						continue;
+					}
+					if (n.IsLeaf()) {
+						func(index, hits);
+					}
+					else {
+						stack[count++] = n.child1;
+						stack[count++] = n.child2;
+					}
+				}
+			}
+
+			/*
+			Calls func(proxy) for every leaf that wasn't marked as seen during
+			the given frame - used to find objects that have left the world.
+			*/
+			template<class Func>
+			void OperateOnStaleProxies(int frame, Func func) {
+				for (int i = 0; i < (int)nodes.size(); ++i) {
+					if (nodes[i].height == 0 && nodes[i].lastSeen != frame) {
+						func(i);
+					}
+				}
+			}
+
+		protected:
+			static bool Overlaps(const Vector3& minA, const Vector3& maxA, const Vector3& minB, const Vector3& maxB) {
+				if (maxA.x < minB.x || minA.x > maxB.x ||
+					maxA.y < minB.y || minA.y > maxB.y ||
+					maxA.z < minB.z || minA.z > maxB.z) {
+					return false;
+				}
+				return true;
+			}
+
+			//The slab test, for every ray in the packet at once
+			static unsigned int RayPacketHits(const RayPacket& p, const Vector3& boxMin, const Vector3& boxMax) {
+				unsigned int hits = 0;
+				for (int i = 0; i < RayPacket::Size; ++i) {
+					float x1 = (boxMin.x - p.originX[i]) * p.inverseDirX[i];
+					float x2 = (boxMax.x - p.originX[i]) * p.inverseDirX[i];
+					float y1 = (boxMin.y - p.originY[i]) * p.inverseDirY[i];
+					float y2 = (boxMax.y - p.originY[i]) * p.inverseDirY[i];
+					float z1 = (boxMin.z - p.originZ[i]) * p.inverseDirZ[i];
+					float z2 = (boxMax.z - p.originZ[i]) * p.inverseDirZ[i];
+
+					float tMin = std::max(std::max(std::min(x1, x2), std::min(y1, y2)), std::max(std::min(z1, z2), 0.0f));
+					float tMax = std::min(std::min(std::max(x1, x2), std::max(y1, y2)), std::min(std::max(z1, z2), p.maxDistance[i]));
+
+					hits |= (tMin <= tMax ? 1u : 0u) << i;
+				}
+				return hits & p.activeRays;
+			}
+
+			static float SurfaceArea(const Vector3& min, const Vector3& max) {
+				Vector3 d = max - min;
+				return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+			}
+
+			static float CombinedArea(const AABBTreeNode<T>& a, const AABBTreeNode<T>& b) {
+				return SurfaceArea(
+					Vector3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+					Vector3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+			}
+
+			void FitToChildren(int index) {
+				AABBTreeNode<T>& n	= nodes[index];
+				const AABBTreeNode<T>& a = nodes[n.child1];
+				const AABBTreeNode<T>& b = nodes[n.child2];
+
+				n.min		= Vector3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+				n.max		= Vector3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+				n.height	= 1 + std::max(a.height, b.height);
+			}
+
+			int AllocateNode() {
+				if (freeList == NullNode) {
+					int oldSize = (int)nodes.size();
+					int newSize = oldSize == 0 ? 16 : oldSize * 2;
+					nodes.resize(newSize);
+					for (int i = oldSize; i < newSize; ++i) {
+						nodes[i].parent = (i + 1 < newSize) ? i + 1 : NullNode;
+						nodes[i].height = -1;
+					}
+					freeList = oldSize;
+				}
+				int index = freeList;
+				AABBTreeNode<T>& n = nodes[index];
+				freeList	= n.parent;
+				n.parent	= NullNode;
+				n.child1	= NullNode;
+				n.child2	= NullNode;
+				n.height	= 0;
+				n.lastSeen	= -1;
+				n.moved		= false;
+				n.object	= T();
+				return index;
+			}
+
+			void FreeNode(int index) {
+				nodes[index].parent = freeList;
+				nodes[index].height = -1;
+				nodes[index].object = T();
+				freeList = index;
+			}
+
+			void InsertLeaf(int leaf) {
+				if (root == NullNode) {
+					root = leaf;
+					nodes[root].parent = NullNode;
+					return;
+				}
+				//Find the cheapest sibling for this leaf, using the surface area heuristic
+				int index = root;
+				while (!nodes[index].IsLeaf()) {
+					const AABBTreeNode<T>& n = nodes[index];
+					int child1 = n.child1;
+					int child2 = n.child2;
+
+					float area			= SurfaceArea(n.min, n.max);
+					float combinedArea	= CombinedArea(n, nodes[leaf]);
+
+					float cost			= 2.0f * combinedArea;
+					float inheritCost	= 2.0f * (combinedArea - area);
+
+					float cost1 = CombinedArea(nodes[child1], nodes[leaf]) + inheritCost;
+					if (!nodes[child1].IsLeaf()) {
+						cost1 -= SurfaceArea(nodes[child1].min, nodes[child1].max);
+					}
+					float cost2 = CombinedArea(nodes[child2], nodes[leaf]) + inheritCost;
+					if (!nodes[child2].IsLeaf()) {
+						cost2 -= SurfaceArea(nodes[child2].min, nodes[child2].max);
+					}
+
+					if (cost < cost1 && cost < cost2) {
+						break;
+					}
+					index = cost1 < cost2 ? child1 : child2;
+				}
+				int sibling		= index;
+				int oldParent	= nodes[sibling].parent;
+				int newParent	= AllocateNode(); //may move the node array!
+
+				nodes[newParent].parent = oldParent;
+				nodes[newParent].child1 = sibling;
+				nodes[newParent].child2 = leaf;
+				nodes[sibling].parent	= newParent;
+				nodes[leaf].parent		= newParent;
+				FitToChildren(newParent);
+
+				if (oldParent != NullNode) {
+					if (nodes[oldParent].child1 == sibling) {
+						nodes[oldParent].child1 = newParent;
+					}
+					else {
+						nodes[oldParent].child2 = newParent;
+					}
+				}
+				else {
+					root = newParent;
+				}
+				RefitFrom(nodes[leaf].parent);
+			}
+
+			void RemoveLeaf(int leaf) {
+				if (leaf == root) {
+					root = NullNode;
+					return;
+				}
+				int parent		= nodes[leaf].parent;
+				int grandParent = nodes[parent].parent;
+				int sibling		= nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+				if (grandParent != NullNode) {
+					if (nodes[grandParent].child1 == parent) {
+						nodes[grandParent].child1 = sibling;
+					}
+					else {
+						nodes[grandParent].child2 = sibling;
+					}
+					nodes[sibling].parent = grandParent;
+					FreeNode(parent);
+					RefitFrom(grandParent);
+				}
+				else {
+					root = sibling;
+					nodes[sibling].parent = NullNode;
+					FreeNode(parent);
+				}
+				nodes[leaf].parent = NullNode;
+			}
+
+			void RefitFrom(int index) {
+				while (index != NullNode) {
+					index = Balance(index);
+					FitToChildren(index);
+					index = nodes[index].parent;
+				}
+			}
+
+			/*
+			Performs a left or right rotation if node A is imbalanced,
+			returning the index of the node that now sits where A was.
+			*/
+			int Balance(int iA) {
+				AABBTreeNode<T>& A = nodes[iA];
+				if (A.IsLeaf() || A.height < 2) {
+					return iA;
+				}
+				int iB = A.child1;
+				int iC = A.child2;
+				AABBTreeNode<T>& B = nodes[iB];
+				AABBTreeNode<T>& C = nodes[iC];
+
+				int balance = C.height - B.height;
+
+				if (balance > 1) { //Rotate C up
+					int iF = C.child1;
+					int iG = C.child2;
+					AABBTreeNode<T>& F = nodes[iF];
+					AABBTreeNode<T>& G = nodes[iG];
+
+					C.child1 = iA;
+					C.parent = A.parent;
+					A.parent = iC;
+
+					if (C.parent != NullNode) {
+						if (nodes[C.parent].child1 == iA) {
+							nodes[C.parent].child1 = iC;
+						}
+						else {
+							nodes[C.parent].child2 = iC;
+						}
+					}
+					else {
+						root = iC;
+					}
+
+					if (F.height > G.height) {
+						C.child2 = iF;
+						A.child2 = iG;
+						G.parent = iA;
+					}
+					else {
+						C.child2 = iG;
+						A.child2 = iF;
+						F.parent = iA;
+					}
+					FitToChildren(iA);
+					FitToChildren(iC);
+					return iC;
+				}
+				if (balance < -1) { //Rotate B up
+					int iD = B.child1;
+					int iE = B.child2;
+					AABBTreeNode<T>& D = nodes[iD];
+					AABBTreeNode<T>& E = nodes[iE];
+
+					B.child1 = iA;
+					B.parent = A.parent;
+					A.parent = iB;
+
+					if (B.parent != NullNode) {
+						if (nodes[B.parent].child1 == iA) {
+							nodes[B.parent].child1 = iB;
+						}
+						else {
+							nodes[B.parent].child2 = iB;
+						}
+					}
+					else {
+						root = iB;
+					}
+
+					if (D.height > E.height) {
+						B.child2 = iD;
+						A.child1 = iE;
+						E.parent = iA;
+					}
+					else {
+						B.child2 = iE;
+						A.child1 = iD;
+						D.parent = iA;
+					}
+					FitToChildren(iA);
+					FitToChildren(iB);
+					return iB;
+				}
+				return iA;
+			}
+
+			std::vector<AABBTreeNode<T>> nodes;
+
+			int		root;
+			int		freeList;
+			int		leafCount;
+			float	fatMargin;
+		};
+	}
+}
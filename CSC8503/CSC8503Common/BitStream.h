@@ -0,0 +1,135 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Packs values into a buffer using only as many bits as each one
+		needs. Bits build up in a 64 bit scratch word, and are copied out
+		4 bytes at a time, least significant byte first, so the buffer
+		reads back the same on any machine.
+		*/
+		class BitWriter {
+		public:
+			BitWriter() : buffer(nullptr), scratch(0), scratchBits(0) {}
+			BitWriter(std::vector<uint8_t>& buffer) : buffer(&buffer), scratch(0), scratchBits(0) {}
+			~BitWriter() {}
+
+			//Carries on writing from the end of another buffer
+			void SetBuffer(std::vector<uint8_t>& newBuffer) {
+				buffer		= &newBuffer;
+				scratch		= 0;
+				scratchBits	= 0;
+			}
+
+			//Writes the low 'bits' bits of value - anywhere from 0 to 32 of them
+			void Write(uint32_t value, int bits) {
+				if (bits <= 0) {
+					return;
+				}
+				uint64_t mask = (bits == 32) ? 0xFFFFFFFFull : ((1ull << bits) - 1);
+				scratch		|= ((uint64_t)value & mask) << scratchBits;
+				scratchBits	+= bits;
+				if (scratchBits >= 32) {
+					WriteWord((uint32_t)scratch);
+					scratch		>>= 32;
+					scratchBits	-= 32;
+				}
+			}
+
+			void WriteBool(bool value) {
+				Write(value ? 1 : 0, 1);
+			}
+
+			void WriteFloat(float value) {
+				uint32_t bits;
+				memcpy(&bits, &value, sizeof(float));
+				Write(bits, 32);
+			}
+
+			//Writes out anything left in the scratch word, padded up to a whole byte
+			void Flush() {
+				while (scratchBits > 0) {
+					buffer->push_back((uint8_t)scratch);
+					scratch		>>= 8;
+					scratchBits	= scratchBits > 8 ? scratchBits - 8 : 0;
+				}
+			}
+
+		protected:
+			void WriteWord(uint32_t word) {
+				size_t size = buffer->size();
+				buffer->resize(size + 4);
+				uint8_t* bytes = buffer->data() + size;
+				bytes[0] = (uint8_t)(word);
+				bytes[1] = (uint8_t)(word >> 8);
+				bytes[2] = (uint8_t)(word >> 16);
+				bytes[3] = (uint8_t)(word >> 24);
+			}
+
+			std::vector<uint8_t>*	buffer;
+			uint64_t				scratch;
+			int						scratchBits;
+		};
+
+		/*
+		Reads back what a BitWriter wrote, straight out of the memory it's
+		given - nothing is copied. Reading past the end gives zeroes, and
+		marks the reader as having overflowed, so a truncated or corrupt
+		buffer can be caught with one check at the end, rather than after
+		every read.
+		*/
+		class BitReader {
+		public:
+			BitReader(const uint8_t* data = nullptr, size_t size = 0)
+				: data(data), size(size), position(0), scratch(0), scratchBits(0), overflowed(false) {}
+			~BitReader() {}
+
+			uint32_t Read(int bits) {
+				if (bits <= 0) {
+					return 0;
+				}
+				while (scratchBits < bits) {
+					if (position >= size) {
+						overflowed	= true;
+						scratchBits	= bits; //carry on with zeroes
+						break;
+					}
+					scratch		|= (uint64_t)data[position++] << scratchBits;
+					scratchBits	+= 8;
+				}
+				uint64_t mask = (bits == 32) ? 0xFFFFFFFFull : ((1ull << bits) - 1);
+				uint32_t value = (uint32_t)(scratch & mask);
+				scratch		>>= bits;
+				scratchBits	-= bits;
+				return value;
+			}
+
+			bool ReadBool() {
+				return Read(1) != 0;
+			}
+
+			float ReadFloat() {
+				uint32_t bits = Read(32);
+				float value;
+				memcpy(&value, &bits, sizeof(float));
+				return value;
+			}
+
+			bool HasOverflowed() const {
+				return overflowed;
+			}
+
+		protected:
+			const uint8_t*	data;
+			size_t			size;
+			size_t			position;
+			uint64_t		scratch;
+			int				scratchBits;
+			bool			overflowed;
+		};
+	}
+}
@@ -3,12 +3,16 @@
 #include "AABBVolume.h"
 #include "OBBVolume.h"
 #include "SphereVolume.h"
+#include "CapsuleVolume.h"
+#include "MeshVolume.h"
 #include "../../Common/Vector2.h"
 #include "../../Common/Window.h"
 #include "../../Common/Maths.h"
 #include "Debug.h"
 
 #include <list>
+#include <cmath>
+#include <algorithm>
 
 using namespace NCL;
 
@@ -45,6 +49,7 @@ bool CollisionDetection::RayIntersection(const Ray& r,GameObject& object, RayCol
 		case VolumeType::OBB:		hasCollided = RayOBBIntersection(r, worldTransform, (const OBBVolume&)*volume	, collision); break;
 		case VolumeType::Sphere:	hasCollided = RaySphereIntersection(r, worldTransform, (const SphereVolume&)*volume	, collision); break;
 		case VolumeType::Capsule:	hasCollided = RayCapsuleIntersection(r, worldTransform, (const CapsuleVolume&)*volume, collision); break;
+		case VolumeType::Mesh:		hasCollided = RayMeshIntersection(r, worldTransform, (const MeshVolume&)*volume, collision); break;
 	}
 
 	return hasCollided;
@@ -118,6 +123,44 @@ bool CollisionDetection::RayOBBIntersection(const Ray&r, const Transform& worldT
 	return collided;
 }
 
+//A ray's swept this close to a mesh hull, and then counts as hitting it
+const float RAY_MESH_TARGET_DISTANCE	= 0.001f;
+//A cast that ran out of iterations further away than this from the hull is a near miss, not a hit
+const float RAY_MESH_HIT_DISTANCE		= 0.01f;
+
+/*
+Mesh hulls only know their furthest point in each direction, so rather
+than testing the ray against faces, a point is swept along it with the
+same conservative advancement the shape casts use. It only needs to go
+as far as the far side of the hull's bounding sphere.
+*/
+bool CollisionDetection::RayMeshIntersection(const Ray& r, const Transform& worldTransform, const MeshVolume& volume, RayCollision& collision) {
+	Vector3 toMesh	= worldTransform.GetPosition() - r.GetPosition();
+	float length	= Vector3::Dot(toMesh, r.GetDirection()) + volume.GetHalfDimensions().Length();
+	if (length <= 0.0f) {
+		return false; //the whole hull is behind the ray
+	}
+	SphereVolume point(0.0f);
+	Transform pointTransform;
+	pointTransform.SetPosition(r.GetPosition());
+
+	const CollisionVolume& hull = (const CollisionVolume&)volume;
+	Vector3 motion = r.GetDirection() * length;
+	float	toi;
+	Vector3 normal;
+	if (!ConvexCast((const CollisionVolume&)point, pointTransform, motion, hull, worldTransform, RAY_MESH_TARGET_DISTANCE, toi, normal)) {
+		return false;
+	}
+	pointTransform.SetPosition(r.GetPosition() + motion * toi);
+	float distance;
+	if (ConvexDistance((const CollisionVolume&)point, pointTransform, hull, worldTransform, distance, normal) && distance > RAY_MESH_HIT_DISTANCE) {
+		return false;
+	}
+	collision.rayDistance	= length * toi;
+	collision.collidedAt	= pointTransform.GetPosition();
+	return true;
+}
+
 bool CollisionDetection::RayCapsuleIntersection(const Ray& r, const Transform& worldTransform, const CapsuleVolume& volume, RayCollision& collision) {
 	Vector3 pointA = worldTransform.GetPosition() + (worldTransform.GetOrientation() * (Vector3(0, 1, 0) * (volume.GetHalfHeight() - volume.GetRadius())));
 	Vector3 pointB = worldTransform.GetPosition() - (worldTransform.GetOrientation() * (Vector3(0, 1, 0) * (volume.GetHalfHeight() - volume.GetRadius())));
@@ -375,6 +418,16 @@ bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, Collis
 		return OBBIntersection((OBBVolume&)*volA, transformA, (OBBVolume&)*volB, transformB, collisionInfo);
 	}
 
+	//aabb/obb
+	if (volA->type == VolumeType::AABB && volB->type == VolumeType::OBB) {
+		return AABBOBBIntersection((AABBVolume&)*volA, transformA, (OBBVolume&)*volB, transformB, collisionInfo);
+	}
+	if (volA->type == VolumeType::OBB && volB->type == VolumeType::AABB) {
+		collisionInfo.a = b;
+		collisionInfo.b = a;
+		return AABBOBBIntersection((AABBVolume&)*volB, transformB, (OBBVolume&)*volA, transformA, collisionInfo);
+	}
+
 	//obb/sphere
 	if (volA->type == VolumeType::OBB && volB->type == VolumeType::Sphere) {
 		return OBBSphereIntersection((OBBVolume&)*volA, transformA, (SphereVolume&)*volB, transformB, collisionInfo);
@@ -405,15 +458,10 @@ bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, Collis
 		return SphereCapsuleIntersection((CapsuleVolume&)*volB, transformB, (SphereVolume&)*volA, transformA, collisionInfo);
 	}
 
-	//capsule/aabb
-	/*if (volA->type == VolumeType::Capsule && volB->type == VolumeType::AABB) {
-		return AABBCapsuleIntersection((CapsuleVolume&)*volA, transformA, (AABBVolume&)*volB, transformB, collisionInfo);
+	//everything else - capsules against boxes and each other, and mesh hulls
+	if (IsConvex(*volA) && IsConvex(*volB)) {
+		return ConvexIntersection(*volA, transformA, *volB, transformB, collisionInfo);
 	}
-	if (volA->type == VolumeType::AABB && volB->type == VolumeType::Capsule) {
-		collisionInfo.a = b;
-		collisionInfo.b = a;
-		return AABBCapsuleIntersection((CapsuleVolume&)*volB, transformB, (AABBVolume&)*volA, transformA, collisionInfo);
-	}*/
 
 	return false;
 }
@@ -530,10 +578,358 @@ bool CollisionDetection::AABBSphereIntersection(const AABBVolume& volumeA, const
 	return false;
 }
 
+/*
+Boxes are tested using the separating axis theorem - if there's any axis
+the two boxes can be projected onto without their projections overlapping,
+they aren't colliding. For a pair of boxes, there's only 15 axes worth
+testing: the 3 face normals of each box (axes 0-2 for A, 3-5 for B), and
+the 9 cross products of an edge from each box (axis 6 + (3 * edgeA) + edgeB).
+
+If none of them separate the boxes, the axis they overlap least on is the
+collision normal. A face axis gives a whole face of contact points, by
+clipping the other box's face against it - an edge axis gives a single
+point, where the two edges pass closest to each other.
+*/
+const float SAT_RELATIVE_TOLERANCE	= 0.98f;	//another axis has to be this much better to be used instead...
+const float SAT_ABSOLUTE_TOLERANCE	= 0.001f;	//...so the normal doesn't flicker between two almost equal axes
+const float SAT_PARALLEL_EDGES		= 0.0001f;	//edge cross products shorter than this are ignored
+
+const int SAT_FACE_AXES_A	= 0;
+const int SAT_FACE_AXES_B	= 3;
+const int SAT_EDGE_AXES		= 6;
+const int SAT_AXIS_COUNT	= 15;
+
+const int MAX_CLIP_POINTS	= 8; //a box face clipped by another box face can have up to 8 corners
+
 bool CollisionDetection::OBBIntersection(
 	const OBBVolume& volumeA, const Transform& worldTransformA,
 	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
-	return false;
+	Box boxA = MakeBox(volumeA.GetHalfDimensions(), worldTransformA, true);
+	Box boxB = MakeBox(volumeB.GetHalfDimensions(), worldTransformB, true);
+	return BoxIntersection(boxA, boxB, collisionInfo);
+}
+
+//AABBs ignore their transform's orientation, so are just an OBB that never rotates
+bool CollisionDetection::AABBOBBIntersection(
+	const AABBVolume& volumeA, const Transform& worldTransformA,
+	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	Box boxA = MakeBox(volumeA.GetHalfDimensions(), worldTransformA, false);
+	Box boxB = MakeBox(volumeB.GetHalfDimensions(), worldTransformB, true);
+	return BoxIntersection(boxA, boxB, collisionInfo);
+}
+
+CollisionDetection::Box CollisionDetection::MakeBox(const Vector3& halfSizes, const Transform& worldTransform, bool useOrientation) {
+	Box box;
+	box.position	= worldTransform.GetPosition();
+	box.halfSizes	= halfSizes;
+	if (useOrientation) {
+		Matrix3 rotation = Matrix3(worldTransform.GetOrientation());
+		for (int i = 0; i < 3; ++i) {
+			box.axes[i] = rotation.GetColumn(i);
+		}
+	}
+	else {
+		box.axes[0] = Vector3(1, 0, 0);
+		box.axes[1] = Vector3(0, 1, 0);
+		box.axes[2] = Vector3(0, 0, 1);
+	}
+	return box;
+}
+
+/*
+Returns how far apart the boxes are along the given axis - a negative
+distance is how far they overlap by. The normal is the axis, pointing
+from A towards B.
+*/
+float CollisionDetection::BoxSeparation(const Box& boxA, const Box& boxB, int axis, Vector3& normal) {
+	if (axis < SAT_FACE_AXES_B) {
+		normal = boxA.axes[axis - SAT_FACE_AXES_A];
+	}
+	else if (axis < SAT_EDGE_AXES) {
+		normal = boxB.axes[axis - SAT_FACE_AXES_B];
+	}
+	else {
+		int edgeA = (axis - SAT_EDGE_AXES) / 3;
+		int edgeB = (axis - SAT_EDGE_AXES) % 3;
+		normal = Vector3::Cross(boxA.axes[edgeA], boxB.axes[edgeB]);
+
+		float length = normal.Length();
+		if (length < SAT_PARALLEL_EDGES) {
+			return -FLT_MAX; //parallel edges - the face axes will already have covered this
+		}
+		normal = normal / length;
+	}
+	Vector3 delta	= boxB.position - boxA.position;
+	float distance	= Vector3::Dot(delta, normal);
+	if (distance < 0.0f) {
+		normal		= -normal;
+		distance	= -distance;
+	}
+	float radiusA = 0.0f;
+	float radiusB = 0.0f;
+	for (int i = 0; i < 3; ++i) {
+		radiusA += boxA.halfSizes[i] * std::abs(Vector3::Dot(boxA.axes[i], normal));
+		radiusB += boxB.halfSizes[i] * std::abs(Vector3::Dot(boxB.axes[i], normal));
+	}
+	return distance - (radiusA + radiusB);
+}
+
+/*
+The axis that was found last time is tried first. If it separated the
+boxes then, it probably still does, and the other 14 axes can be skipped
+- most pairs the broadphase hands over aren't touching, so this is where
+most of the time is saved. If it was the collision normal last time, it
+stays the normal unless another axis is noticeably better, so that a box
+resting on another keeps the same contact face from frame to frame.
+*/
+bool CollisionDetection::BoxIntersection(const Box& boxA, const Box& boxB, CollisionInfo& collisionInfo) {
+	float	separations[SAT_AXIS_COUNT];
+	Vector3 normals[SAT_AXIS_COUNT];
+
+	int cachedAxis = collisionInfo.cachedAxis;
+	if (cachedAxis >= 0) {
+		separations[cachedAxis] = BoxSeparation(boxA, boxB, cachedAxis, normals[cachedAxis]);
+		if (separations[cachedAxis] > 0.0f) {
+			return false;
+		}
+	}
+	int bestFaceA	= -1;
+	int bestFaceB	= -1;
+	int bestEdge	= -1;
+
+	for (int axis = 0; axis < SAT_AXIS_COUNT; ++axis) {
+		if (axis != cachedAxis) {
+			separations[axis] = BoxSeparation(boxA, boxB, axis, normals[axis]);
+			if (separations[axis] > 0.0f) {
+				collisionInfo.cachedAxis = axis;
+				return false;
+			}
+		}
+		int& best = (axis < SAT_FACE_AXES_B) ? bestFaceA : ((axis < SAT_EDGE_AXES) ? bestFaceB : bestEdge);
+		if (best < 0 || separations[axis] > separations[best]) {
+			best = axis;
+		}
+	}
+	//Faces are preferred over edges, and A's faces over B's, unless the other is clearly better
+	int candidates[4] = { cachedAxis, bestFaceA, bestFaceB, bestEdge };
+	int bestAxis = -1;
+	for (int axis : candidates) {
+		if (axis < 0 || separations[axis] == -FLT_MAX) {
+			continue;
+		}
+		if (bestAxis < 0 || separations[axis] > (separations[bestAxis] * SAT_RELATIVE_TOLERANCE) + SAT_ABSOLUTE_TOLERANCE) {
+			bestAxis = axis;
+		}
+	}
+	collisionInfo.cachedAxis = bestAxis;
+
+	Vector3 normal		= normals[bestAxis];
+	float penetration	= -separations[bestAxis];
+
+	if (bestAxis < SAT_FACE_AXES_B) {
+		BoxFaceContacts(boxA, boxB, bestAxis - SAT_FACE_AXES_A, normal, true, collisionInfo);
+	}
+	else if (bestAxis < SAT_EDGE_AXES) {
+		BoxFaceContacts(boxB, boxA, bestAxis - SAT_FACE_AXES_B, -normal, false, collisionInfo);
+	}
+	else {
+		int edgeA = (bestAxis - SAT_EDGE_AXES) / 3;
+		int edgeB = (bestAxis - SAT_EDGE_AXES) % 3;
+		BoxEdgeContact(boxA, boxB, edgeA, edgeB, normal, penetration, collisionInfo);
+	}
+	if (collisionInfo.pointCount == 0) { //only possible through rounding, but there must be a contact somewhere
+		collisionInfo.AddContactPoint(Vector3(), Vector3(), normal, penetration);
+	}
+	return true;
+}
+
+/*
+Clips a convex polygon against a plane, keeping the part behind it
+(where Dot(point, planeNormal) <= planeDistance). Returns the number of
+points in the clipped polygon.
+*/
+int CollisionDetection::ClipPolygon(const Vector3* in, int inCount, const Vector3& planeNormal, float planeDistance, Vector3* out) {
+	int outCount = 0;
+	if (inCount == 0) {
+		return 0;
+	}
+	Vector3 start		= in[inCount - 1];
+	float startDistance = Vector3::Dot(start, planeNormal) - planeDistance;
+
+	for (int i = 0; i < inCount; ++i) {
+		Vector3 end			= in[i];
+		float endDistance	= Vector3::Dot(end, planeNormal) - planeDistance;
+
+		if ((startDistance <= 0.0f) != (endDistance <= 0.0f) && outCount < MAX_CLIP_POINTS) {
+			float t = startDistance / (startDistance - endDistance);
+			out[outCount++] = start + ((end - start) * t);
+		}
+		if (endDistance <= 0.0f && outCount < MAX_CLIP_POINTS) {
+			out[outCount++] = end;
+		}
+		start			= end;
+		startDistance	= endDistance;
+	}
+	return outCount;
+}
+
+/*
+The reference box is the one whose face the normal came from, and the
+incident box is the other one. The face of the incident box that points
+most against the normal is clipped against the sides of the reference
+face, and whatever's left underneath the reference face is in contact.
+If that leaves more than 4 points, we keep the deepest one, and the 3
+that together with it cover the largest area.
+*/
+void CollisionDetection::BoxFaceContacts(const Box& reference, const Box& incident, int referenceAxis,
+	const Vector3& normal, bool referenceIsA, CollisionInfo& collisionInfo) {
+	int incidentAxis	= 0;
+	float mostOpposed	= 0.0f;
+	for (int i = 0; i < 3; ++i) {
+		float d = Vector3::Dot(incident.axes[i], normal);
+		if (std::abs(d) > std::abs(mostOpposed)) {
+			mostOpposed		= d;
+			incidentAxis	= i;
+		}
+	}
+	Vector3 incidentNormal = incident.axes[incidentAxis] * (mostOpposed > 0.0f ? -1.0f : 1.0f);
+	Vector3 incidentCentre = incident.position + (incidentNormal * incident.halfSizes[incidentAxis]);
+	Vector3 incidentU = incident.axes[(incidentAxis + 1) % 3] * incident.halfSizes[(incidentAxis + 1) % 3];
+	Vector3 incidentV = incident.axes[(incidentAxis + 2) % 3] * incident.halfSizes[(incidentAxis + 2) % 3];
+
+	Vector3 clipA[MAX_CLIP_POINTS] = {
+		incidentCentre + incidentU + incidentV,
+		incidentCentre - incidentU + incidentV,
+		incidentCentre - incidentU - incidentV,
+		incidentCentre + incidentU - incidentV
+	};
+	Vector3 clipB[MAX_CLIP_POINTS];
+	int count = 4;
+
+	for (int i = 1; i < 3; ++i) {
+		int sideAxis		= (referenceAxis + i) % 3;
+		Vector3 side		= reference.axes[sideAxis];
+		float centre		= Vector3::Dot(reference.position, side);
+		float halfSize		= reference.halfSizes[sideAxis];
+
+		count = ClipPolygon(clipA, count, side, centre + halfSize, clipB);
+		count = ClipPolygon(clipB, count, -side, -centre + halfSize, clipA);
+	}
+
+	float faceDistance = Vector3::Dot(reference.position, normal) + reference.halfSizes[referenceAxis];
+
+	Vector3 points[MAX_CLIP_POINTS];
+	float	depths[MAX_CLIP_POINTS];
+	int		pointCount = 0;
+	for (int i = 0; i < count; ++i) {
+		float depth = faceDistance - Vector3::Dot(clipA[i], normal);
+		if (depth >= 0.0f) {
+			points[pointCount] = clipA[i];
+			depths[pointCount] = depth;
+			pointCount++;
+		}
+	}
+
+	int chosen[MAX_CONTACT_POINTS];
+	int chosenCount = 0;
+	if (pointCount <= MAX_CONTACT_POINTS) {
+		for (int i = 0; i < pointCount; ++i) {
+			chosen[chosenCount++] = i;
+		}
+	}
+	else {
+		int deepest = 0;
+		for (int i = 1; i < pointCount; ++i) {
+			if (depths[i] > depths[deepest]) {
+				deepest = i;
+			}
+		}
+		int furthest = deepest;
+		float furthestDistance = -1.0f;
+		for (int i = 0; i < pointCount; ++i) {
+			float d = (points[i] - points[deepest]).LengthSquared();
+			if (d > furthestDistance) {
+				furthestDistance	= d;
+				furthest			= i;
+			}
+		}
+		//the largest triangles on either side of the line between those two
+		int left	= -1;
+		int right	= -1;
+		float leftArea	= 0.0f;
+		float rightArea = 0.0f;
+		for (int i = 0; i < pointCount; ++i) {
+			float area = Vector3::Dot(Vector3::Cross(points[furthest] - points[deepest], points[i] - points[deepest]), normal);
+			if (area > leftArea) {
+				leftArea	= area;
+				left		= i;
+			}
+			if (area < rightArea) {
+				rightArea	= area;
+				right		= i;
+			}
+		}
+		chosen[chosenCount++] = deepest;
+		if (furthest != deepest) {
+			chosen[chosenCount++] = furthest;
+		}
+		if (left >= 0) {
+			chosen[chosenCount++] = left;
+		}
+		if (right >= 0) {
+			chosen[chosenCount++] = right;
+		}
+	}
+
+	for (int i = 0; i < chosenCount; ++i) {
+		Vector3 incidentPoint	= points[chosen[i]];
+		float	depth			= depths[chosen[i]];
+		Vector3 referencePoint	= incidentPoint + (normal * depth); //pushed back up onto the reference face
+
+		if (referenceIsA) {
+			collisionInfo.AddContactPoint(referencePoint - reference.position, incidentPoint - incident.position, normal, depth);
+		}
+		else {
+			collisionInfo.AddContactPoint(incidentPoint - incident.position, referencePoint - reference.position, -normal, depth);
+		}
+	}
+}
+
+/*
+For an edge / edge collision, we find the edge of each box that's furthest
+along the normal towards the other box, and put the contact where those
+two edges pass closest to each other.
+*/
+void CollisionDetection::BoxEdgeContact(const Box& boxA, const Box& boxB, int edgeA, int edgeB,
+	const Vector3& normal, float penetration, CollisionInfo& collisionInfo) {
+	Vector3 pointA = boxA.position;
+	Vector3 pointB = boxB.position;
+	for (int i = 0; i < 3; ++i) {
+		if (i != edgeA) {
+			float side = Vector3::Dot(boxA.axes[i], normal) > 0.0f ? 1.0f : -1.0f;
+			pointA += boxA.axes[i] * (boxA.halfSizes[i] * side);
+		}
+		if (i != edgeB) {
+			float side = Vector3::Dot(boxB.axes[i], normal) > 0.0f ? -1.0f : 1.0f;
+			pointB += boxB.axes[i] * (boxB.halfSizes[i] * side);
+		}
+	}
+	Vector3 dirA = boxA.axes[edgeA];
+	Vector3 dirB = boxB.axes[edgeB];
+
+	Vector3 offset	= pointA - pointB;
+	float b			= Vector3::Dot(dirA, dirB);
+	float c			= Vector3::Dot(dirA, offset);
+	float f			= Vector3::Dot(dirB, offset);
+	float denom		= 1.0f - (b * b); //can't be 0, as parallel edges are never picked
+
+	float s = Maths::Clamp((b * f - c) / denom, -boxA.halfSizes[edgeA], boxA.halfSizes[edgeA]);
+	float t = Maths::Clamp((b * s) + f, -boxB.halfSizes[edgeB], boxB.halfSizes[edgeB]);
+
+	Vector3 closestA = pointA + (dirA * s);
+	Vector3 closestB = pointB + (dirB * t);
+
+	collisionInfo.AddContactPoint(closestA - boxA.position, closestB - boxB.position, normal, penetration);
 }
 
 bool CollisionDetection::OBBSphereIntersection(const OBBVolume& volumeA, const Transform& worldTransformA, const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
@@ -579,7 +975,592 @@ bool CollisionDetection::SphereCapsuleIntersection(
 	Transform t;
 	t.SetPosition(spherePos);
 	t.SetScale(Vector3(volumeA.GetRadius(), volumeA.GetRadius(), volumeA.GetRadius()));
-	collisionInfo.point.localA += spherePos - worldTransformA.GetPosition();
 
-	return SphereIntersection(s, t, volumeB, worldTransformB, collisionInfo);
-}
\ No newline at end of file
+	if (!SphereIntersection(s, t, volumeB, worldTransformB, collisionInfo)) {
+		return false;
+	}
+	//the contact was found relative to the sphere along the capsule, so move it back to the capsule's centre
+	collisionInfo.points[collisionInfo.pointCount - 1].localA += spherePos - worldTransformA.GetPosition();
+	return true;
+}
+/*
+GJK finds the closest point to the origin on the Minkowski difference of
+two shapes (every point of A minus every point of B) - if the origin is
+inside it, the shapes overlap, otherwise how far away it is is the gap
+between them. It never builds the difference, it just walks a simplex of
+up to 4 of its points towards the origin, asking each shape for its
+furthest point in the direction the origin is in.
+*/
+const int	GJK_MAX_ITERATIONS	= 32;
+const float	GJK_TOLERANCE		= 0.0001f;		//stop once a new support point gets us closer by less than this fraction
+const float	GJK_TOUCHING		= 0.0001f;		//cores closer than this are treated as overlapping, as there's no normal between them
+
+const int	EPA_MAX_ITERATIONS	= 32;
+const int	EPA_MAX_POINTS		= 64;
+const int	EPA_MAX_FACES		= 128;
+const float	EPA_TOLERANCE		= 0.0001f;		//stop once the polytope can't be pushed out further than this
+
+const int	CAST_MAX_ITERATIONS	= 20;			//a cast that hasn't converged by now is treated as having hit
+
+bool CollisionDetection::IsConvex(const CollisionVolume& volume) {
+	switch (volume.type) {
+		case VolumeType::AABB:
+		case VolumeType::OBB:
+		case VolumeType::Sphere:
+		case VolumeType::Capsule:
+		case VolumeType::Mesh:
+			return true;
+		default:
+			return false;
+	}
+}
+
+CollisionDetection::ConvexShape CollisionDetection::MakeConvexShape(const CollisionVolume& volume, const Transform& worldTransform) {
+	ConvexShape shape;
+	shape.volume	= &volume;
+	shape.transform	= &worldTransform;
+	shape.radius	= 0.0f;
+	if (volume.type == VolumeType::Sphere) {
+		shape.radius = ((const SphereVolume&)volume).GetRadius();
+	}
+	else if (volume.type == VolumeType::Capsule) {
+		shape.radius = ((const CapsuleVolume&)volume).GetRadius();
+	}
+	return shape;
+}
+
+Vector3 CollisionDetection::ConvexSupport(const ConvexShape& shape, const Vector3& direction, bool addRadius) {
+	Vector3 position	= shape.transform->GetPosition();
+	Vector3 support		= position;
+
+	switch (shape.volume->type) {
+		case VolumeType::AABB: {
+			Vector3 halfSizes = ((const AABBVolume&)*shape.volume).GetHalfDimensions();
+			for (int i = 0; i < 3; ++i) {
+				support[i] += direction[i] < 0.0f ? -halfSizes[i] : halfSizes[i];
+			}
+		}break;
+		case VolumeType::OBB: {
+			Quaternion orientation	= shape.transform->GetOrientation();
+			Vector3 localDirection	= orientation.Conjugate() * direction;
+			Vector3 halfSizes		= ((const OBBVolume&)*shape.volume).GetHalfDimensions();
+			Vector3 localSupport;
+			for (int i = 0; i < 3; ++i) {
+				localSupport[i] = localDirection[i] < 0.0f ? -halfSizes[i] : halfSizes[i];
+			}
+			support += orientation * localSupport;
+		}break;
+		case VolumeType::Capsule: {
+			const CapsuleVolume& capsule = (const CapsuleVolume&)*shape.volume;
+			Vector3 axis = shape.transform->GetOrientation() * Vector3(0, capsule.GetHalfHeight() - capsule.GetRadius(), 0);
+			support += Vector3::Dot(axis, direction) < 0.0f ? -axis : axis;
+		}break;
+		case VolumeType::Mesh: {
+			Quaternion orientation	= shape.transform->GetOrientation();
+			Vector3 localDirection	= orientation.Conjugate() * direction;
+			support += orientation * ((const MeshVolume&)*shape.volume).GetSupportPoint(localDirection);
+		}break;
+		default: break; //spheres are just their centre
+	}
+	if (addRadius && shape.radius > 0.0f) {
+		float length = direction.Length();
+		if (length > 0.0f) {
+			support += direction * (shape.radius / length);
+		}
+	}
+	return support;
+}
+
+CollisionDetection::SupportPoint CollisionDetection::MinkowskiSupport(const ConvexShape& shapeA, const ConvexShape& shapeB, const Vector3& direction, bool addRadius) {
+	SupportPoint p;
+	p.onA	= ConvexSupport(shapeA, direction, addRadius);
+	p.onB	= ConvexSupport(shapeB, -direction, addRadius);
+	p.point = p.onA - p.onB;
+	return p;
+}
+
+/*
+The closest point on a triangle to the origin, as the indices of the
+triangle's corners that make up the closest feature (a corner, an edge, or
+the whole face), and how much of each corner is in the closest point.
+*/
+int CollisionDetection::ClosestTrianglePoint(const Vector3& a, const Vector3& b, const Vector3& c, int* indices, float* weights) {
+	Vector3 ab = b - a;
+	Vector3 ac = c - a;
+
+	float d1 = Vector3::Dot(ab, -a);
+	float d2 = Vector3::Dot(ac, -a);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		indices[0] = 0; weights[0] = 1.0f;
+		return 1;
+	}
+	float d3 = Vector3::Dot(ab, -b);
+	float d4 = Vector3::Dot(ac, -b);
+	if (d3 >= 0.0f && d4 <= d3) {
+		indices[0] = 1; weights[0] = 1.0f;
+		return 1;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		float v = d1 / (d1 - d3);
+		indices[0] = 0; weights[0] = 1.0f - v;
+		indices[1] = 1; weights[1] = v;
+		return 2;
+	}
+	float d5 = Vector3::Dot(ab, -c);
+	float d6 = Vector3::Dot(ac, -c);
+	if (d6 >= 0.0f && d5 <= d6) {
+		indices[0] = 2; weights[0] = 1.0f;
+		return 1;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		float w = d2 / (d2 - d6);
+		indices[0] = 0; weights[0] = 1.0f - w;
+		indices[1] = 2; weights[1] = w;
+		return 2;
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		indices[0] = 1; weights[0] = 1.0f - w;
+		indices[1] = 2; weights[1] = w;
+		return 2;
+	}
+	float denom = 1.0f / (va + vb + vc);
+	float v = vb * denom;
+	float w = vc * denom;
+	indices[0] = 0; weights[0] = 1.0f - v - w;
+	indices[1] = 1; weights[1] = v;
+	indices[2] = 2; weights[2] = w;
+	return 3;
+}
+
+/*
+Finds the closest point on the simplex to the origin, and throws away
+any of its points that didn't contribute to it, so the next support point
+has room. A tetrahedron with the origin inside it is kept whole, as
+that means the shapes overlap.
+*/
+Vector3 CollisionDetection::ClosestSimplexPoint(SupportPoint* simplex, int& count, float* weights) {
+	int		indices[3];
+	int		featureCount = 0;
+
+	if (count == 1) {
+		weights[0] = 1.0f;
+		return simplex[0].point;
+	}
+	if (count == 2) {
+		Vector3 a	= simplex[0].point;
+		Vector3 ab	= simplex[1].point - a;
+		float t = Vector3::Dot(-a, ab) / std::max(ab.LengthSquared(), FLT_MIN);
+		if (t <= 0.0f) {
+			count		= 1;
+			weights[0]	= 1.0f;
+			return a;
+		}
+		if (t >= 1.0f) {
+			simplex[0]	= simplex[1];
+			count		= 1;
+			weights[0]	= 1.0f;
+			return simplex[0].point;
+		}
+		weights[0] = 1.0f - t;
+		weights[1] = t;
+		return a + ab * t;
+	}
+	if (count == 3) {
+		featureCount = ClosestTrianglePoint(simplex[0].point, simplex[1].point, simplex[2].point, indices, weights);
+	}
+	else {
+		//which of the tetrahedron's faces is the origin on the outside of?
+		const int faces[4][4] = { {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 3, 1}, {1, 2, 3, 0} };
+		float bestDistance = FLT_MAX;
+		for (int f = 0; f < 4; ++f) {
+			const Vector3& a = simplex[faces[f][0]].point;
+			const Vector3& b = simplex[faces[f][1]].point;
+			const Vector3& c = simplex[faces[f][2]].point;
+			const Vector3& d = simplex[faces[f][3]].point;
+
+			Vector3 normal		= Vector3::Cross(b - a, c - a);
+			float originSide	= Vector3::Dot(normal, -a);
+			float otherSide		= Vector3::Dot(normal, d - a);
+			if (originSide * otherSide > 0.0f) {
+				continue; //a flat tetrahedron has no inside, so every face gets tested
+			}
+			int		faceIndices[3];
+			float	faceWeights[3];
+			int faceCount = ClosestTrianglePoint(a, b, c, faceIndices, faceWeights);
+			Vector3 closest;
+			for (int i = 0; i < faceCount; ++i) {
+				closest += simplex[faces[f][faceIndices[i]]].point * faceWeights[i];
+			}
+			float distance = closest.LengthSquared();
+			if (distance < bestDistance) {
+				bestDistance = distance;
+				featureCount = faceCount;
+				for (int i = 0; i < faceCount; ++i) {
+					indices[i] = faces[f][faceIndices[i]];
+					weights[i] = faceWeights[i];
+				}
+			}
+		}
+		if (featureCount == 0) {
+			for (int i = 0; i < 4; ++i) {
+				weights[i] = 0.25f;
+			}
+			return Vector3();
+		}
+	}
+	SupportPoint feature[3];
+	Vector3 closest;
+	for (int i = 0; i < featureCount; ++i) {
+		feature[i] = simplex[indices[i]];
+		closest += feature[i].point * weights[i];
+	}
+	for (int i = 0; i < featureCount; ++i) {
+		simplex[i] = feature[i];
+	}
+	count = featureCount;
+	return closest;
+}
+
+/*
+Returns true if the shapes overlap, leaving the simplex GJK ended up with
+for EPA to start from - otherwise, fills in the closest points between them.
+*/
+bool CollisionDetection::GJK(const ConvexShape& shapeA, const ConvexShape& shapeB, bool addRadius,
+	SupportPoint* simplex, int& count, Vector3& closestA, Vector3& closestB) {
+	float	weights[4];
+	Vector3 direction = shapeA.transform->GetPosition() - shapeB.transform->GetPosition();
+	if (direction.LengthSquared() < GJK_TOUCHING * GJK_TOUCHING) {
+		direction = Vector3(1, 0, 0);
+	}
+	simplex[0]	= MinkowskiSupport(shapeA, shapeB, -direction, addRadius);
+	count		= 1;
+	weights[0]	= 1.0f;
+	Vector3 closest = simplex[0].point;
+
+	for (int i = 0; i < GJK_MAX_ITERATIONS; ++i) {
+		float distance = closest.LengthSquared();
+		if (distance < GJK_TOUCHING * GJK_TOUCHING) {
+			return true;
+		}
+		SupportPoint p = MinkowskiSupport(shapeA, shapeB, -closest, addRadius);
+		//can't get any closer to the origin than we already are
+		if (distance - Vector3::Dot(closest, p.point) <= distance * GJK_TOLERANCE) {
+			break;
+		}
+		SupportPoint	lastSimplex[4];
+		float			lastWeights[4];
+		int				lastCount = count;
+		std::copy(simplex, simplex + count, lastSimplex);
+		std::copy(weights, weights + count, lastWeights);
+
+		simplex[count++] = p;
+		Vector3 next = ClosestSimplexPoint(simplex, count, weights);
+		if (next.LengthSquared() >= distance) {
+			//numerical trouble, so the last simplex is as close as it's going to get
+			count = lastCount;
+			std::copy(lastSimplex, lastSimplex + count, simplex);
+			std::copy(lastWeights, lastWeights + count, weights);
+			break;
+		}
+		closest = next;
+		if (count == 4) {
+			return true;
+		}
+	}
+	closestA = Vector3();
+	closestB = Vector3();
+	for (int i = 0; i < count; ++i) {
+		closestA += simplex[i].onA * weights[i];
+		closestB += simplex[i].onB * weights[i];
+	}
+	return false;
+}
+
+/*
+EPA starts from a tetrahedron inside the Minkowski difference that holds the
+origin, and keeps pushing out its face closest to the origin to the
+furthest point in that direction, until it can't be pushed out any more.
+That face is then on the surface of the difference - how far it is from
+the origin is how deep the shapes are inside each other, and its normal
+is the direction to push them apart in.
+*/
+bool CollisionDetection::EPA(const ConvexShape& shapeA, const ConvexShape& shapeB,
+	SupportPoint* simplex, int count, CollisionInfo& collisionInfo) {
+	struct Face {
+		int		v[3];
+		Vector3	normal;
+		float	distance;
+	};
+	SupportPoint	points[EPA_MAX_POINTS];
+	Face			faces[EPA_MAX_FACES];
+	int				edges[EPA_MAX_FACES * 3][2];
+	int				pointCount	= 0;
+	int				faceCount	= 0;
+
+	for (int i = 0; i < count; ++i) {
+		points[pointCount++] = simplex[i];
+	}
+	//GJK can stop early with the origin on a corner, edge or face of its simplex - grow it out to a tetrahedron
+	const Vector3 axes[6] = { Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1) };
+	if (pointCount == 1) {
+		for (int i = 0; i < 6 && pointCount == 1; ++i) {
+			SupportPoint p = MinkowskiSupport(shapeA, shapeB, axes[i], true);
+			if ((p.point - points[0].point).LengthSquared() > GJK_TOUCHING) {
+				points[pointCount++] = p;
+			}
+		}
+	}
+	if (pointCount == 2) {
+		Vector3 line = points[1].point - points[0].point;
+		for (int i = 0; i < 6 && pointCount == 2; ++i) {
+			Vector3 direction = Vector3::Cross(line, axes[i]);
+			if (direction.LengthSquared() < GJK_TOUCHING) {
+				continue;
+			}
+			SupportPoint p = MinkowskiSupport(shapeA, shapeB, direction, true);
+			if (Vector3::Cross(p.point - points[0].point, line).LengthSquared() > GJK_TOUCHING) {
+				points[pointCount++] = p;
+			}
+		}
+	}
+	if (pointCount == 3) {
+		Vector3 normal = Vector3::Cross(points[1].point - points[0].point, points[2].point - points[0].point);
+		SupportPoint p = MinkowskiSupport(shapeA, shapeB, normal, true);
+		if (std::abs(Vector3::Dot(p.point - points[0].point, normal)) < GJK_TOUCHING) {
+			p = MinkowskiSupport(shapeA, shapeB, -normal, true);
+		}
+		points[pointCount++] = p;
+	}
+	if (pointCount < 4) {
+		return false;
+	}
+
+	auto addFace = [&](int a, int b, int c) {
+		Face& f = faces[faceCount++];
+		f.normal = Vector3::Cross(points[b].point - points[a].point, points[c].point - points[a].point);
+		float length = f.normal.Length();
+		if (length < FLT_EPSILON) {
+			//a sliver - never the closest face, but it still has to be part of the hull
+			f.v[0] = a; f.v[1] = b; f.v[2] = c;
+			f.normal	= Vector3();
+			f.distance	= FLT_MAX;
+			return;
+		}
+		f.v[0] = a; f.v[1] = b; f.v[2] = c;
+		f.normal	= f.normal / length;
+		f.distance	= Vector3::Dot(f.normal, points[a].point);
+	};
+	//wind the tetrahedron so every face points outwards - faces added later keep the winding of the edges they're built on
+	Vector3 baseNormal = Vector3::Cross(points[1].point - points[0].point, points[2].point - points[0].point);
+	if (Vector3::Dot(points[3].point - points[0].point, baseNormal) > 0.0f) {
+		std::swap(points[1], points[2]);
+	}
+	addFace(0, 1, 2);
+	addFace(0, 3, 1);
+	addFace(1, 3, 2);
+	addFace(2, 3, 0);
+
+	int closestFace = 0;
+	for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; ++iteration) {
+		closestFace = 0;
+		for (int i = 1; i < faceCount; ++i) {
+			if (faces[i].distance < faces[closestFace].distance) {
+				closestFace = i;
+			}
+		}
+		const Face& closest = faces[closestFace];
+		if (closest.distance == FLT_MAX) {
+			return false;
+		}
+		SupportPoint p = MinkowskiSupport(shapeA, shapeB, closest.normal, true);
+		if (Vector3::Dot(p.point, closest.normal) - closest.distance < EPA_TOLERANCE ||
+			pointCount == EPA_MAX_POINTS) {
+			break;
+		}
+		//remove every face that can see the new point, and join the edges around the hole up to it
+		int edgeCount = 0;
+		for (int i = 0; i < faceCount; ) {
+			const Face& f = faces[i];
+			if (f.distance == FLT_MAX || Vector3::Dot(f.normal, p.point - points[f.v[0]].point) <= 0.0f) {
+				++i;
+				continue;
+			}
+			for (int e = 0; e < 3; ++e) {
+				int a = f.v[e];
+				int b = f.v[(e + 1) % 3];
+				bool shared = false;
+				for (int j = 0; j < edgeCount; ++j) {
+					if (edges[j][0] == b && edges[j][1] == a) {
+						edges[j][0] = edges[edgeCount - 1][0];
+						edges[j][1] = edges[edgeCount - 1][1];
+						--edgeCount;
+						shared = true;
+						break;
+					}
+				}
+				if (!shared) {
+					edges[edgeCount][0] = a;
+					edges[edgeCount][1] = b;
+					++edgeCount;
+				}
+			}
+			faces[i] = faces[--faceCount];
+		}
+		if (faceCount + edgeCount > EPA_MAX_FACES) {
+			break;
+		}
+		points[pointCount] = p;
+		for (int i = 0; i < edgeCount; ++i) {
+			addFace(edges[i][0], edges[i][1], pointCount);
+		}
+		++pointCount;
+	}
+	if (closestFace >= faceCount) {
+		return false;
+	}
+
+	//where the origin projects onto the closest face, as weights of its corners
+	const Face& face = faces[closestFace];
+	const SupportPoint& a = points[face.v[0]];
+	const SupportPoint& b = points[face.v[1]];
+	const SupportPoint& c = points[face.v[2]];
+
+	Vector3 projected = face.normal * face.distance;
+	Vector3 v0 = b.point - a.point;
+	Vector3 v1 = c.point - a.point;
+	Vector3 v2 = projected - a.point;
+	float d00 = Vector3::Dot(v0, v0);
+	float d01 = Vector3::Dot(v0, v1);
+	float d11 = Vector3::Dot(v1, v1);
+	float d20 = Vector3::Dot(v2, v0);
+	float d21 = Vector3::Dot(v2, v1);
+	float denom = d00 * d11 - d01 * d01;
+	if (std::abs(denom) < FLT_EPSILON) {
+		return false;
+	}
+	float v = (d11 * d20 - d01 * d21) / denom;
+	float w = (d00 * d21 - d01 * d20) / denom;
+	float u = 1.0f - v - w;
+
+	Vector3 pointA = a.onA * u + b.onA * v + c.onA * w;
+	Vector3 pointB = a.onB * u + b.onB * v + c.onB * w;
+
+	//the difference is A - B, so its face normal already points from A towards B
+	collisionInfo.AddContactPoint(pointA - shapeA.transform->GetPosition(), pointB - shapeB.transform->GetPosition(), face.normal, face.distance);
+	return true;
+}
+
+bool CollisionDetection::ConvexIntersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	ConvexShape shapeA = MakeConvexShape(volumeA, worldTransformA);
+	ConvexShape shapeB = MakeConvexShape(volumeB, worldTransformB);
+
+	SupportPoint	simplex[4];
+	int				count = 0;
+	Vector3			closestA;
+	Vector3			closestB;
+
+	//the cores of two rounded shapes can be apart while the shapes still touch
+	if (!GJK(shapeA, shapeB, false, simplex, count, closestA, closestB)) {
+		Vector3 delta	= closestB - closestA;
+		float distance	= delta.Length();
+		float radii		= shapeA.radius + shapeB.radius;
+
+		if (distance >= radii) {
+			return false;
+		}
+		if (distance > GJK_TOUCHING) {
+			Vector3 normal = delta / distance;
+			Vector3 pointA = closestA + normal * shapeA.radius;
+			Vector3 pointB = closestB - normal * shapeB.radius;
+			collisionInfo.AddContactPoint(pointA - worldTransformA.GetPosition(), pointB - worldTransformB.GetPosition(), normal, radii - distance);
+			return true;
+		}
+	}
+	//the cores are overlapping, so EPA has to work out how deep the whole shapes are
+	if (shapeA.radius > 0.0f || shapeB.radius > 0.0f) {
+		if (!GJK(shapeA, shapeB, true, simplex, count, closestA, closestB)) {
+			return false;
+		}
+	}
+	return EPA(shapeA, shapeB, simplex, count, collisionInfo);
+}
+
+bool CollisionDetection::ConvexDistance(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, float& distance, Vector3& normal) {
+	ConvexShape shapeA = MakeConvexShape(volumeA, worldTransformA);
+	ConvexShape shapeB = MakeConvexShape(volumeB, worldTransformB);
+
+	SupportPoint	simplex[4];
+	int				count = 0;
+	Vector3			closestA;
+	Vector3			closestB;
+
+	if (GJK(shapeA, shapeB, false, simplex, count, closestA, closestB)) {
+		return false;
+	}
+	Vector3 delta		= closestB - closestA;
+	float coreDistance	= delta.Length();
+
+	distance = coreDistance - shapeA.radius - shapeB.radius;
+	if (coreDistance <= GJK_TOUCHING || distance <= 0.0f) {
+		return false;
+	}
+	normal = delta / coreDistance;
+	return true;
+}
+
+/*
+Conservative advancement - the volumes are this far apart, and can't be
+closing faster than the motion along the normal between them, so A can
+safely be moved that far without passing through B. Repeat until they're
+touching, or A's moving away from B, or it's run out of motion.
+*/
+bool CollisionDetection::ConvexCast(const CollisionVolume& volumeA, const Transform& worldTransformA, const Vector3& motion,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, float targetDistance, float& toi, Vector3& normal) {
+	Transform sweep	= worldTransformA;
+	Vector3 start	= sweep.GetPosition();
+
+	toi = 0.0f;
+	for (int i = 0; i < CAST_MAX_ITERATIONS; ++i) {
+		float distance;
+		sweep.SetPosition(start + motion * toi);
+		if (!ConvexDistance(volumeA, sweep, volumeB, worldTransformB, distance, normal)) {
+			if (toi == 0.0f) {
+				normal = Vector3();
+			}
+			return true;
+		}
+		float closingDistance = Vector3::Dot(motion, normal);
+		if (distance <= targetDistance) {
+			//this close, the normal's not much use - but it's only been moved this far because it was closing
+			return toi > 0.0f || closingDistance > 0.0f;
+		}
+		if (closingDistance <= 0.0f) {
+			return false; //moving apart, so they'll never meet
+		}
+		toi += (distance - targetDistance * 0.5f) / closingDistance;
+		if (toi >= 1.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Vector3 CollisionDetection::ConvexBounds(const CollisionVolume& volume, const Transform& worldTransform) {
+	ConvexShape shape	= MakeConvexShape(volume, worldTransform);
+	Vector3 position	= worldTransform.GetPosition();
+	Vector3 halfSizes;
+	for (int i = 0; i < 3; ++i) {
+		Vector3 axis;
+		axis[i] = 1.0f;
+		float upper = ConvexSupport(shape, axis, true)[i] - position[i];
+		float lower = position[i] - ConvexSupport(shape, -axis, true)[i];
+		halfSizes[i] = std::max(upper, lower);
+	}
+	return halfSizes;
+}
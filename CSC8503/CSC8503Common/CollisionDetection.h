@@ -10,6 +10,7 @@
 #include "OBBVolume.h"
 #include "SphereVolume.h"
 #include "CapsuleVolume.h"
+#include "MeshVolume.h"
 #include "Ray.h"
 
 using NCL::Camera;
@@ -24,19 +25,41 @@ namespace NCL {
 			Vector3 localB; // in the frame of each object
 			Vector3 normal;
 			float	penetration;
+
+			//The impulses the solver has built up at this point, kept to warm start the next step
+			float	normalImpulse;
+			float	tangentImpulses[2];
 		};
+		/*
+		Most volumes only ever touch at a single point, but two boxes can
+		rest face to face, which needs a contact point at each corner of
+		the overlap to stop them rocking about.
+		*/
+		static const int MAX_CONTACT_POINTS = 4;
+
 		struct CollisionInfo {
 			GameObject* a;
-			GameObject* b;		
+			GameObject* b;
 			mutable int		framesLeft;
 
-			ContactPoint point;
+			ContactPoint	points[MAX_CONTACT_POINTS];
+			int				pointCount = 0;
+
+			//The axis the box / box test found last time, tried first next time, -1 if none
+			int				cachedAxis = -1;
 
 			void AddContactPoint(const Vector3& localA, const Vector3& localB, const Vector3& normal, float p) {
+				if (pointCount == MAX_CONTACT_POINTS) {
+					return;
+				}
+				ContactPoint& point = points[pointCount++];
 				point.localA		= localA;
 				point.localB		= localB;
 				point.normal		= normal;
 				point.penetration	= p;
+				point.normalImpulse	= 0.0f;
+				point.tangentImpulses[0] = 0.0f;
+				point.tangentImpulses[1] = 0.0f;
 			}
 
 			//Advanced collision detection / resolution
@@ -62,15 +85,35 @@ namespace NCL {
 		static bool SphereCapsuleIntersection(
 			const CapsuleVolume& volumeA, const Transform& worldTransformA,
 			const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
-		/*static bool AABBCapsuleIntersection(
-			const CapsuleVolume& volumeA, const Transform& worldTransformA,
-			const AABBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);*/
-		/*static bool CapsuleIntersection(const CapsuleVolume& volumeA, const Transform& worldTransformA, const CapsuleVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);*/
 
-		/*static Vector3 ClosestPointOnLine(Vector3 A, Vector3 B, Vector3 p) {
-			Vector3 AB = B - A;
-			return A + (AB * ((Vector3::Dot(p - A, AB)) / (Vector3::Dot(AB, AB))));
-		}*/
+		/*
+		Any pair of convex volumes - boxes, spheres, capsules and mesh hulls -
+		can be tested with GJK, and EPA if they're overlapping, which only
+		need to know each volume's furthest point in a given direction. It's
+		slower than the bespoke tests, so it's only used for the pairs that
+		don't have one.
+		*/
+		static bool IsConvex(const CollisionVolume& volume);
+		static bool ConvexIntersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+									const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
+
+		//How far apart two convex volumes are, and the direction from A to B - false if they're touching
+		static bool ConvexDistance(const CollisionVolume& volumeA, const Transform& worldTransformA,
+									const CollisionVolume& volumeB, const Transform& worldTransformB, float& distance, Vector3& normal);
+
+		/*
+		Moves volume A along motion until it's within targetDistance of B,
+		returning true if that happens before the end of it, along with how
+		far along the motion it got (0 to 1) and the normal from A to B there.
+		If they're already overlapping before A moves, toi is 0 and the normal
+		is left zeroed, as there isn't one.
+		*/
+		static bool ConvexCast(const CollisionVolume& volumeA, const Transform& worldTransformA, const Vector3& motion,
+								const CollisionVolume& volumeB, const Transform& worldTransformB,
+								float targetDistance, float& toi, Vector3& normal);
+
+		//Half the size of a world space box around a convex volume, centred on its position
+		static Vector3 ConvexBounds(const CollisionVolume& volume, const Transform& worldTransform);
 
 		//TODO ADD THIS PROPERLY
 		static bool RayBoxIntersection(const Ray&r, const Vector3& boxPos, const Vector3& boxSize, RayCollision& collision);
@@ -84,6 +127,7 @@ namespace NCL {
 		static bool RayOBBIntersection(const Ray&r, const Transform& worldTransform, const OBBVolume&	volume, RayCollision& collision);
 		static bool RaySphereIntersection(const Ray&r, const Transform& worldTransform, const SphereVolume& volume, RayCollision& collision);
 		static bool RayCapsuleIntersection(const Ray& r, const Transform& worldTransform, const CapsuleVolume& volume, RayCollision& collision);
+		static bool RayMeshIntersection(const Ray& r, const Transform& worldTransform, const MeshVolume& volume, RayCollision& collision);
 
 
 		static bool RayPlaneIntersection(const Ray&r, const Plane&p, RayCollision& collisions);
@@ -106,6 +150,9 @@ namespace NCL {
 		static bool OBBIntersection(	const OBBVolume& volumeA, const Transform& worldTransformA,
 										const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
 
+		static bool AABBOBBIntersection(const AABBVolume& volumeA, const Transform& worldTransformA,
+										const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
+
 		static bool OBBSphereIntersection(const OBBVolume& volumeA, const Transform& worldTransformA, const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
 
 		static Vector3 Unproject(const Vector3& screenPos, const Camera& cam);
@@ -115,7 +162,49 @@ namespace NCL {
 		static Matrix4		GenerateInverseView(const Camera &c);
 
 	protected:
-	
+		struct Box {
+			Vector3 position;
+			Vector3 axes[3];
+			Vector3 halfSizes;
+		};
+
+		static Box	MakeBox(const Vector3& halfSizes, const Transform& worldTransform, bool useOrientation);
+		static bool	BoxIntersection(const Box& boxA, const Box& boxB, CollisionInfo& collisionInfo);
+		static float BoxSeparation(const Box& boxA, const Box& boxB, int axis, Vector3& normal);
+		static int	ClipPolygon(const Vector3* in, int inCount, const Vector3& planeNormal, float planeDistance, Vector3* out);
+		static void	BoxFaceContacts(const Box& reference, const Box& incident, int referenceAxis,
+									const Vector3& normal, bool referenceIsA, CollisionInfo& collisionInfo);
+		static void	BoxEdgeContact(const Box& boxA, const Box& boxB, int edgeA, int edgeB,
+									const Vector3& normal, float penetration, CollisionInfo& collisionInfo);
+
+		/*
+		Spheres and capsules are a point or a line 'inflated' by a radius -
+		GJK runs on just the point or line, so touching shapes can be found
+		from the closest points, without needing EPA.
+		*/
+		struct ConvexShape {
+			const CollisionVolume*	volume;
+			const Transform*		transform;
+			float					radius;
+		};
+
+		//A point on the Minkowski difference A - B, and the points on A and B it came from
+		struct SupportPoint {
+			Vector3 point;
+			Vector3 onA;
+			Vector3 onB;
+		};
+
+		static ConvexShape	MakeConvexShape(const CollisionVolume& volume, const Transform& worldTransform);
+		static Vector3		ConvexSupport(const ConvexShape& shape, const Vector3& direction, bool addRadius);
+		static SupportPoint	MinkowskiSupport(const ConvexShape& shapeA, const ConvexShape& shapeB, const Vector3& direction, bool addRadius);
+		static Vector3		ClosestSimplexPoint(SupportPoint* simplex, int& count, float* weights);
+		static int			ClosestTrianglePoint(const Vector3& a, const Vector3& b, const Vector3& c, int* indices, float* weights);
+		static bool			GJK(const ConvexShape& shapeA, const ConvexShape& shapeB, bool addRadius,
+								SupportPoint* simplex, int& count, Vector3& closestA, Vector3& closestB);
+		static bool			EPA(const ConvexShape& shapeA, const ConvexShape& shapeB,
+								SupportPoint* simplex, int count, CollisionInfo& collisionInfo);
+
 	private:
 		CollisionDetection()	{}
 		~CollisionDetection()	{}
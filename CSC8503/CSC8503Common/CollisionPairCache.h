@@ -0,0 +1,162 @@
+#pragma once
+#include "CollisionDetection.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		struct CachedPair {
+			uint64_t							key;
+			CollisionDetection::CollisionInfo	info;
+			bool								began;
+			int									lastContactStep = -1; //the physics step that last found a contact for them
+
+			//The objects might have been deleted since, so these say whether they're still in the world
+			GameObjectHandle					handleA;
+			GameObjectHandle					handleB;
+		};
+
+		/*
+		Stores every pair of objects that has collided in the last few frames.
+		The pairs themselves are kept in a dense array, so that the per-frame
+		update is a linear walk through memory, and an open addressing hash
+		table of indices into that array (keyed on the two world IDs) lets the
+		narrowphase find an existing pair without walking a tree of nodes.
+
+		Removing a pair swaps the last pair into its place, so iterate with an
+		index, and don't advance the index after a removal!
+		*/
+		class CollisionPairCache {
+		public:
+			CollisionPairCache() {
+				Clear();
+			}
+			~CollisionPairCache() {}
+
+			void Clear() {
+				pairs.clear();
+				slots.assign(MIN_SLOTS, Slot{ 0, EMPTY_SLOT });
+			}
+
+			int Count() const {
+				return (int)pairs.size();
+			}
+
+			CachedPair& operator[](int index) {
+				return pairs[index];
+			}
+
+			const CachedPair& operator[](int index) const {
+				return pairs[index];
+			}
+
+			static uint64_t MakeKey(int idA, int idB) {
+				if (idA > idB) {
+					std::swap(idA, idB);
+				}
+				return ((uint64_t)(uint32_t)idB << 32) | (uint32_t)idA;
+			}
+
+			CachedPair* Find(const GameObject* a, const GameObject* b) {
+				uint64_t key	= MakeKey(a->GetWorldID(), b->GetWorldID());
+				int slot		= FindSlot(key);
+				return slots[slot].index == EMPTY_SLOT ? nullptr : &pairs[slots[slot].index];
+			}
+
+			/*
+			Adds the pair if it isn't already in the cache, otherwise copies the
+			new contact data and framesLeft over the old entry. A new pair has
+			'began' set to false, so its begin event can be sent later on.
+			Returns the pair's index, which stays valid until a pair is removed.
+			*/
+			int Insert(const CollisionDetection::CollisionInfo& info) {
+				uint64_t key	= MakeKey(info.a->GetWorldID(), info.b->GetWorldID());
+				int slot		= FindSlot(key);
+
+				if (slots[slot].index != EMPTY_SLOT) {
+					pairs[slots[slot].index].info = info;
+					return slots[slot].index;
+				}
+				if ((pairs.size() + 1) * 2 > slots.size()) { //keep the load factor under a half
+					Grow();
+					slot = FindSlot(key);
+				}
+				slots[slot] = Slot{ key, (int)pairs.size() };
+				pairs.push_back(CachedPair{ key, info, false, -1, info.a->GetHandle(), info.b->GetHandle() });
+				return (int)pairs.size() - 1;
+			}
+
+			void RemoveAt(int index) {
+				RemoveSlot(FindSlot(pairs[index].key));
+
+				int lastIndex = (int)pairs.size() - 1;
+				if (index != lastIndex) {
+					pairs[index] = pairs[lastIndex];
+					slots[FindSlot(pairs[index].key)].index = index;
+				}
+				pairs.pop_back();
+			}
+
+		protected:
+			struct Slot {
+				uint64_t	key;
+				int			index;
+			};
+
+			static const int	EMPTY_SLOT	= -1;
+			static const size_t	MIN_SLOTS	= 64;
+
+			static size_t Hash(uint64_t key) {
+				key ^= key >> 33;
+				key *= 0xff51afd7ed558ccdULL;
+				key ^= key >> 33;
+				return (size_t)key;
+			}
+
+			//Returns the slot holding the key, or the empty slot it would go in
+			int FindSlot(uint64_t key) const {
+				size_t mask = slots.size() - 1;
+				size_t slot = Hash(key) & mask;
+				while (slots[slot].index != EMPTY_SLOT && slots[slot].key != key) {
+					slot = (slot + 1) & mask;
+				}
+				return (int)slot;
+			}
+
+			/*
+			Linear probing lets us remove without leaving tombstones behind -
+			any entries further along the probe chain that could sit in the
+			hole are shifted back into it, so lookups never stop early.
+			*/
+			void RemoveSlot(int hole) {
+				size_t mask = slots.size() - 1;
+				size_t i	= (size_t)hole;
+				size_t j	= i;
+				while (true) {
+					j = (j + 1) & mask;
+					if (slots[j].index == EMPTY_SLOT) {
+						break;
+					}
+					size_t home = Hash(slots[j].key) & mask;
+					bool canMove = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+					if (canMove) {
+						slots[i]	= slots[j];
+						i			= j;
+					}
+				}
+				slots[i].index = EMPTY_SLOT;
+			}
+
+			void Grow() {
+				slots.assign(slots.size() * 2, Slot{ 0, EMPTY_SLOT });
+				for (int i = 0; i < (int)pairs.size(); ++i) {
+					slots[FindSlot(pairs[i].key)] = Slot{ pairs[i].key, i };
+				}
+			}
+
+			std::vector<CachedPair>	pairs;
+			std::vector<Slot>		slots;
+		};
+	}
+}
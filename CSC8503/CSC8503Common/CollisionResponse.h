@@ -0,0 +1,90 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+
+using namespace NCL::Maths;
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Every GameObject sits on one collision layer, and has a mask of the
+		layers it's allowed to collide with. A pair of objects is only
+		tested if each one's mask has the other's layer in it, so the
+		broadphase can throw away pairs that could never interact.
+		*/
+		enum class CollisionLayer {
+			Default,
+			Ball,
+			BouncePad,
+			Pickup,
+			WinZone,
+			LoseZone,
+			Character,
+			MaxLayers = 32
+		};
+
+		const unsigned int ALL_COLLISION_LAYERS = 0xFFFFFFFF;
+
+		inline unsigned int LayerBit(CollisionLayer layer) {
+			return 1u << (int)layer;
+		}
+
+		/*
+		What happens when two layers touch. Physical is the normal impulse
+		response - the others are gameplay responses, which are handled by
+		the object on the first layer of the pair (the pad, the pickup...)
+		using the settings in its material.
+		*/
+		enum class CollisionResponse {
+			Physical,		//bounce off each other
+			BouncePad,		//the pad gives the other object its material's impulses
+			ScorePickup,	//the pickup is collected, and its material's score added
+			Trigger			//the trigger's material event fires, and they still bounce off each other
+		};
+
+		struct CollisionMaterial {
+			Vector3	linearImpulse;	//bounce pads
+			Vector3	angularImpulse;
+			int		score		= 0;		//pickups
+			bool	winsGame	= false;	//triggers
+			bool	losesGame	= false;
+		};
+
+		/*
+		Looks up the response for a pair of layers. Setting a response sets
+		it both ways round, remembering which of the pair it belongs to, so
+		it doesn't matter which order the physics finds the objects in.
+		*/
+		class CollisionResponseTable {
+		public:
+			CollisionResponseTable() {
+				for (int a = 0; a < LAYER_COUNT; ++a) {
+					for (int b = 0; b < LAYER_COUNT; ++b) {
+						entries[a][b] = { CollisionResponse::Physical, true };
+					}
+				}
+			}
+
+			void SetResponse(CollisionLayer owner, CollisionLayer other, CollisionResponse response) {
+				entries[(int)owner][(int)other] = { response, true };
+				entries[(int)other][(int)owner] = { response, (int)owner == (int)other };
+			}
+
+			//ownerIsA says whether the first object of the pair is the one the response belongs to
+			CollisionResponse GetResponse(CollisionLayer a, CollisionLayer b, bool& ownerIsA) const {
+				const Entry& e = entries[(int)a][(int)b];
+				ownerIsA = e.ownerIsFirst;
+				return e.response;
+			}
+
+		protected:
+			static const int LAYER_COUNT = (int)CollisionLayer::MaxLayers;
+
+			struct Entry {
+				CollisionResponse	response;
+				bool				ownerIsFirst;
+			};
+			Entry entries[LAYER_COUNT][LAYER_COUNT];
+		};
+	}
+}
@@ -0,0 +1,19 @@
+#include "CommandBuffer.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+
+using namespace NCL;
+using namespace NCL::CSC8503;
+
+void CommandBuffer::AddGameObject(GameObject* o) {
+	Record([o](GameWorld& world) {
+		world.AddGameObject(o);
+	});
+}
+
+void CommandBuffer::RemoveGameObject(GameObject* o, bool andDelete) {
+	GameObjectHandle handle = o->GetHandle(); //the object might be gone by the time this runs
+	Record([handle, andDelete](GameWorld& world) {
+		world.RemoveGameObject(handle, andDelete);
+	});
+}
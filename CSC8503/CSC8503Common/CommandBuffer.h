@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <climits>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameWorld;
+		class GameObject;
+
+		/*
+		Objects updated in parallel can't add or remove objects from the
+		world themselves, as the other threads are still walking through it.
+		Instead they record what they want done into a command buffer, and
+		the world carries the commands out once every object has updated.
+
+		Each command is tagged with the order of the object that recorded
+		it, so however the objects got split between the threads, the
+		commands always run in the same order.
+		*/
+		class CommandBuffer {
+		public:
+			typedef std::function<void(GameWorld&)> Command;
+
+			struct Entry {
+				int		order;
+				Command	command;
+			};
+
+			CommandBuffer() {
+				order = INT_MAX; //until an order's set, commands go after everything else
+			}
+			~CommandBuffer() {}
+
+			void AddGameObject(GameObject* o);
+			void RemoveGameObject(GameObject* o, bool andDelete = false);
+
+			void Record(const Command& command) {
+				entries.push_back({ order, command });
+			}
+
+			//Commands recorded from now on are run after those with a lower order
+			void SetOrder(int newOrder) {
+				order = newOrder;
+			}
+
+			std::vector<Entry>& GetEntries() {
+				return entries;
+			}
+
+		protected:
+			std::vector<Entry>	entries;
+			int					order;
+		};
+	}
+}
@@ -2,12 +2,18 @@
 
 namespace NCL {
 	namespace CSC8503 {
+		class GameObject;
+
 		class Constraint	{
 		public:
 			Constraint() {}
 			virtual ~Constraint() {}
 
 			virtual void UpdateConstraint(float dt) = 0;
+
+			//The physics system uses these to group constrained objects into islands
+			virtual GameObject* GetObjectA() const = 0;
+			virtual GameObject* GetObjectB() const = 0;
 		};
 	}
 }
\ No newline at end of file
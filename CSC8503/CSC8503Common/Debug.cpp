@@ -2,8 +2,6 @@
 #include "../../Common/Matrix4.h"
 using namespace NCL;
 
-OGLRenderer* Debug::renderer = nullptr;
-
 std::vector<Debug::DebugStringEntry>	Debug::stringEntries;
 std::vector<Debug::DebugLineEntry>		Debug::lineEntries;
 
@@ -56,17 +54,10 @@ void Debug::DrawAxisLines(const Matrix4& modelMatrix, float scaleBoost, float ti
 }
 
 
-void Debug::FlushRenderables(float dt) {
-	if (!renderer) {
-		return;
-	}
-	for (const auto& i : stringEntries) {
-		renderer->DrawString(i.data, i.position);
-	}
+void Debug::UpdateRenderables(float dt) {
 	int trim = 0;
 	for (int i = 0; i < lineEntries.size(); ) {
 		DebugLineEntry* e = &lineEntries[i]; 
-		renderer->DrawLine(e->start, e->end, e->colour);
 		e->time -= dt;
 		if (e->time < 0) {			
 			trim++;				
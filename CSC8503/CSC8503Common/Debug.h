@@ -1,22 +1,50 @@
 #pragma once
-#include "../../Plugins/OpenGLRendering/OGLRenderer.h"
+#include "../../Common/Vector2.h"
+#include "../../Common/Vector3.h"
+#include "../../Common/Vector4.h"
+#include "../../Common/Matrix4.h"
 #include <vector>
 #include <string>
 
 namespace NCL {
+	using namespace NCL::Maths;
+
+	/*
+	Debug only collects the strings and lines it's given - it's up to the
+	renderer to draw them, which is what lets the physics use it without
+	a window or an OpenGL context (the scene benchmark runs headless).
+	*/
 	class Debug
 	{
 	public:
+		struct DebugStringEntry {
+			std::string	data;
+			Vector2 position;
+			Vector4 colour;
+		};
+
+		struct DebugLineEntry {
+			Vector3 start;
+			Vector3 end;
+			float	time;
+			Vector4 colour;
+		};
+
 		static void Print(const std::string& text, const Vector2&pos, const Vector4& colour = Vector4(1, 1, 1, 1));
 		static void DrawLine(const Vector3& startpoint, const Vector3& endpoint, const Vector4& colour = Vector4(1, 1, 1, 1), float time = 0.0f);
 
 		static void DrawAxisLines(const Matrix4 &modelMatrix, float scaleBoost = 1.0f, float time = 0.0f);
 
-		static void SetRenderer(OGLRenderer* r) {
-			renderer = r;
+		static const std::vector<DebugStringEntry>& GetDebugStrings() {
+			return stringEntries;
+		}
+
+		static const std::vector<DebugLineEntry>& GetDebugLines() {
+			return lineEntries;
 		}
 
-		static void FlushRenderables(float dt);
+		//Call once the frame's been drawn - clears the strings, and any lines that have run out of time
+		static void UpdateRenderables(float dt);
 
 
 		static const Vector4 RED;
@@ -31,26 +59,11 @@ namespace NCL {
 		static const Vector4 CYAN;
 
 	protected:
-		struct DebugStringEntry {
-			std::string	data;
-			Vector2 position;
-			Vector4 colour;
-		};
-
-		struct DebugLineEntry {
-			Vector3 start;
-			Vector3 end;
-			float	time;
-			Vector4 colour;
-		};
-
 		Debug() {}
 		~Debug() {}
 
 		static std::vector<DebugStringEntry>	stringEntries;
 		static std::vector<DebugLineEntry>	lineEntries;
-
-		static OGLRenderer* renderer;
 	};
 }
 
@@ -6,13 +6,16 @@ using namespace NCL;
 using namespace CSC8503;
 
 GameClient::GameClient()	{
-	netHandle = enet_host_create(nullptr, 1, 1, 0, 0);
+	netHandle	= enet_host_create(nullptr, 1, CHANNEL_COUNT, 0, 0);
+	netPeer		= nullptr;
+	gameWorld	= nullptr;
 }
 
 GameClient::~GameClient()	{
 	//threadAlive = false;
 	//updateThread.join();
 	enet_host_destroy(netHandle);
+	netHandle = nullptr;
 }
 
 bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum) {
@@ -21,7 +24,7 @@ bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum
 
 	address.host = (d << 24) | (c << 16) | (b << 8) | (a);
 
-	netPeer = enet_host_connect(netHandle, &address, 2, 0);
+	netPeer = enet_host_connect(netHandle, &address, CHANNEL_COUNT, 0);
 
 	if (netPeer != nullptr) {
 		//threadAlive = true;
@@ -31,7 +34,7 @@ bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum
 	return netPeer != nullptr;
 }
 
-void GameClient::UpdateClient() {
+void GameClient::UpdateClient(float dt) {
 	if (netHandle == nullptr)
 	{
 		return;
@@ -43,19 +46,30 @@ void GameClient::UpdateClient() {
 		if (event.type == ENET_EVENT_TYPE_CONNECT) {
 			std::cout << "Client: Connected to server!" << std::endl;
 		}
-		else if (event.type == ENET_EVENT_TYPE_RECEIVE) {
-			std::cout << "Client: Packet recieved..." << std::endl;
+		else if (event.type == ENET_EVENT_TYPE_RECEIVE && event.channelID == SNAPSHOT_CHANNEL) {
+			//Every snapshot that's used is acknowledged, so the server can send deltas from it
+			if (interpolator.ReceiveSnapshot(event.packet->data, event.packet->dataLength)) {
+				SnapshotAckPacket ack(interpolator.GetLatestFrame());
+				SendPacket(ack);
+			}
+		}
+		else if (event.type == ENET_EVENT_TYPE_RECEIVE && IsValidPacket(event.packet)) {
 			GamePacket* packet = (GamePacket*)event.packet->data;
 			ProcessPacket(packet);
 		}
 		enet_packet_destroy(event.packet);
 	}
+
+	interpolator.Update(dt);
+	if (gameWorld) {
+		interpolator.Apply(*gameWorld);
+	}
 }
 
 void GameClient::SendPacket(GamePacket&  payload) {
 	ENetPacket* dataPacket = enet_packet_create(&payload, payload.GetTotalSize(), 0);
 
-	int test = enet_peer_send(netPeer, 0, dataPacket);
+	int test = enet_peer_send(netPeer, PACKET_CHANNEL, dataPacket);
 }
 
 //void GameClient::ThreadedUpdate() {
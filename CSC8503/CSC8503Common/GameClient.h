@@ -1,5 +1,6 @@
 #pragma once
 #include "NetworkBase.h"
+#include "SnapshotReplication.h"
 #include <stdint.h>
 #include <thread>
 #include <atomic>
@@ -7,6 +8,7 @@
 namespace NCL {
 	namespace CSC8503 {
 		class GameObject;
+		class GameWorld;
 		class GameClient : public NetworkBase {
 		public:
 			GameClient();
@@ -16,11 +18,23 @@ namespace NCL {
 
 			void SendPacket(GamePacket&  payload);
 
-			void UpdateClient();
+			//Objects in this world are moved to where the server's snapshots have them
+			void SetGameWorld(GameWorld &g) {
+				gameWorld = &g;
+			}
+
+			SnapshotInterpolator& GetInterpolator() {
+				return interpolator;
+			}
+
+			void UpdateClient(float dt);
 		protected:	
 			//void ThreadedUpdate();
 
 			ENetPeer*	netPeer;
+			GameWorld*	gameWorld;
+
+			SnapshotInterpolator interpolator;
 			//std::atomic<bool>	threadAlive;
 			//std::thread			updateThread;
 		};
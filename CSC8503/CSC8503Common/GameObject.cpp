@@ -2,15 +2,25 @@
 #include "CollisionDetection.h"
 #include "PlaneVolume.h"
 
+#include <cmath>
+
 using namespace NCL::CSC8503;
 
 GameObject::GameObject(string objectName)	{
 	name			= objectName;
 	worldID			= -1;
+	broadphaseProxy	= -1;
+	raycastProxy	= -1;
 	isActive		= true;
+	threadSafe		= false;
 	boundingVolume	= nullptr;
 	physicsObject	= nullptr;
 	renderObject	= nullptr;
+	bodyStore		= nullptr;
+
+	collisionLayer		= CollisionLayer::Default;
+	collisionMask		= ALL_COLLISION_LAYERS;
+	collisionMaterial	= 0;
 }
 
 GameObject::~GameObject()	{
@@ -44,6 +54,18 @@ void GameObject::UpdateBroadphaseAABB() {
 		Vector3 halfSizes = ((OBBVolume&)*boundingVolume).GetHalfDimensions();
 		broadphaseAABB = mat * halfSizes;
 	}
+	else if (boundingVolume->type == VolumeType::Mesh) {
+		Matrix3 mat = Matrix3(transform.GetOrientation());
+		mat = mat.Absolute();
+		Vector3 halfSizes = ((MeshVolume&)*boundingVolume).GetHalfDimensions();
+		broadphaseAABB = mat * halfSizes;
+	}
+	else if (boundingVolume->type == VolumeType::Capsule) {
+		const CapsuleVolume& capsule = (CapsuleVolume&)*boundingVolume;
+		float r = capsule.GetRadius();
+		Vector3 axis = transform.GetOrientation() * Vector3(0, capsule.GetHalfHeight() - r, 0);
+		broadphaseAABB = Vector3(std::abs(axis.x) + r, std::abs(axis.y) + r, std::abs(axis.z) + r);
+	}
 	else if (boundingVolume->type == VolumeType::Plane) {
 		Matrix3 mat = Matrix3(transform.GetOrientation());
 		mat = mat.Absolute();
@@ -4,6 +4,8 @@
 
 #include "PhysicsObject.h"
 #include "RenderObject.h"
+#include "CollisionResponse.h"
+#include "SlotMap.h"
 
 #include <vector>
 
@@ -11,6 +13,7 @@ using std::vector;
 
 namespace NCL {
 	namespace CSC8503 {
+		typedef SlotHandle GameObjectHandle;
 
 		class GameObject	{
 		public:
@@ -47,6 +50,17 @@ namespace NCL {
 
 			void SetPhysicsObject(PhysicsObject* newObject) {
 				physicsObject = newObject;
+				if (physicsObject) {
+					physicsObject->SetBodyStore(bodyStore);
+				}
+			}
+
+			//Set by the world when the object's added, so its body's stepped with the rest of the world's
+			void SetBodyStore(RigidBodyStore* store) {
+				bodyStore = store;
+				if (physicsObject) {
+					physicsObject->SetBodyStore(store);
+				}
 			}
 
 			const string& GetName() const {
@@ -76,19 +90,100 @@ namespace NCL {
 			int		GetWorldID() const {
 				return worldID;
 			}
+
+			//Set by the world when the object's added, and null if it's not in one
+			void SetHandle(GameObjectHandle newHandle) {
+				handle = newHandle;
+			}
+
+			GameObjectHandle GetHandle() const {
+				return handle;
+			}
+
+			void SetBroadphaseProxy(int proxy) {
+				broadphaseProxy = proxy;
+			}
+
+			int		GetBroadphaseProxy() const {
+				return broadphaseProxy;
+			}
+
+			//Where the object is in the world's raycast tree
+			void SetRaycastProxy(int proxy) {
+				raycastProxy = proxy;
+			}
+
+			int		GetRaycastProxy() const {
+				return raycastProxy;
+			}
+
+			void SetCollisionLayer(CollisionLayer layer) {
+				collisionLayer = layer;
+			}
+
+			CollisionLayer GetCollisionLayer() const {
+				return collisionLayer;
+			}
+
+			//Which layers this object can collide with - everything, unless told otherwise
+			void SetCollisionMask(unsigned int mask) {
+				collisionMask = mask;
+			}
+
+			unsigned int GetCollisionMask() const {
+				return collisionMask;
+			}
+
+			//An index into the physics system's collision materials
+			void SetCollisionMaterial(int material) {
+				collisionMaterial = material;
+			}
+
+			int GetCollisionMaterial() const {
+				return collisionMaterial;
+			}
+
+			bool CanCollideWith(const GameObject& other) const {
+				return (collisionMask & LayerBit(other.collisionLayer)) && (other.collisionMask & LayerBit(collisionLayer));
+			}
 			virtual void Update(float dt) {};
 
+			/*
+			A thread safe object's Update only changes the object itself (and
+			its own physics object), so the world can update it in parallel
+			with other thread safe objects. Anything else it wants to change in
+			the world has to go through the world's command buffer, and the
+			only parts of the world it can look at are the raycasts, shape
+			casts and overlap queries.
+			*/
+			void SetThreadSafe(bool state) {
+				threadSafe = state;
+			}
+
+			bool IsThreadSafe() const {
+				return threadSafe;
+			}
+
 		protected:
 			Transform			transform;
 
 			CollisionVolume*	boundingVolume;
 			PhysicsObject*		physicsObject;
 			RenderObject*		renderObject;
+			RigidBodyStore*		bodyStore;
 
 			bool	isActive;
+			bool	threadSafe;
 			int		worldID;
+			GameObjectHandle	handle;
+			int		broadphaseProxy;
+			int		raycastProxy;
 			string	name;
 
+			CollisionLayer	collisionLayer;
+			unsigned int	collisionMask;
+			int				collisionMaterial;
+
 			Vector3 broadphaseAABB;
 		};
 	}
@@ -1,6 +1,7 @@
 #include "GameServer.h"
 #include "GameWorld.h"
 #include <iostream>
+#include <algorithm>
 
 using namespace NCL;
 using namespace CSC8503;
@@ -10,6 +11,10 @@ GameServer::GameServer(int onPort, int maxClients)	{
 	clientMax	= maxClients;
 	clientCount = 0;
 	netHandle	= nullptr;
+	gameWorld	= nullptr;
+
+	snapshotInterval	= 1.0f / 64.0f;
+	snapshotTimer		= 0.0f;
 	//threadAlive = false;
 
 	Initialise();
@@ -20,6 +25,9 @@ GameServer::~GameServer()	{
 }
 
 void GameServer::Shutdown() {
+	if (!netHandle) {
+		return;
+	}
 	SendGlobalPacket(BasicNetworkMessages::Shutdown);
 
 	//threadAlive = false;
@@ -27,6 +35,7 @@ void GameServer::Shutdown() {
 
 	enet_host_destroy(netHandle);
 	netHandle = nullptr;
+	clients.clear();
 }
 
 bool GameServer::Initialise() {
@@ -34,7 +43,7 @@ bool GameServer::Initialise() {
 	address.host = ENET_HOST_ANY;
 	address.port = port;
 
-	netHandle = enet_host_create(&address, clientMax, 1, 0, 0);
+	netHandle = enet_host_create(&address, clientMax, CHANNEL_COUNT, 0, 0);
 
 	if (!netHandle) {
 		std::cout << __FUNCTION__ << " failed to create network handle!" << std::endl;
@@ -55,11 +64,11 @@ bool GameServer::SendGlobalPacket(int msgID) {
 
 bool GameServer::SendGlobalPacket(GamePacket& packet) {
 	ENetPacket* dataPacket = enet_packet_create(&packet, packet.GetTotalSize(), 0);
-	enet_host_broadcast(netHandle, 0, dataPacket);
+	enet_host_broadcast(netHandle, PACKET_CHANNEL, dataPacket);
 	return true;
 }
 
-void GameServer::UpdateServer() {
+void GameServer::UpdateServer(float dt) {
 	if (!netHandle) {
 		return;
 	}
@@ -75,18 +84,64 @@ void GameServer::UpdateServer() {
 			std::cout << "Server: New client connected" << std::endl;
 			NewPlayerPacket player(peer);
 			SendGlobalPacket(player);
+
+			clients[peer].peer = p;
 		}
 		else if (type == ENetEventType::ENET_EVENT_TYPE_DISCONNECT) {
 			std::cout << "Server: A client has disconnected" << std::endl;
 			PlayerDisconnectPacket player(peer);
 			SendGlobalPacket(player);
+
+			clients.erase(peer);
 		}
-		else if (type == ENetEventType::ENET_EVENT_TYPE_RECEIVE) {
+		else if (type == ENetEventType::ENET_EVENT_TYPE_RECEIVE && IsValidPacket(event.packet)) {
 			GamePacket* packet = (GamePacket*)event.packet->data;
-			ProcessPacket(packet, peer);
+			if (packet->type == BasicNetworkMessages::Received_State) {
+				//Acks can arrive out of order, so only ever move on to a newer frame
+				SnapshotAckPacket* ack = (SnapshotAckPacket*)packet;
+				bool hasFrame = event.packet->dataLength >= sizeof(SnapshotAckPacket);
+				auto client = clients.find(peer);
+				if (hasFrame && client != clients.end() && (!client->second.hasAck || ack->frame > client->second.ackedFrame)) {
+					client->second.hasAck		= true;
+					client->second.ackedFrame	= ack->frame;
+				}
+			}
+			else {
+				ProcessPacket(packet, peer);
+			}
 		}
 		enet_packet_destroy(event.packet);
 	}
+
+	if (!gameWorld || clients.empty()) {
+		snapshotTimer = 0.0f;
+		return;
+	}
+	snapshotTimer += dt;
+	if (snapshotTimer >= snapshotInterval) {
+		//If the server's fallen behind, there's no point sending the same world more than once
+		snapshotTimer = std::min(snapshotTimer - snapshotInterval, snapshotInterval);
+		SendSnapshots();
+	}
+}
+
+/*
+Every client gets the same frame, but as a delta from whatever frame it
+last told us it had. Snapshots go out on their own channel, unreliably -
+a lost one is just replaced by the next, so there's nothing to resend.
+*/
+void GameServer::SendSnapshots() {
+	snapshots.Record(*gameWorld);
+
+	for (auto& client : clients) {
+		size_t size = snapshots.WriteForClient(snapshotBuffer, client.second.hasAck, client.second.ackedFrame);
+		if (size == 0) {
+			continue;
+		}
+		ENetPacket* dataPacket = enet_packet_create(snapshotBuffer.data(), size, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+		enet_peer_send(client.second.peer, SNAPSHOT_CHANNEL, dataPacket);
+	}
+	enet_host_flush(netHandle);
 }
 
 //void GameServer::ThreadedUpdate() {
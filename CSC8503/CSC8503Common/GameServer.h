@@ -1,8 +1,10 @@
 #pragma once
 #include <thread>
 #include <atomic>
+#include <map>
 
 #include "NetworkBase.h"
+#include "SnapshotReplication.h"
 
 namespace NCL {
 	namespace CSC8503 {
@@ -17,19 +19,38 @@ namespace NCL {
 
 			void SetGameWorld(GameWorld &g);
 
+			//How many times a second every client is sent the world
+			void SetSnapshotRate(int hz) {
+				snapshotInterval = 1.0f / hz;
+			}
+
 			//void ThreadedUpdate();
 
 			bool SendGlobalPacket(int msgID);
 			bool SendGlobalPacket(GamePacket& packet);
 
-			virtual void UpdateServer();
+			virtual void UpdateServer(float dt);
 
 		protected:
+			void SendSnapshots();
+
+			struct ClientState {
+				ENetPeer*	peer		= nullptr;
+				bool		hasAck		= false;
+				uint32_t	ackedFrame	= 0;
+			};
+
 			int			port;
 			int			clientMax;
 			int			clientCount;
 			GameWorld*	gameWorld;
 
+			std::map<int, ClientState>	clients;
+			SnapshotHistory				snapshots;
+			std::vector<uint8_t>		snapshotBuffer;
+			float						snapshotInterval;
+			float						snapshotTimer;
+
 			//std::atomic<bool> threadAlive;
 
 			
@@ -4,6 +4,8 @@
 #include "CollisionDetection.h"
 #include "../../Common/Camera.h"
 #include <algorithm>
+#include <iterator>
+#include <climits>
 
 using namespace NCL;
 using namespace NCL::CSC8503;
@@ -13,15 +15,28 @@ GameWorld::GameWorld()	{
 
 	shuffleConstraints	= false;
 	shuffleObjects		= false;
-	worldIDCounter		= 0;
+	jobSystem			= nullptr;
+
+	commandBuffers.resize(1);
 }
 
+//Anything still in the world takes its body back, as the world's store is about to go
 GameWorld::~GameWorld()	{
+	Clear();
 }
 
 void GameWorld::Clear() {
-	gameObjects.clear();
+	DestroyRemovedObjects(); //anything waiting to be deleted still has to be
+	for (GameObject* o : gameObjects) {
+		o->SetHandle(GameObjectHandle());
+		o->SetBodyStore(nullptr);
+	}
+	gameObjects.Clear();
 	constraints.clear();
+	raycastTree.Clear();
+	for (CommandBuffer& buffer : commandBuffers) {
+		buffer.GetEntries().clear();
+	}
 }
 
 void GameWorld::ClearAndErase() {
@@ -31,19 +46,63 @@ void GameWorld::ClearAndErase() {
 	for (auto& i : constraints) {
 		delete i;
 	}
+	gameObjects.Clear();
 	Clear();
 }
 
-void GameWorld::AddGameObject(GameObject* o) {
-	gameObjects.emplace_back(o);
-	o->SetWorldID(worldIDCounter++);
+/*
+Objects live in a slot map, so adding one is O(1), and its handle can be
+used to find it again for as long as it's in the world. Its world ID is
+the handle's slot, which gets reused once the object's gone, keeping the
+IDs small enough to pack two of them into a collision pair's key.
+*/
+GameObjectHandle GameWorld::AddGameObject(GameObject* o) {
+	GameObjectHandle handle = gameObjects.Add(o);
+	o->SetHandle(handle);
+	o->SetWorldID((int)handle.index);
+	o->SetBodyStore(&bodies);
+	return handle;
 }
 
 void GameWorld::RemoveGameObject(GameObject* o, bool andDelete) {
-	gameObjects.erase(std::remove(gameObjects.begin(), gameObjects.end(), o), gameObjects.end());
-	if (andDelete) {
-		delete o;
+	if (!gameObjects.Contains(o->GetHandle())) { //it was never added, so nothing can be using it
+		if (andDelete) {
+			delete o;
+		}
+		return;
 	}
+	RemoveGameObject(o->GetHandle(), andDelete);
+}
+
+void GameWorld::RemoveGameObject(GameObjectHandle handle, bool andDelete) {
+	pendingRemovals.push_back({ handle, andDelete });
+}
+
+/*
+The safe point for removals - nothing's halfway through using the objects
+here. Each removal is O(1), as the last object is moved into the hole, and
+anything that kept an object's handle will find it's no longer valid.
+*/
+void GameWorld::DestroyRemovedObjects() {
+	for (const PendingRemoval& removal : pendingRemovals) {
+		GameObject* o = GetGameObject(removal.handle);
+		if (!o) { //removed twice
+			continue;
+		}
+		gameObjects.Remove(removal.handle);
+		if (raycastTree.IsValidProxy(o->GetRaycastProxy(), o)) {
+			raycastTree.Remove(o->GetRaycastProxy());
+		}
+		o->SetRaycastProxy(-1);
+		o->SetHandle(GameObjectHandle());
+		if (removal.andDelete) {
+			delete o;
+		}
+		else {
+			o->SetBodyStore(nullptr);
+		}
+	}
+	pendingRemovals.clear();
 }
 
 void GameWorld::GetObjectIterators(
@@ -60,9 +119,14 @@ void GameWorld::OperateOnContents(GameObjectFunc f) {
 	}
 }
 
-void GameWorld::UpdateWorld(float dt) {
-	if (shuffleObjects) {
-		std::random_shuffle(gameObjects.begin(), gameObjects.end());
+void GameWorld::UpdateWorld(float /*dt*/) {
+	ExecuteCommands(); //anything recorded since the objects were updated
+	DestroyRemovedObjects();
+
+	if (shuffleObjects) { //swapped in place, so that every object keeps its handle
+		for (int i = gameObjects.Count() - 1; i > 0; --i) {
+			gameObjects.Swap(i, rand() % (i + 1));
+		}
 	}
 
 	if (shuffleConstraints) {
@@ -70,46 +134,313 @@ void GameWorld::UpdateWorld(float dt) {
 	}
 }
 
+//How many packets of rays each raycast job casts at once
+const int RAYCAST_CHUNK_SIZE = 4;
+
+/*
+Rather than testing every object's volume, rays are cast through a tree of
+the objects' bounding boxes, and only the objects whose boxes they pass
+through are tested properly. Objects are moved about between raycasts by
+the physics and by gameplay code, so the tree is refreshed first - that's
+still a pass over every object, but only to check each one's box is still
+inside its slightly larger box in the tree, which it mostly will be.
+*/
 bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObject) const {
-	//The simplest raycast just goes through each object and sees if there's a collision
+	UpdateRaycastTree();
+
 	RayCollision collision;
+	RaycastPacket(&r, 1, &collision, closestObject);
+	if (collision.node) {
+		closestCollision = collision;
+		return true;
+	}
+	return false;
+}
 
-	for (auto& i : gameObjects) {
-		if (!i->GetBoundingVolume()) { //objects might not be collideable etc...
+void GameWorld::RaycastBatch(const Ray* rays, int rayCount, RayCollision* hits, bool closestObject) const {
+	UpdateRaycastTree();
+
+	int packetCount = (rayCount + RayPacket::Size - 1) / RayPacket::Size;
+	auto castPackets = [&](int start, int end, int /*threadIndex*/) {
+		for (int i = start; i < end; ++i) {
+			int first = i * RayPacket::Size;
+			RaycastPacket(rays + first, std::min(RayPacket::Size, rayCount - first), hits + first, closestObject);
+		}
+	};
+	if (jobSystem && !jobSystem->IsRunningJob()) { //jobs can't start jobs, so from inside one the rays are just cast here
+		jobSystem->ParallelFor(packetCount, RAYCAST_CHUNK_SIZE, castPackets);
+	}
+	else {
+		castPackets(0, packetCount, 0);
+	}
+}
+
+/*
+From inside a job (a thread safe object's Update, say) other threads might
+be querying the tree at the same time, so it's left alone - it's refreshed
+before the objects are updated, and is then only ever read until they're
+all done.
+*/
+void GameWorld::UpdateRaycastTree() const {
+	if (jobSystem && jobSystem->IsRunningJob()) {
+		return;
+	}
+	for (GameObject* o : gameObjects) {
+		int proxy = o->GetRaycastProxy();
+		if (!raycastTree.IsValidProxy(proxy, o)) {
+			proxy = -1;
+		}
+		if (!o->GetBoundingVolume()) { //objects might not be collideable etc...
+			if (proxy >= 0) {
+				raycastTree.Remove(proxy);
+			}
+			o->SetRaycastProxy(-1);
 			continue;
 		}
-		RayCollision thisCollision;
-		if (CollisionDetection::RayIntersection(r, *i, thisCollision)) {
-				
-			if (!closestObject) {	
-				closestCollision		= collision;
-				closestCollision.node = i;
-				return true;
+		Vector3 halfSizes;
+		o->UpdateBroadphaseAABB();
+		o->GetBroadphaseAABB(halfSizes);
+		Vector3 pos = o->GetTransform().GetPosition();
+
+		if (proxy < 0) {
+			o->SetRaycastProxy(raycastTree.Insert(o, pos, halfSizes));
+		}
+		else {
+			raycastTree.Update(proxy, pos, halfSizes);
+		}
+	}
+}
+
+//Up to a packet's worth of rays, each hit cleared before the cast
+void GameWorld::RaycastPacket(const Ray* rays, int rayCount, RayCollision* hits, bool closestObject) const {
+	RayPacket packet;
+	for (int i = 0; i < RayPacket::Size; ++i) {
+		const Ray& r = rays[std::min(i, rayCount - 1)]; //unused lanes copy the last ray, but stay inactive
+		packet.SetRay(i, r.GetPosition(), r.GetDirection(), FLT_MAX);
+		if (i < rayCount) {
+			hits[i] = RayCollision();
+		}
+	}
+	packet.activeRays = (1u << rayCount) - 1;
+
+	raycastTree.RayCast(packet, [&](int proxy, unsigned int packetHits) {
+		GameObject* object = raycastTree.GetObject(proxy);
+		for (int i = 0; i < rayCount; ++i) {
+			if (!(packetHits & (1u << i))) {
+				continue;
+			}
+			RayCollision thisCollision;
+			if (!CollisionDetection::RayIntersection(rays[i], *object, thisCollision)) {
+				continue;
+			}
+			if (!closestObject) { //any hit will do, so this ray's finished
+				hits[i]			= thisCollision;
+				hits[i].node	= object;
+				packet.activeRays &= ~(1u << i);
 			}
-			else {
-				if (thisCollision.rayDistance < collision.rayDistance) {
-					thisCollision.node = i;
-					collision = thisCollision;
-				}
+			else if (thisCollision.rayDistance < hits[i].rayDistance) {
+				hits[i]			= thisCollision;
+				hits[i].node	= object;
+				packet.maxDistance[i] = thisCollision.rayDistance;
 			}
 		}
+	});
+}
+
+//Shapes are swept until they're this close to what they hit
+const float SHAPECAST_TARGET_DISTANCE = 0.001f;
+
+bool GameWorld::SphereCast(const Ray& r, float radius, float maxDistance, RayCollision& hit, unsigned int layerMask) const {
+	SphereVolume volume(radius);
+	Transform transform;
+	transform.SetPosition(r.GetPosition());
+	return ShapeCast((const CollisionVolume&)volume, transform, r.GetDirection(), maxDistance, hit, layerMask);
+}
+
+bool GameWorld::BoxCast(const Ray& r, const Vector3& halfSizes, const Quaternion& orientation, float maxDistance, RayCollision& hit, unsigned int layerMask) const {
+	OBBVolume volume(halfSizes);
+	Transform transform;
+	transform.SetPosition(r.GetPosition());
+	transform.SetOrientation(orientation);
+	return ShapeCast((const CollisionVolume&)volume, transform, r.GetDirection(), maxDistance, hit, layerMask);
+}
+
+bool GameWorld::CapsuleCast(const Ray& r, float halfHeight, float radius, const Quaternion& orientation, float maxDistance, RayCollision& hit, unsigned int layerMask) const {
+	CapsuleVolume volume(halfHeight, radius);
+	Transform transform;
+	transform.SetPosition(r.GetPosition());
+	transform.SetOrientation(orientation);
+	return ShapeCast(volume, transform, r.GetDirection(), maxDistance, hit, layerMask);
+}
+
+int GameWorld::OverlapSphere(const Vector3& position, float radius, GameObject** results, int maxResults, unsigned int layerMask) const {
+	SphereVolume volume(radius);
+	Transform transform;
+	transform.SetPosition(position);
+	return Overlap((const CollisionVolume&)volume, transform, results, maxResults, layerMask);
+}
+
+int GameWorld::OverlapAABB(const Vector3& position, const Vector3& halfSizes, GameObject** results, int maxResults, unsigned int layerMask) const {
+	AABBVolume volume(halfSizes);
+	Transform transform;
+	transform.SetPosition(position);
+	return Overlap((const CollisionVolume&)volume, transform, results, maxResults, layerMask);
+}
+
+int GameWorld::OverlapOBB(const Vector3& position, const Vector3& halfSizes, const Quaternion& orientation, GameObject** results, int maxResults, unsigned int layerMask) const {
+	OBBVolume volume(halfSizes);
+	Transform transform;
+	transform.SetPosition(position);
+	transform.SetOrientation(orientation);
+	return Overlap((const CollisionVolume&)volume, transform, results, maxResults, layerMask);
+}
+
+/*
+The shape's swept along the ray, so only the objects whose boxes in the
+tree touch the box around the whole sweep need looking at. Each of those
+is swept against properly using conservative advancement - the same as
+the physics uses for bullets - and the earliest hit wins.
+*/
+bool GameWorld::ShapeCast(const CollisionVolume& volume, const Transform& transform, const Vector3& direction, float maxDistance,
+	RayCollision& hit, unsigned int layerMask) const {
+	UpdateRaycastTree();
+
+	Vector3 start		= transform.GetPosition();
+	Vector3 motion		= direction * maxDistance;
+	Vector3 end			= start + motion;
+	Vector3 halfSizes	= CollisionDetection::ConvexBounds(volume, transform);
+	Vector3 boxMin;
+	Vector3 boxMax;
+	for (int i = 0; i < 3; ++i) {
+		boxMin[i] = std::min(start[i], end[i]) - halfSizes[i];
+		boxMax[i] = std::max(start[i], end[i]) + halfSizes[i];
 	}
-	if (collision.node) {
-		closestCollision		= collision;
-		closestCollision.node	= collision.node;
-		return true;
+
+	GameObject* hitObject	= nullptr;
+	float		firstHit	= 1.0f;
+	raycastTree.Query(boxMin, boxMax, [&](int proxy) {
+		GameObject* object = raycastTree.GetObject(proxy);
+		const CollisionVolume* objectVolume = object->GetBoundingVolume();
+		if (!(layerMask & LayerBit(object->GetCollisionLayer())) || !CollisionDetection::IsConvex(*objectVolume)) {
+			return;
+		}
+		float	toi;
+		Vector3 normal;
+		if (CollisionDetection::ConvexCast(volume, transform, motion, *objectVolume, object->GetTransform(), SHAPECAST_TARGET_DISTANCE, toi, normal)
+			&& (!hitObject || toi < firstHit)) {
+			hitObject	= object;
+			firstHit	= toi;
+		}
+	});
+	if (!hitObject) {
+		return false;
 	}
-	return false;
+	hit.node		= hitObject;
+	hit.rayDistance	= maxDistance * firstHit;
+	hit.collidedAt	= start + motion * firstHit;
+	return true;
+}
+
+/*
+Anything whose box in the tree overlaps the shape's box might be touching
+it, and is then tested properly with GJK. Planes aren't convex, so for
+those their box overlapping is as good as it gets.
+*/
+int GameWorld::Overlap(const CollisionVolume& volume, const Transform& transform, GameObject** results, int maxResults,
+	unsigned int layerMask) const {
+	UpdateRaycastTree();
+
+	Vector3 position	= transform.GetPosition();
+	Vector3 halfSizes	= CollisionDetection::ConvexBounds(volume, transform);
+	int		found		= 0;
+
+	raycastTree.Query(position - halfSizes, position + halfSizes, [&](int proxy) {
+		GameObject* object = raycastTree.GetObject(proxy);
+		if (found == maxResults || !(layerMask & LayerBit(object->GetCollisionLayer()))) {
+			return;
+		}
+		const CollisionVolume* objectVolume = object->GetBoundingVolume();
+		bool touching = false;
+		if (CollisionDetection::IsConvex(*objectVolume)) {
+			float	distance;
+			Vector3 normal;
+			touching = !CollisionDetection::ConvexDistance(volume, transform, *objectVolume, object->GetTransform(), distance, normal);
+		}
+		else {
+			Vector3 objectHalfSizes;
+			object->GetBroadphaseAABB(objectHalfSizes);
+			touching = CollisionDetection::AABBTest(position, object->GetTransform().GetPosition(), halfSizes, objectHalfSizes);
+		}
+		if (touching) {
+			results[found++] = object;
+		}
+	});
+	return found;
 }
 
-void GameWorld::UpdateGameObjects(float dt)
-{
-	for (GameObject* object : gameObjects)
-	{
+void GameWorld::SetJobSystem(JobSystem* jobs) {
+	jobSystem = jobs;
+	commandBuffers.resize(jobs ? jobs->GetThreadCount() : 1);
+}
+
+//Which job system thread is running on this thread, so objects can find their command buffer
+static thread_local int updateThreadIndex = 0;
+
+//How many thread safe objects each update job updates at once
+const int UPDATE_CHUNK_SIZE = 8;
+
+void GameWorld::UpdateGameObjects(float dt) {
+	parallelObjects.clear();
+	for (int i = 0; i < gameObjects.Count(); ++i) {
+		GameObject* object = gameObjects[i];
+		if (jobSystem && object->IsThreadSafe()) {
+			parallelObjects.emplace_back(i);
+			continue;
+		}
+		commandBuffers[0].SetOrder(i);
 		object->Update(dt);
 	}
+	if (!parallelObjects.empty()) {
+		UpdateRaycastTree(); //the objects can query it, but can't refresh it, once the job's started
+		jobSystem->ParallelFor((int)parallelObjects.size(), UPDATE_CHUNK_SIZE, [&](int start, int end, int threadIndex) {
+			updateThreadIndex = threadIndex;
+			for (int i = start; i < end; ++i) {
+				commandBuffers[threadIndex].SetOrder(parallelObjects[i]);
+				gameObjects[parallelObjects[i]]->Update(dt);
+			}
+			updateThreadIndex = 0;
+		});
+	}
+	ExecuteCommands();
 }
 
+CommandBuffer& GameWorld::GetCommandBuffer() {
+	return commandBuffers[updateThreadIndex];
+}
+
+/*
+The commands are pulled out of the buffers before any are run, so a
+command that records another (or adds an object that records one in its
+constructor) doesn't pull the rug out from under us - the new ones are
+just run the next time around.
+*/
+void GameWorld::ExecuteCommands() {
+	executingCommands.clear();
+	for (CommandBuffer& buffer : commandBuffers) {
+		std::vector<CommandBuffer::Entry>& entries = buffer.GetEntries();
+		std::move(entries.begin(), entries.end(), std::back_inserter(executingCommands));
+		entries.clear();
+		buffer.SetOrder(INT_MAX); //anything recorded outside of an update goes after the objects' commands
+	}
+	std::stable_sort(executingCommands.begin(), executingCommands.end(),
+		[](const CommandBuffer::Entry& a, const CommandBuffer::Entry& b) {
+			return a.order < b.order;
+		});
+	for (CommandBuffer::Entry& entry : executingCommands) {
+		entry.command(*this);
+	}
+	executingCommands.clear();
+}
 
 /*
 Constraint Tutorial Stuff
@@ -131,4 +462,33 @@ void GameWorld::GetConstraintIterators(
 	std::vector<Constraint*>::const_iterator& last) const {
 	first	= constraints.begin();
 	last	= constraints.end();
-}
\ No newline at end of file
+}
+void GameWorld::SaveSnapshot(WorldSnapshot& snapshot) const {
+	snapshot.objects.resize(gameObjects.Count());
+	for (int i = 0; i < gameObjects.Count(); ++i) {
+		GameObject* o = gameObjects[i];
+		WorldSnapshot::ObjectState& state = snapshot.objects[i];
+
+		state.object		= o;
+		state.handle		= o->GetHandle();
+		state.position		= o->GetTransform().GetPosition();
+		state.orientation	= o->GetTransform().GetOrientation();
+	}
+}
+
+bool GameWorld::RestoreSnapshot(const WorldSnapshot& snapshot) {
+	if ((int)snapshot.objects.size() != gameObjects.Count()) {
+		return false;
+	}
+	for (int i = 0; i < gameObjects.Count(); ++i) {
+		if (gameObjects[i] != snapshot.objects[i].object || gameObjects[i]->GetHandle() != snapshot.objects[i].handle) {
+			return false;
+		}
+	}
+	for (const WorldSnapshot::ObjectState& state : snapshot.objects) {
+		state.object->GetTransform()
+			.SetPosition(state.position)
+			.SetOrientation(state.orientation);
+	}
+	return true;
+}
@@ -3,6 +3,11 @@
 #include "Ray.h"
 #include "CollisionDetection.h"
 #include "QuadTree.h"
+#include "AABBTree.h"
+#include "SlotMap.h"
+#include "CommandBuffer.h"
+#include "RigidBodyStore.h"
+#include "../../Common/JobSystem.h"
 
 namespace NCL {
 		class Camera;
@@ -14,6 +19,22 @@ namespace NCL {
 		typedef std::function<void(GameObject*)> GameObjectFunc;
 		typedef std::vector<GameObject*>::const_iterator GameObjectIterator;
 
+		/*
+		Where every object in the world was when the snapshot was taken, in
+		the order the world stores them. Snapshots are meant to be kept and
+		reused - saving over an old one doesn't allocate anything, as long
+		as the world hasn't grown since.
+		*/
+		struct WorldSnapshot {
+			struct ObjectState {
+				GameObject*			object;
+				GameObjectHandle	handle;
+				Vector3				position;
+				Quaternion			orientation;
+			};
+			std::vector<ObjectState> objects;
+		};
+
 		class GameWorld	{
 		public:
 			GameWorld();
@@ -22,12 +43,55 @@ namespace NCL {
 			void Clear();
 			void ClearAndErase();
 
-			void AddGameObject(GameObject* o);
+			GameObjectHandle AddGameObject(GameObject* o);
+
+			/*
+			Objects aren't taken out of the world straight away, as the physics
+			or another object's update might still be using them this frame.
+			Instead they're removed (and deleted, if andDelete is set) at the
+			start of the next UpdateWorld, so it's safe to remove an object from
+			inside a collision callback, or to remove the same object twice.
+			*/
 			void RemoveGameObject(GameObject* o, bool andDelete = false);
+			void RemoveGameObject(GameObjectHandle handle, bool andDelete = false);
+
+			//Returns nullptr once the object has been removed from the world
+			GameObject* GetGameObject(GameObjectHandle handle) const {
+				GameObject* const* o = gameObjects.Get(handle);
+				return o ? *o : nullptr;
+			}
+
+			int GetGameObjectCount() const {
+				return gameObjects.Count();
+			}
+
+			/*
+			World IDs are only unique among the objects in the world right now -
+			once an object's been removed, the next one added takes its ID.
+			Returns nullptr if no object has the ID.
+			*/
+			GameObject* GetGameObjectByID(int worldID) const {
+				GameObject* const* o = gameObjects.GetInSlot((uint32_t)worldID);
+				return o ? *o : nullptr;
+			}
+
+			//One more than the largest world ID that's ever been used
+			int GetWorldIDCount() const {
+				return (int)gameObjects.GetSlotCount();
+			}
 
 			void AddConstraint(Constraint* c);
 			void RemoveConstraint(Constraint* c, bool andDelete = false);
 
+			//The rigid bodies of every object in the world with a physics object
+			RigidBodyStore& GetBodyStore() {
+				return bodies;
+			}
+
+			const RigidBodyStore& GetBodyStore() const {
+				return bodies;
+			}
+
 			Camera* GetMainCamera() const {
 				return mainCamera;
 			}
@@ -42,9 +106,62 @@ namespace NCL {
 
 			bool Raycast(Ray& r, RayCollision& closestCollision, bool closestObject = false) const;
 
+			/*
+			Casts lots of rays at once - hits[i] is filled in for rays[i], and is
+			left with a null node if it didn't hit anything. The rays are cast
+			through the tree in packets, split across the job system if there is one.
+			*/
+			void RaycastBatch(const Ray* rays, int rayCount, RayCollision* hits, bool closestObject = false) const;
+
+			/*
+			Shape casts sweep a shape along a ray for up to maxDistance, and fill
+			in hit with the first object on one of the layers in layerMask that
+			it would touch. collidedAt is where the shape's centre got to when it
+			hit, and rayDistance how far it travelled. Anything the shape starts
+			off overlapping is hit straight away, at a distance of 0. Objects
+			with planes for volumes can't be swept against, so are ignored.
+			*/
+			bool SphereCast(const Ray& r, float radius, float maxDistance, RayCollision& hit,
+							unsigned int layerMask = ALL_COLLISION_LAYERS) const;
+			bool BoxCast(const Ray& r, const Vector3& halfSizes, const Quaternion& orientation, float maxDistance, RayCollision& hit,
+							unsigned int layerMask = ALL_COLLISION_LAYERS) const;
+			bool CapsuleCast(const Ray& r, float halfHeight, float radius, const Quaternion& orientation, float maxDistance, RayCollision& hit,
+							unsigned int layerMask = ALL_COLLISION_LAYERS) const;
+
+			/*
+			Overlap queries write up to maxResults of the objects touching a
+			shape into results, and return how many there were. Like the casts,
+			only objects on one of the layers in layerMask are included.
+			*/
+			int OverlapSphere(const Vector3& position, float radius, GameObject** results, int maxResults,
+							unsigned int layerMask = ALL_COLLISION_LAYERS) const;
+			int OverlapAABB(const Vector3& position, const Vector3& halfSizes, GameObject** results, int maxResults,
+							unsigned int layerMask = ALL_COLLISION_LAYERS) const;
+			int OverlapOBB(const Vector3& position, const Vector3& halfSizes, const Quaternion& orientation, GameObject** results, int maxResults,
+							unsigned int layerMask = ALL_COLLISION_LAYERS) const;
+
+			void SetJobSystem(JobSystem* jobs);
+
 			virtual void UpdateWorld(float dt);
+
+			/*
+			Updates every object - thread safe ones are spread across the job
+			system, if there is one, and the rest are updated one at a time.
+			Any commands they record are carried out once they're all done.
+
+			A thread safe object's Update can use Raycast, RaycastBatch, and
+			the shape casts and overlap queries, which only read the world
+			from inside a job - the tree they search has the objects where
+			they were before the thread safe objects were updated, so they
+			shouldn't be used to find anything another thread safe object
+			is moving. Nothing else in the world can be changed, other than
+			through the command buffer.
+			*/
 			void UpdateGameObjects(float dt);
 
+			//The command buffer for the calling thread, safe to use from inside an object's Update
+			CommandBuffer& GetCommandBuffer();
+
 			void OperateOnContents(GameObjectFunc f);
 
 			void GetObjectIterators(
@@ -55,15 +172,49 @@ namespace NCL {
 				std::vector<Constraint*>::const_iterator& first,
 				std::vector<Constraint*>::const_iterator& last) const;
 
+			/*
+			Restoring only puts objects back where they were - it can't bring
+			back objects that have been removed since, so it fails (and leaves
+			everything alone) if the world doesn't hold exactly the same
+			objects, in the same order, as when the snapshot was saved.
+			*/
+			void SaveSnapshot(WorldSnapshot& snapshot) const;
+			bool RestoreSnapshot(const WorldSnapshot& snapshot);
+
 		protected:
-			std::vector<GameObject*> gameObjects;
-			std::vector<Constraint*> constraints;
+			void UpdateRaycastTree() const;
+			void RaycastPacket(const Ray* rays, int rayCount, RayCollision* hits, bool closestObject) const;
+
+			bool ShapeCast(const CollisionVolume& volume, const Transform& transform, const Vector3& direction, float maxDistance,
+							RayCollision& hit, unsigned int layerMask) const;
+			int Overlap(const CollisionVolume& volume, const Transform& transform, GameObject** results, int maxResults,
+							unsigned int layerMask) const;
+
+			void DestroyRemovedObjects();
+			void ExecuteCommands();
+
+			struct PendingRemoval {
+				GameObjectHandle	handle;
+				bool				andDelete;
+			};
+
+			SlotMap<GameObject*>		gameObjects;
+			std::vector<PendingRemoval>	pendingRemovals;
+			std::vector<Constraint*>	constraints;
+			RigidBodyStore				bodies;
 
 			Camera* mainCamera;
 
 			bool	shuffleConstraints;
 			bool	shuffleObjects;
-			int		worldIDCounter;
+
+			//Every object with a volume, refreshed before each raycast as objects move around (other than from inside a job)
+			mutable AABBTree<GameObject*>	raycastTree;
+			JobSystem*						jobSystem;
+
+			std::vector<CommandBuffer>			commandBuffers; //one per job system thread
+			std::vector<CommandBuffer::Entry>	executingCommands;
+			std::vector<int>					parallelObjects;
 		};
 	}
 }
@@ -45,8 +45,12 @@ void HingeConstraint::ApplyAngularImpulse(PhysicsObject* physA, PhysicsObject* p
 	float dC1 = Vector3::Dot(J1, rAngularVelocity);
 	float dC2 = Vector3::Dot(J2, rAngularVelocity);
 
-	physA->UpdateInertiaTensor();
-	physB->UpdateInertiaTensor();
+	if (physA->GetInverseMass() > 0.0f) { //static objects may be shared between islands
+		physA->UpdateInertiaTensor();
+	}
+	if (physB->GetInverseMass() > 0.0f) {
+		physB->UpdateInertiaTensor();
+	}
 
 	Vector3 invInertia = physA->GetInertia() + physB->GetInertia();
 	
@@ -18,6 +18,13 @@ namespace NCL {
 			~HingeConstraint() {};
 
 			void UpdateConstraint(float dt) override;
+
+			GameObject* GetObjectA() const override {
+				return objectA;
+			}
+			GameObject* GetObjectB() const override {
+				return objectB;
+			}
 			void ApplyAngularImpulse(PhysicsObject* physA, PhysicsObject* physB, const Vector3& w1, const Vector3& u2, const Vector3& v2, float dt);
 
 		protected:
@@ -0,0 +1,478 @@
+#include "IntegrationKernels.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define USE_X86_KERNELS
+#endif
+
+#ifdef USE_X86_KERNELS
+#ifdef _MSC_VER
+#include <intrin.h>
+//MSVC lets any function use any intrinsic, so there's nothing to switch on
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+//Compile just these functions for the newer instruction sets, the rest of the program doesn't need them
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace NCL;
+using namespace CSC8503;
+
+IntegrationKernels::InstructionSet IntegrationKernels::instructionSet = IntegrationKernels::DetectInstructionSet();
+
+#ifdef USE_X86_KERNELS
+static void CPUID(int leaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuidex(info, leaf, 0);
+	for (int i = 0; i < 4; ++i) {
+		regs[i] = (unsigned int)info[i];
+	}
+#else
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//Which register sets the OS saves when switching threads - no point using AVX if it doesn't save the YMM registers!
+static unsigned long long XGETBV() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+IntegrationKernels::InstructionSet IntegrationKernels::DetectInstructionSet() {
+#ifdef USE_X86_KERNELS
+	unsigned int regs[4];
+	CPUID(0, regs);
+	unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 1) {
+		return InstructionSet::Scalar;
+	}
+	CPUID(1, regs);
+	bool sse41		= (regs[2] & (1 << 19)) != 0;
+	bool osxsave	= (regs[2] & (1 << 27)) != 0;
+	bool avx		= (regs[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osxsave && avx && (XGETBV() & 0x6) == 0x6) {
+		CPUID(7, regs);
+		avx2 = (regs[1] & (1 << 5)) != 0;
+	}
+	if (avx2) {
+		return InstructionSet::AVX2;
+	}
+	if (sse41) {
+		return InstructionSet::SSE41;
+	}
+#endif
+	return InstructionSet::Scalar;
+}
+
+IntegrationKernels::InstructionSet IntegrationKernels::GetInstructionSet() {
+	return instructionSet;
+}
+
+void IntegrationKernels::SetInstructionSet(InstructionSet set) {
+	InstructionSet best = DetectInstructionSet();
+	instructionSet = (int)set > (int)best ? best : set;
+}
+
+const char* IntegrationKernels::GetInstructionSetName(InstructionSet set) {
+	switch (set) {
+		case InstructionSet::AVX2:	return "AVX2";
+		case InstructionSet::SSE41:	return "SSE4.1";
+		default:					return "Scalar";
+	}
+}
+
+void IntegrationKernels::IntegrateLinearAccelScalar(RigidBodyStore& bodies, int start, int end, const Vector3& gravityStep, float dt) {
+	const float* inverseMass = bodies.inverseMasses.data();
+	const float* forceX	= bodies.forces.x.data();
+	const float* forceY	= bodies.forces.y.data();
+	const float* forceZ	= bodies.forces.z.data();
+	float* velX			= bodies.linearVelocities.x.data();
+	float* velY			= bodies.linearVelocities.y.data();
+	float* velZ			= bodies.linearVelocities.z.data();
+	const char* asleep	= bodies.sleeping.data();
+
+	for (int i = start; i < end; ++i) {
+		float step		= asleep[i] ? 0.0f : dt;
+		float gravStep	= (asleep[i] || inverseMass[i] == 0.0f) ? 0.0f : 1.0f; // don't move infinitely heavy things
+
+		velX[i] += forceX[i] * inverseMass[i] * step + gravityStep.x * gravStep;
+		velY[i] += forceY[i] * inverseMass[i] * step + gravityStep.y * gravStep;
+		velZ[i] += forceZ[i] * inverseMass[i] * step + gravityStep.z * gravStep;
+	}
+}
+
+void IntegrationKernels::IntegrateVelocityScalar(RigidBodyStore& bodies, int start, int end, const VelocityParams& params) {
+	float* posX			= bodies.positions.x.data();
+	float* posY			= bodies.positions.y.data();
+	float* posZ			= bodies.positions.z.data();
+	float* velX			= bodies.linearVelocities.x.data();
+	float* velY			= bodies.linearVelocities.y.data();
+	float* velZ			= bodies.linearVelocities.z.data();
+	float* angX			= bodies.angularVelocities.x.data();
+	float* angY			= bodies.angularVelocities.y.data();
+	float* angZ			= bodies.angularVelocities.z.data();
+	float* qx			= bodies.orientations.x.data();
+	float* qy			= bodies.orientations.y.data();
+	float* qz			= bodies.orientations.z.data();
+	float* qw			= bodies.orientations.w.data();
+	float* sleepTime	= bodies.sleepTimes.data();
+	const char* asleep	= bodies.sleeping.data();
+
+	const float dt		= params.dt;
+	const float halfDt	= dt * 0.5f;
+
+	for (int i = start; i < end; ++i) {
+		if (asleep[i]) {
+			continue;
+		}
+		//position stuff
+		posX[i] += velX[i] * dt;
+		posY[i] += velY[i] * dt;
+		posZ[i] += velZ[i] * dt;
+		//linear damping
+		velX[i] *= params.linearDamping;
+		velY[i] *= params.linearDamping;
+		velZ[i] *= params.linearDamping;
+
+		//orientation += Quaternion(angVel * dt * 0.5f, 0.0f) * orientation
+		float hx = angX[i] * halfDt;
+		float hy = angY[i] * halfDt;
+		float hz = angZ[i] * halfDt;
+
+		float x = qx[i] + (hx * qw[i]) + (hy * qz[i]) - (hz * qy[i]);
+		float y = qy[i] + (hy * qw[i]) + (hz * qx[i]) - (hx * qz[i]);
+		float z = qz[i] + (hz * qw[i]) + (hx * qy[i]) - (hy * qx[i]);
+		float w = qw[i] - (hx * qx[i]) - (hy * qy[i]) - (hz * qz[i]);
+
+		float length = std::sqrt(x * x + y * y + z * z + w * w);
+		float scale	 = length > 0.0f ? 1.0f / length : 1.0f;
+		qx[i] = x * scale;
+		qy[i] = y * scale;
+		qz[i] = z * scale;
+		qw[i] = w * scale;
+
+		//damp the angular velocity too
+		angX[i] *= params.angularDamping;
+		angY[i] *= params.angularDamping;
+		angZ[i] *= params.angularDamping;
+
+		float linearSq	= velX[i] * velX[i] + velY[i] * velY[i] + velZ[i] * velZ[i];
+		float angularSq = angX[i] * angX[i] + angY[i] * angY[i] + angZ[i] * angZ[i];
+		sleepTime[i] = (linearSq < params.linearSleepSq && angularSq < params.angularSleepSq) ? sleepTime[i] + dt : 0.0f;
+	}
+}
+
+#ifdef USE_X86_KERNELS
+/*
+The SIMD versions below are line for line the same as the scalar ones
+above, just with 4 or 8 bodies in each register. Rather than skipping
+sleeping bodies, they work out the new state for every body, and then
+blend the old state back in for the lanes that are asleep.
+
+Each returns how far it got, and the scalar version finishes off the
+last few bodies that don't fill a whole register.
+*/
+TARGET_SSE41 static __m128 AwakeMask4(const char* asleep) {
+	int packed;
+	memcpy(&packed, asleep, sizeof(int));
+	__m128i flags = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+	return _mm_castsi128_ps(_mm_cmpeq_epi32(flags, _mm_setzero_si128()));
+}
+
+TARGET_SSE41 static int IntegrateLinearAccelSSE41(RigidBodyStore& bodies, int start, int end, const Vector3& gravityStep, float dt) {
+	const float* inverseMass = bodies.inverseMasses.data();
+	const float* forceX	= bodies.forces.x.data();
+	const float* forceY	= bodies.forces.y.data();
+	const float* forceZ	= bodies.forces.z.data();
+	float* velX			= bodies.linearVelocities.x.data();
+	float* velY			= bodies.linearVelocities.y.data();
+	float* velZ			= bodies.linearVelocities.z.data();
+	const char* asleep	= bodies.sleeping.data();
+
+	const __m128 zero	= _mm_setzero_ps();
+	const __m128 one	= _mm_set1_ps(1.0f);
+	const __m128 dts	= _mm_set1_ps(dt);
+	const __m128 gx		= _mm_set1_ps(gravityStep.x);
+	const __m128 gy		= _mm_set1_ps(gravityStep.y);
+	const __m128 gz		= _mm_set1_ps(gravityStep.z);
+
+	int i = start;
+	for (; i + 4 <= end; i += 4) {
+		__m128 awake	= AwakeMask4(asleep + i);
+		__m128 im		= _mm_loadu_ps(inverseMass + i);
+		__m128 step		= _mm_and_ps(awake, dts);
+		__m128 gravStep = _mm_and_ps(_mm_and_ps(awake, _mm_cmpneq_ps(im, zero)), one);
+
+		_mm_storeu_ps(velX + i, _mm_add_ps(_mm_loadu_ps(velX + i),
+			_mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(forceX + i), im), step), _mm_mul_ps(gx, gravStep))));
+		_mm_storeu_ps(velY + i, _mm_add_ps(_mm_loadu_ps(velY + i),
+			_mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(forceY + i), im), step), _mm_mul_ps(gy, gravStep))));
+		_mm_storeu_ps(velZ + i, _mm_add_ps(_mm_loadu_ps(velZ + i),
+			_mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(forceZ + i), im), step), _mm_mul_ps(gz, gravStep))));
+	}
+	return i;
+}
+
+TARGET_SSE41 static int IntegrateVelocitySSE41(RigidBodyStore& bodies, int start, int end, const IntegrationKernels::VelocityParams& params) {
+	float* posX			= bodies.positions.x.data();
+	float* posY			= bodies.positions.y.data();
+	float* posZ			= bodies.positions.z.data();
+	float* velX			= bodies.linearVelocities.x.data();
+	float* velY			= bodies.linearVelocities.y.data();
+	float* velZ			= bodies.linearVelocities.z.data();
+	float* angX			= bodies.angularVelocities.x.data();
+	float* angY			= bodies.angularVelocities.y.data();
+	float* angZ			= bodies.angularVelocities.z.data();
+	float* qxs			= bodies.orientations.x.data();
+	float* qys			= bodies.orientations.y.data();
+	float* qzs			= bodies.orientations.z.data();
+	float* qws			= bodies.orientations.w.data();
+	float* sleepTime	= bodies.sleepTimes.data();
+	const char* asleep	= bodies.sleeping.data();
+
+	const __m128 zero			= _mm_setzero_ps();
+	const __m128 one			= _mm_set1_ps(1.0f);
+	const __m128 dt				= _mm_set1_ps(params.dt);
+	const __m128 halfDt			= _mm_set1_ps(params.dt * 0.5f);
+	const __m128 linearDamping	= _mm_set1_ps(params.linearDamping);
+	const __m128 angularDamping	= _mm_set1_ps(params.angularDamping);
+	const __m128 linearSleep	= _mm_set1_ps(params.linearSleepSq);
+	const __m128 angularSleep	= _mm_set1_ps(params.angularSleepSq);
+
+	int i = start;
+	for (; i + 4 <= end; i += 4) {
+		__m128 awake = AwakeMask4(asleep + i);
+
+		__m128 px = _mm_loadu_ps(posX + i);
+		__m128 py = _mm_loadu_ps(posY + i);
+		__m128 pz = _mm_loadu_ps(posZ + i);
+		__m128 vx = _mm_loadu_ps(velX + i);
+		__m128 vy = _mm_loadu_ps(velY + i);
+		__m128 vz = _mm_loadu_ps(velZ + i);
+		__m128 ax = _mm_loadu_ps(angX + i);
+		__m128 ay = _mm_loadu_ps(angY + i);
+		__m128 az = _mm_loadu_ps(angZ + i);
+		__m128 qx = _mm_loadu_ps(qxs + i);
+		__m128 qy = _mm_loadu_ps(qys + i);
+		__m128 qz = _mm_loadu_ps(qzs + i);
+		__m128 qw = _mm_loadu_ps(qws + i);
+		__m128 t  = _mm_loadu_ps(sleepTime + i);
+
+		__m128 npx = _mm_add_ps(px, _mm_mul_ps(vx, dt));
+		__m128 npy = _mm_add_ps(py, _mm_mul_ps(vy, dt));
+		__m128 npz = _mm_add_ps(pz, _mm_mul_ps(vz, dt));
+
+		__m128 nvx = _mm_mul_ps(vx, linearDamping);
+		__m128 nvy = _mm_mul_ps(vy, linearDamping);
+		__m128 nvz = _mm_mul_ps(vz, linearDamping);
+
+		__m128 hx = _mm_mul_ps(ax, halfDt);
+		__m128 hy = _mm_mul_ps(ay, halfDt);
+		__m128 hz = _mm_mul_ps(az, halfDt);
+
+		__m128 x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(qx, _mm_mul_ps(hx, qw)), _mm_mul_ps(hy, qz)), _mm_mul_ps(hz, qy));
+		__m128 y = _mm_sub_ps(_mm_add_ps(_mm_add_ps(qy, _mm_mul_ps(hy, qw)), _mm_mul_ps(hz, qx)), _mm_mul_ps(hx, qz));
+		__m128 z = _mm_sub_ps(_mm_add_ps(_mm_add_ps(qz, _mm_mul_ps(hz, qw)), _mm_mul_ps(hx, qy)), _mm_mul_ps(hy, qx));
+		__m128 w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(qw, _mm_mul_ps(hx, qx)), _mm_mul_ps(hy, qy)), _mm_mul_ps(hz, qz));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+		__m128 scale  = _mm_blendv_ps(one, _mm_div_ps(one, length), _mm_cmpgt_ps(length, zero));
+
+		__m128 nax = _mm_mul_ps(ax, angularDamping);
+		__m128 nay = _mm_mul_ps(ay, angularDamping);
+		__m128 naz = _mm_mul_ps(az, angularDamping);
+
+		__m128 linearSq	 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nvx, nvx), _mm_mul_ps(nvy, nvy)), _mm_mul_ps(nvz, nvz));
+		__m128 angularSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nax, nax), _mm_mul_ps(nay, nay)), _mm_mul_ps(naz, naz));
+		__m128 slow		 = _mm_and_ps(_mm_cmplt_ps(linearSq, linearSleep), _mm_cmplt_ps(angularSq, angularSleep));
+		__m128 nt		 = _mm_blendv_ps(zero, _mm_add_ps(t, dt), slow);
+
+		_mm_storeu_ps(posX + i, _mm_blendv_ps(px, npx, awake));
+		_mm_storeu_ps(posY + i, _mm_blendv_ps(py, npy, awake));
+		_mm_storeu_ps(posZ + i, _mm_blendv_ps(pz, npz, awake));
+		_mm_storeu_ps(velX + i, _mm_blendv_ps(vx, nvx, awake));
+		_mm_storeu_ps(velY + i, _mm_blendv_ps(vy, nvy, awake));
+		_mm_storeu_ps(velZ + i, _mm_blendv_ps(vz, nvz, awake));
+		_mm_storeu_ps(qxs + i, _mm_blendv_ps(qx, _mm_mul_ps(x, scale), awake));
+		_mm_storeu_ps(qys + i, _mm_blendv_ps(qy, _mm_mul_ps(y, scale), awake));
+		_mm_storeu_ps(qzs + i, _mm_blendv_ps(qz, _mm_mul_ps(z, scale), awake));
+		_mm_storeu_ps(qws + i, _mm_blendv_ps(qw, _mm_mul_ps(w, scale), awake));
+		_mm_storeu_ps(angX + i, _mm_blendv_ps(ax, nax, awake));
+		_mm_storeu_ps(angY + i, _mm_blendv_ps(ay, nay, awake));
+		_mm_storeu_ps(angZ + i, _mm_blendv_ps(az, naz, awake));
+		_mm_storeu_ps(sleepTime + i, _mm_blendv_ps(t, nt, awake));
+	}
+	return i;
+}
+
+TARGET_AVX2 static __m256 AwakeMask8(const char* asleep) {
+	__m128i packed = _mm_loadl_epi64((const __m128i*)asleep);
+	__m256i flags  = _mm256_cvtepu8_epi32(packed);
+	return _mm256_castsi256_ps(_mm256_cmpeq_epi32(flags, _mm256_setzero_si256()));
+}
+
+TARGET_AVX2 static int IntegrateLinearAccelAVX2(RigidBodyStore& bodies, int start, int end, const Vector3& gravityStep, float dt) {
+	const float* inverseMass = bodies.inverseMasses.data();
+	const float* forceX	= bodies.forces.x.data();
+	const float* forceY	= bodies.forces.y.data();
+	const float* forceZ	= bodies.forces.z.data();
+	float* velX			= bodies.linearVelocities.x.data();
+	float* velY			= bodies.linearVelocities.y.data();
+	float* velZ			= bodies.linearVelocities.z.data();
+	const char* asleep	= bodies.sleeping.data();
+
+	const __m256 zero	= _mm256_setzero_ps();
+	const __m256 one	= _mm256_set1_ps(1.0f);
+	const __m256 dts	= _mm256_set1_ps(dt);
+	const __m256 gx		= _mm256_set1_ps(gravityStep.x);
+	const __m256 gy		= _mm256_set1_ps(gravityStep.y);
+	const __m256 gz		= _mm256_set1_ps(gravityStep.z);
+
+	int i = start;
+	for (; i + 8 <= end; i += 8) {
+		__m256 awake	= AwakeMask8(asleep + i);
+		__m256 im		= _mm256_loadu_ps(inverseMass + i);
+		__m256 step		= _mm256_and_ps(awake, dts);
+		__m256 gravStep = _mm256_and_ps(_mm256_and_ps(awake, _mm256_cmp_ps(im, zero, _CMP_NEQ_UQ)), one);
+
+		_mm256_storeu_ps(velX + i, _mm256_add_ps(_mm256_loadu_ps(velX + i),
+			_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(forceX + i), im), step), _mm256_mul_ps(gx, gravStep))));
+		_mm256_storeu_ps(velY + i, _mm256_add_ps(_mm256_loadu_ps(velY + i),
+			_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(forceY + i), im), step), _mm256_mul_ps(gy, gravStep))));
+		_mm256_storeu_ps(velZ + i, _mm256_add_ps(_mm256_loadu_ps(velZ + i),
+			_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(forceZ + i), im), step), _mm256_mul_ps(gz, gravStep))));
+	}
+	return i;
+}
+
+TARGET_AVX2 static int IntegrateVelocityAVX2(RigidBodyStore& bodies, int start, int end, const IntegrationKernels::VelocityParams& params) {
+	float* posX			= bodies.positions.x.data();
+	float* posY			= bodies.positions.y.data();
+	float* posZ			= bodies.positions.z.data();
+	float* velX			= bodies.linearVelocities.x.data();
+	float* velY			= bodies.linearVelocities.y.data();
+	float* velZ			= bodies.linearVelocities.z.data();
+	float* angX			= bodies.angularVelocities.x.data();
+	float* angY			= bodies.angularVelocities.y.data();
+	float* angZ			= bodies.angularVelocities.z.data();
+	float* qxs			= bodies.orientations.x.data();
+	float* qys			= bodies.orientations.y.data();
+	float* qzs			= bodies.orientations.z.data();
+	float* qws			= bodies.orientations.w.data();
+	float* sleepTime	= bodies.sleepTimes.data();
+	const char* asleep	= bodies.sleeping.data();
+
+	const __m256 zero			= _mm256_setzero_ps();
+	const __m256 one			= _mm256_set1_ps(1.0f);
+	const __m256 dt				= _mm256_set1_ps(params.dt);
+	const __m256 halfDt			= _mm256_set1_ps(params.dt * 0.5f);
+	const __m256 linearDamping	= _mm256_set1_ps(params.linearDamping);
+	const __m256 angularDamping	= _mm256_set1_ps(params.angularDamping);
+	const __m256 linearSleep	= _mm256_set1_ps(params.linearSleepSq);
+	const __m256 angularSleep	= _mm256_set1_ps(params.angularSleepSq);
+
+	int i = start;
+	for (; i + 8 <= end; i += 8) {
+		__m256 awake = AwakeMask8(asleep + i);
+
+		__m256 px = _mm256_loadu_ps(posX + i);
+		__m256 py = _mm256_loadu_ps(posY + i);
+		__m256 pz = _mm256_loadu_ps(posZ + i);
+		__m256 vx = _mm256_loadu_ps(velX + i);
+		__m256 vy = _mm256_loadu_ps(velY + i);
+		__m256 vz = _mm256_loadu_ps(velZ + i);
+		__m256 ax = _mm256_loadu_ps(angX + i);
+		__m256 ay = _mm256_loadu_ps(angY + i);
+		__m256 az = _mm256_loadu_ps(angZ + i);
+		__m256 qx = _mm256_loadu_ps(qxs + i);
+		__m256 qy = _mm256_loadu_ps(qys + i);
+		__m256 qz = _mm256_loadu_ps(qzs + i);
+		__m256 qw = _mm256_loadu_ps(qws + i);
+		__m256 t  = _mm256_loadu_ps(sleepTime + i);
+
+		__m256 npx = _mm256_add_ps(px, _mm256_mul_ps(vx, dt));
+		__m256 npy = _mm256_add_ps(py, _mm256_mul_ps(vy, dt));
+		__m256 npz = _mm256_add_ps(pz, _mm256_mul_ps(vz, dt));
+
+		__m256 nvx = _mm256_mul_ps(vx, linearDamping);
+		__m256 nvy = _mm256_mul_ps(vy, linearDamping);
+		__m256 nvz = _mm256_mul_ps(vz, linearDamping);
+
+		__m256 hx = _mm256_mul_ps(ax, halfDt);
+		__m256 hy = _mm256_mul_ps(ay, halfDt);
+		__m256 hz = _mm256_mul_ps(az, halfDt);
+
+		__m256 x = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(qx, _mm256_mul_ps(hx, qw)), _mm256_mul_ps(hy, qz)), _mm256_mul_ps(hz, qy));
+		__m256 y = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(qy, _mm256_mul_ps(hy, qw)), _mm256_mul_ps(hz, qx)), _mm256_mul_ps(hx, qz));
+		__m256 z = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(qz, _mm256_mul_ps(hz, qw)), _mm256_mul_ps(hx, qy)), _mm256_mul_ps(hy, qx));
+		__m256 w = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(qw, _mm256_mul_ps(hx, qx)), _mm256_mul_ps(hy, qy)), _mm256_mul_ps(hz, qz));
+
+		__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)), _mm256_mul_ps(w, w)));
+		__m256 scale  = _mm256_blendv_ps(one, _mm256_div_ps(one, length), _mm256_cmp_ps(length, zero, _CMP_GT_OQ));
+
+		__m256 nax = _mm256_mul_ps(ax, angularDamping);
+		__m256 nay = _mm256_mul_ps(ay, angularDamping);
+		__m256 naz = _mm256_mul_ps(az, angularDamping);
+
+		__m256 linearSq	 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nvx, nvx), _mm256_mul_ps(nvy, nvy)), _mm256_mul_ps(nvz, nvz));
+		__m256 angularSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nax, nax), _mm256_mul_ps(nay, nay)), _mm256_mul_ps(naz, naz));
+		__m256 slow		 = _mm256_and_ps(_mm256_cmp_ps(linearSq, linearSleep, _CMP_LT_OQ), _mm256_cmp_ps(angularSq, angularSleep, _CMP_LT_OQ));
+		__m256 nt		 = _mm256_blendv_ps(zero, _mm256_add_ps(t, dt), slow);
+
+		_mm256_storeu_ps(posX + i, _mm256_blendv_ps(px, npx, awake));
+		_mm256_storeu_ps(posY + i, _mm256_blendv_ps(py, npy, awake));
+		_mm256_storeu_ps(posZ + i, _mm256_blendv_ps(pz, npz, awake));
+		_mm256_storeu_ps(velX + i, _mm256_blendv_ps(vx, nvx, awake));
+		_mm256_storeu_ps(velY + i, _mm256_blendv_ps(vy, nvy, awake));
+		_mm256_storeu_ps(velZ + i, _mm256_blendv_ps(vz, nvz, awake));
+		_mm256_storeu_ps(qxs + i, _mm256_blendv_ps(qx, _mm256_mul_ps(x, scale), awake));
+		_mm256_storeu_ps(qys + i, _mm256_blendv_ps(qy, _mm256_mul_ps(y, scale), awake));
+		_mm256_storeu_ps(qzs + i, _mm256_blendv_ps(qz, _mm256_mul_ps(z, scale), awake));
+		_mm256_storeu_ps(qws + i, _mm256_blendv_ps(qw, _mm256_mul_ps(w, scale), awake));
+		_mm256_storeu_ps(angX + i, _mm256_blendv_ps(ax, nax, awake));
+		_mm256_storeu_ps(angY + i, _mm256_blendv_ps(ay, nay, awake));
+		_mm256_storeu_ps(angZ + i, _mm256_blendv_ps(az, naz, awake));
+		_mm256_storeu_ps(sleepTime + i, _mm256_blendv_ps(t, nt, awake));
+	}
+	return i;
+}
+#endif
+
+void IntegrationKernels::IntegrateLinearAccel(RigidBodyStore& bodies, int start, int end, const Vector3& gravityStep, float dt) {
+#ifdef USE_X86_KERNELS
+	if (instructionSet == InstructionSet::AVX2) {
+		start = IntegrateLinearAccelAVX2(bodies, start, end, gravityStep, dt);
+	}
+	else if (instructionSet == InstructionSet::SSE41) {
+		start = IntegrateLinearAccelSSE41(bodies, start, end, gravityStep, dt);
+	}
+#endif
+	IntegrateLinearAccelScalar(bodies, start, end, gravityStep, dt);
+}
+
+void IntegrationKernels::IntegrateVelocity(RigidBodyStore& bodies, int start, int end, const VelocityParams& params) {
+#ifdef USE_X86_KERNELS
+	if (instructionSet == InstructionSet::AVX2) {
+		start = IntegrateVelocityAVX2(bodies, start, end, params);
+	}
+	else if (instructionSet == InstructionSet::SSE41) {
+		start = IntegrateVelocitySSE41(bodies, start, end, params);
+	}
+#endif
+	IntegrateVelocityScalar(bodies, start, end, params);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "RigidBodyStore.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		The integration loops from the physics system, written out once per
+		instruction set so that SSE4.1 can step 4 bodies at a time, and AVX2
+		8 at a time. Which one gets used is worked out from the CPU when the
+		program starts, falling back to the plain C++ version when
+		neither is available (or on a CPU that isn't x86 at all).
+
+		Every version does exactly the same float operations, in the same
+		order, as the scalar one - there's no fused multiply-adds or
+		reciprocal estimates - so they all give bit-identical results, and
+		switching between them can't change what happens in the game.
+
+		Each kernel works on a range of bodies, so they can be handed out to
+		the job system in chunks. Sleeping bodies are left untouched.
+		*/
+		class IntegrationKernels {
+		public:
+			enum class InstructionSet {
+				Scalar,
+				SSE41,
+				AVX2
+			};
+
+			struct VelocityParams {
+				float dt;
+				float linearDamping;	//velocities are multiplied by these each step
+				float angularDamping;
+				float linearSleepSq;	//bodies slower than both of these build up sleep time
+				float angularSleepSq;
+			};
+
+			//The best instruction set this CPU (and OS) supports
+			static InstructionSet DetectInstructionSet();
+
+			static InstructionSet GetInstructionSet();
+			//Anything the CPU can't run is clamped down to what it can
+			static void SetInstructionSet(InstructionSet set);
+
+			static const char* GetInstructionSetName(InstructionSet set);
+
+			//vel += force * inverseMass * dt + gravityStep, for every body with mass
+			static void IntegrateLinearAccel(RigidBodyStore& bodies, int start, int end, const Vector3& gravityStep, float dt);
+
+			//pos += vel * dt, orientation += angVel * dt, then damping and sleep timers
+			static void IntegrateVelocity(RigidBodyStore& bodies, int start, int end, const VelocityParams& params);
+
+		protected:
+			static void IntegrateLinearAccelScalar(RigidBodyStore& bodies, int start, int end, const Vector3& gravityStep, float dt);
+			static void IntegrateVelocityScalar(RigidBodyStore& bodies, int start, int end, const VelocityParams& params);
+
+			static InstructionSet instructionSet;
+		};
+	}
+}
@@ -0,0 +1,191 @@
+#include "MeshVolume.h"
+#include "../../Common/MeshGeometry.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <set>
+
+using namespace NCL;
+using namespace NCL::Maths;
+
+const float HULL_TOLERANCE = 0.0001f; //points closer to a face than this, relative to the mesh size, are inside it
+
+MeshVolume::MeshVolume(const MeshGeometry& mesh, const Vector3& scale) {
+	type = VolumeType::Mesh;
+
+	std::vector<Vector3> points(mesh.GetPositionData());
+	for (Vector3& p : points) {
+		p = p * scale;
+	}
+	BuildHull(points);
+}
+
+MeshVolume::MeshVolume(const std::vector<Vector3>& points) {
+	type = VolumeType::Mesh;
+	BuildHull(points);
+}
+
+Vector3 MeshVolume::GetSupportPoint(const Vector3& localDirection) const {
+	Vector3 best;
+	float bestDistance = -FLT_MAX;
+	for (const Vector3& p : hullPoints) {
+		float distance = Vector3::Dot(p, localDirection);
+		if (distance > bestDistance) {
+			bestDistance	= distance;
+			best			= p;
+		}
+	}
+	return best;
+}
+
+namespace {
+	struct HullFace {
+		int		v[3];
+		Vector3 normal;
+		float	distance;
+	};
+
+	HullFace MakeHullFace(const std::vector<Vector3>& points, int a, int b, int c) {
+		HullFace face;
+		face.v[0] = a;
+		face.v[1] = b;
+		face.v[2] = c;
+		face.normal		= Vector3::Cross(points[b] - points[a], points[c] - points[a]).Normalised();
+		face.distance	= Vector3::Dot(face.normal, points[a]);
+		return face;
+	}
+}
+
+/*
+An incremental hull - start with a tetrahedron from the mesh's extreme
+points, then add each point outside of it, throwing away every face the
+point can see and stitching the hole's edges to the new point. If the
+mesh is flat (a plane, a quad...) there's no tetrahedron to start from,
+so every point is kept instead, which GJK is just as happy with.
+*/
+void MeshVolume::BuildHull(const std::vector<Vector3>& points) {
+	hullPoints.clear();
+	halfSizes = Vector3();
+
+	if (points.empty()) {
+		return;
+	}
+
+	Vector3 minPoint = points[0];
+	Vector3 maxPoint = points[0];
+	for (const Vector3& p : points) {
+		for (int i = 0; i < 3; ++i) {
+			minPoint[i] = std::min(minPoint[i], p[i]);
+			maxPoint[i] = std::max(maxPoint[i], p[i]);
+		}
+	}
+	for (int i = 0; i < 3; ++i) {
+		halfSizes[i] = std::max(std::abs(minPoint[i]), std::abs(maxPoint[i]));
+	}
+
+	float tolerance = (maxPoint - minPoint).Length() * HULL_TOLERANCE;
+
+	//the starting tetrahedron - the lowest point, the point furthest from it,
+	//the point furthest from the line between them, and the point furthest from that triangle
+	int start[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < (int)points.size(); ++i) {
+		if (points[i].x < points[start[0]].x) {
+			start[0] = i;
+		}
+	}
+	float best = 0.0f;
+	for (int i = 0; i < (int)points.size(); ++i) {
+		float d = (points[i] - points[start[0]]).LengthSquared();
+		if (d > best) {
+			best		= d;
+			start[1]	= i;
+		}
+	}
+	Vector3 line = (points[start[1]] - points[start[0]]).Normalised();
+	best = 0.0f;
+	for (int i = 0; i < (int)points.size(); ++i) {
+		float d = Vector3::Cross(points[i] - points[start[0]], line).LengthSquared();
+		if (d > best) {
+			best		= d;
+			start[2]	= i;
+		}
+	}
+	Vector3 planeNormal = Vector3::Cross(points[start[1]] - points[start[0]], points[start[2]] - points[start[0]]).Normalised();
+	best = 0.0f;
+	for (int i = 0; i < (int)points.size(); ++i) {
+		float d = std::abs(Vector3::Dot(points[i] - points[start[0]], planeNormal));
+		if (d > best) {
+			best		= d;
+			start[3]	= i;
+		}
+	}
+
+	if (best <= tolerance || start[1] == start[0] || start[2] == start[0] || start[2] == start[1]) {
+		hullPoints = points; //flat, or a line, or a point
+		return;
+	}
+
+	std::vector<HullFace> faces;
+	if (Vector3::Dot(points[start[3]] - points[start[0]], planeNormal) > 0.0f) {
+		std::swap(start[1], start[2]); //keep every face wound so its normal points outwards
+	}
+	faces.push_back(MakeHullFace(points, start[0], start[1], start[2]));
+	faces.push_back(MakeHullFace(points, start[0], start[3], start[1]));
+	faces.push_back(MakeHullFace(points, start[1], start[3], start[2]));
+	faces.push_back(MakeHullFace(points, start[2], start[3], start[0]));
+
+	std::vector<bool>					visible;
+	std::set<std::pair<int, int>>		visibleEdges;
+	std::vector<std::pair<int, int>>	horizon;
+
+	for (int i = 0; i < (int)points.size(); ++i) {
+		const Vector3& p = points[i];
+
+		visible.assign(faces.size(), false);
+		bool outside = false;
+		for (size_t f = 0; f < faces.size(); ++f) {
+			if (Vector3::Dot(faces[f].normal, p) - faces[f].distance > tolerance) {
+				visible[f]	= true;
+				outside		= true;
+			}
+		}
+		if (!outside) {
+			continue;
+		}
+		//the horizon is every edge of a visible face whose neighbour across it can't see the point
+		visibleEdges.clear();
+		for (size_t f = 0; f < faces.size(); ++f) {
+			if (visible[f]) {
+				for (int e = 0; e < 3; ++e) {
+					visibleEdges.insert({ faces[f].v[e], faces[f].v[(e + 1) % 3] });
+				}
+			}
+		}
+		horizon.clear();
+		for (const auto& edge : visibleEdges) {
+			if (visibleEdges.find({ edge.second, edge.first }) == visibleEdges.end()) {
+				horizon.push_back(edge);
+			}
+		}
+		size_t kept = 0;
+		for (size_t f = 0; f < faces.size(); ++f) {
+			if (!visible[f]) {
+				faces[kept++] = faces[f];
+			}
+		}
+		faces.resize(kept);
+		for (const auto& edge : horizon) {
+			faces.push_back(MakeHullFace(points, edge.first, edge.second, i));
+		}
+	}
+
+	std::vector<bool> used(points.size(), false);
+	for (const HullFace& f : faces) {
+		for (int v : f.v) {
+			if (!used[v]) {
+				used[v] = true;
+				hullPoints.push_back(points[v]);
+			}
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "CollisionVolume.h"
+#include "../../Common/Vector3.h"
+#include <vector>
+
+namespace NCL {
+	class MeshGeometry;
+
+	/*
+	Collides as the convex hull of a mesh's vertices - anything concave is
+	treated as if it had been shrink wrapped. Only the vertices that end
+	up on the hull are kept, as they're the only ones that can ever be the
+	furthest point in some direction, which is all GJK wants to know.
+	*/
+	class MeshVolume : CollisionVolume
+	{
+	public:
+		MeshVolume(const MeshGeometry& mesh, const Maths::Vector3& scale = Maths::Vector3(1, 1, 1));
+		MeshVolume(const std::vector<Maths::Vector3>& points);
+		~MeshVolume() {}
+
+		const std::vector<Maths::Vector3>& GetHullPoints() const {
+			return hullPoints;
+		}
+
+		//Half the size of a box around the hull, centred on the object's origin
+		Maths::Vector3 GetHalfDimensions() const {
+			return halfSizes;
+		}
+
+		//The hull point furthest along a direction in the mesh's own space
+		Maths::Vector3 GetSupportPoint(const Maths::Vector3& localDirection) const;
+
+	protected:
+		void BuildHull(const std::vector<Maths::Vector3>& points);
+
+		std::vector<Maths::Vector3> hullPoints;
+		Maths::Vector3 halfSizes;
+	};
+}
@@ -0,0 +1,142 @@
+#pragma once
+//ENet pulls in windows.h, whose min and max macros would break std::min and std::max
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <enet/enet.h>
+#include <map>
+#include <string>
+#include <cstring>
+#include <iostream>
+
+enum BasicNetworkMessages {
+	None,
+	Hello,
+	Message,
+	String_Message,
+	Delta_State,	//1 byte per channel since the last state
+	Full_State,		//Full transform etc
+	Received_State, //received from a client, informs that its received packet n
+	Player_Connected,
+	Player_Disconnected,
+	Shutdown
+};
+
+struct GamePacket {
+	short size;
+	short type;
+
+	GamePacket() {
+		type		= BasicNetworkMessages::None;
+		size		= 0;
+	}
+
+	GamePacket(short type) : GamePacket() {
+		this->type	= type;
+	}
+
+	int GetTotalSize() {
+		return sizeof(GamePacket) + size;
+	}
+};
+
+struct StringPacket : public GamePacket {
+	char	stringData[256];
+
+	StringPacket(const std::string& message) {
+		type		= BasicNetworkMessages::String_Message;
+		size		= (short)message.length();
+
+		memcpy(stringData, message.data(), size);
+	};
+
+	std::string GetStringFromData() {
+		std::string realString(stringData);
+		realString.resize(size);
+		return realString;
+	}
+};
+
+struct NewPlayerPacket : public GamePacket {
+	int playerID;
+	NewPlayerPacket(int p) {
+		type		= BasicNetworkMessages::Player_Connected;
+		playerID	= p;
+		size		= sizeof(int);
+	}
+};
+
+struct PlayerDisconnectPacket : public GamePacket {
+	int playerID;
+	PlayerDisconnectPacket(int p) {
+		type		= BasicNetworkMessages::Player_Disconnected;
+		playerID	= p;
+		size		= sizeof(int);
+	}
+};
+
+//Sent back by a client for every world snapshot it gets, so the server knows what it can send deltas against
+struct SnapshotAckPacket : public GamePacket {
+	unsigned int frame;
+	SnapshotAckPacket(unsigned int f) {
+		type		= BasicNetworkMessages::Received_State;
+		frame		= f;
+		size		= sizeof(unsigned int);
+	}
+};
+
+class PacketReceiver {
+public:
+	virtual void ReceivePacket(int type, GamePacket* payload, int source = -1) = 0;
+};
+
+class NetworkBase	{
+public:
+	static void Initialise();
+	static void Destroy();
+
+	static int GetDefaultPort() {
+		return 1234;
+	}
+
+	void RegisterPacketHandler(int msgID, PacketReceiver* receiver) {
+		packetHandlers.insert(std::make_pair(msgID, receiver));
+	}
+
+	//GamePackets go on the first channel, and world snapshots on the second
+	static const int PACKET_CHANNEL		= 0;
+	static const int SNAPSHOT_CHANNEL	= 1;
+	static const int CHANNEL_COUNT		= 2;
+
+protected:
+	NetworkBase();
+	~NetworkBase();
+
+	bool ProcessPacket(GamePacket* p, int peerID = -1);
+
+	//Anything too short to hold the packet it says it is gets thrown away, rather than read past the end of
+	static bool IsValidPacket(const ENetPacket* packet) {
+		if (packet->dataLength < sizeof(GamePacket)) {
+			return false;
+		}
+		const GamePacket* p = (const GamePacket*)packet->data;
+		return p->size >= 0 && sizeof(GamePacket) + p->size <= packet->dataLength;
+	}
+
+	typedef std::multimap<int, PacketReceiver*>::const_iterator PacketHandlerIterator;
+
+	bool GetPacketHandlers(int msgID, PacketHandlerIterator& first, PacketHandlerIterator& last) const {
+		auto range = packetHandlers.equal_range(msgID);
+
+		if (range.first == packetHandlers.end()) {
+			return false; //no handlers for this message type!
+		}
+		first	= range.first;
+		last	= range.second;
+		return true;
+	}
+
+	ENetHost* netHandle;
+
+	std::multimap<int, PacketReceiver*> packetHandlers;
+};
@@ -0,0 +1,535 @@
+#include "PackedSnapshot.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+Every snapshot starts with a header of whole 32 bit words - so the object
+count can be filled in once they've all been written - followed by the
+objects, packed down to the bit.
+*/
+const uint32_t	SNAPSHOT_MAGIC			= 0x534C434E; //'NCLS'
+const uint32_t	SNAPSHOT_VERSION		= 1;
+const uint32_t	SNAPSHOT_DELTA_FLAG		= 1;
+const size_t	OBJECT_COUNT_OFFSET		= 16;
+const size_t	MIN_HEADER_SIZE			= 20;
+
+//Changes between a baseline and the new value that fit in this many bits are written as the change
+const int SMALL_DELTA_BITS = 10;
+
+//The smallest three components of a unit quaternion can't be bigger than this
+const float SMALLEST_THREE_RANGE = 0.70710678f;
+
+static int BitsFor(uint32_t maxValue) {
+	int bits = 0;
+	while (bits < 32 && (maxValue >> bits) != 0) {
+		bits++;
+	}
+	return bits;
+}
+
+//How many steps of the given precision it takes to cover the range, kept small enough to pack
+static uint32_t StepsFor(float range, float precision) {
+	if (!(range > 0.0f) || !(precision > 0.0f)) {
+		return 0;
+	}
+	double steps = std::ceil((double)range / (double)precision);
+	return (uint32_t)std::min(steps, (double)(1u << 31));
+}
+
+static uint32_t QuantiseRange(float value, float min, float precision, uint32_t maxValue) {
+	if (maxValue == 0) {
+		return 0;
+	}
+	double q = std::floor((double)(value - min) / precision + 0.5);
+	return (uint32_t)std::max(0.0, std::min(q, (double)maxValue));
+}
+
+//Velocities are stored centred on zero, so that a body at rest comes back exactly at rest
+static uint32_t QuantiseSigned(float value, float precision, uint32_t maxValue) {
+	if (maxValue == 0) {
+		return 0;
+	}
+	double q = std::floor((double)value / precision + 0.5);
+	q = std::max(-(double)maxValue, std::min(q, (double)maxValue));
+	return (uint32_t)(q + maxValue);
+}
+
+static float DequantiseSigned(uint32_t value, float precision, uint32_t maxValue) {
+	return (float)((int64_t)value - (int64_t)maxValue) * precision;
+}
+
+bool PackedSnapshotFormat::operator==(const PackedSnapshotFormat& other) const {
+	return	worldMin.x == other.worldMin.x && worldMin.y == other.worldMin.y && worldMin.z == other.worldMin.z &&
+			worldMax.x == other.worldMax.x && worldMax.y == other.worldMax.y && worldMax.z == other.worldMax.z &&
+			positionPrecision	== other.positionPrecision &&
+			maxLinearVelocity	== other.maxLinearVelocity &&
+			linearPrecision		== other.linearPrecision &&
+			maxAngularVelocity	== other.maxAngularVelocity &&
+			angularPrecision	== other.angularPrecision &&
+			orientationBits		== other.orientationBits;
+}
+
+PackedQuantiser::PackedQuantiser(const PackedSnapshotFormat& f) : format(f) {
+	format.orientationBits = std::max(4, std::min(format.orientationBits, 10));
+
+	for (int axis = 0; axis < 3; ++axis) {
+		positionMax[axis]	= StepsFor(format.worldMax[axis] - format.worldMin[axis], format.positionPrecision);
+		positionBits[axis]	= BitsFor(positionMax[axis]);
+	}
+	linearMax		= StepsFor(format.maxLinearVelocity, format.linearPrecision);
+	linearBits		= BitsFor(linearMax * 2);
+	angularMax		= StepsFor(format.maxAngularVelocity, format.angularPrecision);
+	angularBits		= BitsFor(angularMax * 2);
+	orientationBits	= 2 + (format.orientationBits * 3);
+}
+
+/*
+A unit quaternion's largest component can always be worked out from the
+other three, so only those are kept, along with which one was left out.
+q and -q are the same rotation, so the quaternion is flipped if need be
+to make the missing component positive.
+*/
+void PackedQuantiser::Quantise(const PackedObjectState& state, PackedQuantisedState& out) const {
+	out.id			= state.id;
+	out.hasPhysics	= state.hasPhysics;
+	out.asleep		= state.hasPhysics && state.asleep;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		out.position[axis] = QuantiseRange(state.position[axis], format.worldMin[axis], format.positionPrecision, positionMax[axis]);
+	}
+
+	float components[4] = { state.orientation.x, state.orientation.y, state.orientation.z, state.orientation.w };
+	int largest = 0;
+	for (int i = 1; i < 4; ++i) {
+		if (std::abs(components[i]) > std::abs(components[largest])) {
+			largest = i;
+		}
+	}
+	float		sign	= components[largest] < 0.0f ? -1.0f : 1.0f;
+	uint32_t	steps	= (1u << format.orientationBits) - 1;
+	out.orientation		= (uint32_t)largest;
+	for (int i = 0; i < 4; ++i) {
+		if (i == largest) {
+			continue;
+		}
+		float unit = (components[i] * sign + SMALLEST_THREE_RANGE) / (SMALLEST_THREE_RANGE * 2.0f);
+		uint32_t q = (uint32_t)std::max(0.0f, std::min(std::floor(unit * steps + 0.5f), (float)steps));
+		out.orientation = (out.orientation << format.orientationBits) | q;
+	}
+
+	bool moving = out.hasPhysics && !out.asleep;
+	for (int axis = 0; axis < 3; ++axis) {
+		out.linearVelocity[axis]	= moving ? QuantiseSigned(state.linearVelocity[axis], format.linearPrecision, linearMax) : linearMax;
+		out.angularVelocity[axis]	= moving ? QuantiseSigned(state.angularVelocity[axis], format.angularPrecision, angularMax) : angularMax;
+	}
+}
+
+void PackedQuantiser::Dequantise(const PackedQuantisedState& state, PackedObjectState& out) const {
+	out.id			= state.id;
+	out.hasPhysics	= state.hasPhysics;
+	out.asleep		= state.asleep;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		out.position[axis]			= format.worldMin[axis] + (float)state.position[axis] * format.positionPrecision;
+		out.linearVelocity[axis]	= DequantiseSigned(state.linearVelocity[axis], format.linearPrecision, linearMax);
+		out.angularVelocity[axis]	= DequantiseSigned(state.angularVelocity[axis], format.angularPrecision, angularMax);
+	}
+
+	uint32_t	mask	= (1u << format.orientationBits) - 1;
+	uint32_t	packed	= state.orientation;
+	int			largest	= (int)(packed >> (format.orientationBits * 3)) & 3;
+
+	float components[4];
+	float sumSq = 0.0f;
+	for (int i = 3; i >= 0; --i) { //written largest index first, so they come back out last to first
+		if (i == largest) {
+			continue;
+		}
+		float unit		= (float)(packed & mask) / (float)mask;
+		components[i]	= (unit * SMALLEST_THREE_RANGE * 2.0f) - SMALLEST_THREE_RANGE;
+		sumSq			+= components[i] * components[i];
+		packed			>>= format.orientationBits;
+	}
+	components[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSq));
+
+	out.orientation = Quaternion(components[0], components[1], components[2], components[3]);
+	out.orientation.Normalise();
+}
+
+PackedSnapshotReader::PackedSnapshotReader(const uint8_t* data, size_t size, PackedSnapshotReader* baseline)
+	: stream(data, size), baseline(nullptr) {
+	frame				= 0;
+	baselineFrame		= 0;
+	objectCount			= 0;
+	objectsRead			= 0;
+	lastID				= -1;
+	delta				= false;
+	valid				= false;
+	hasBaselineState	= false;
+
+	if (!data || size < MIN_HEADER_SIZE || stream.Read(32) != SNAPSHOT_MAGIC || stream.Read(16) != SNAPSHOT_VERSION) {
+		return;
+	}
+	delta			= (stream.Read(16) & SNAPSHOT_DELTA_FLAG) != 0;
+	frame			= stream.Read(32);
+	baselineFrame	= stream.Read(32);
+	objectCount		= (int)stream.Read(32);
+
+	PackedSnapshotFormat format;
+	format.worldMin.x			= stream.ReadFloat();
+	format.worldMin.y			= stream.ReadFloat();
+	format.worldMin.z			= stream.ReadFloat();
+	format.worldMax.x			= stream.ReadFloat();
+	format.worldMax.y			= stream.ReadFloat();
+	format.worldMax.z			= stream.ReadFloat();
+	format.positionPrecision	= stream.ReadFloat();
+	format.maxLinearVelocity	= stream.ReadFloat();
+	format.linearPrecision		= stream.ReadFloat();
+	format.maxAngularVelocity	= stream.ReadFloat();
+	format.angularPrecision		= stream.ReadFloat();
+	format.orientationBits		= (int)stream.Read(32);
+	quantiser = PackedQuantiser(format);
+
+	if (stream.HasOverflowed() || objectCount < 0) {
+		return;
+	}
+	if (delta) {
+		if (!baseline || !baseline->IsValid() || baseline->GetFrame() != baselineFrame || baseline->GetFormat() != quantiser.GetFormat()) {
+			return;
+		}
+		this->baseline		= baseline;
+		hasBaselineState	= baseline->NextQuantised(baselineState);
+	}
+	valid = true;
+}
+
+bool PackedSnapshotReader::PeekFrame(const uint8_t* data, size_t size, uint32_t& frame, uint32_t& baselineFrame) {
+	BitReader header(data, size);
+	if (!data || size < MIN_HEADER_SIZE || header.Read(32) != SNAPSHOT_MAGIC || header.Read(16) != SNAPSHOT_VERSION) {
+		return false;
+	}
+	header.Read(16);
+	frame			= header.Read(32);
+	baselineFrame	= header.Read(32);
+	return true;
+}
+
+/*
+The reading side of PackedSnapshotWriter::WriteObject - see there for
+what each part of an object's record is.
+*/
+bool PackedSnapshotReader::NextQuantised(PackedQuantisedState& state) {
+	if (!valid || objectsRead >= objectCount) {
+		return false;
+	}
+	uint32_t gap = 0;
+	if (stream.ReadBool()) {
+		gap = stream.Read(stream.Read(5) + 1);
+	}
+	uint32_t id = (uint32_t)(lastID + 1 + gap);
+
+	while (hasBaselineState && baselineState.id < id) {
+		hasBaselineState = baseline->NextQuantised(baselineState);
+	}
+	const PackedQuantisedState* base = (hasBaselineState && baselineState.id == id) ? &baselineState : nullptr;
+
+	bool positionChanged	= true;
+	bool orientationChanged	= true;
+	bool motionChanged		= true;
+	if (base) {
+		bool changed		= stream.ReadBool();
+		positionChanged		= changed && stream.ReadBool();
+		orientationChanged	= changed && stream.ReadBool();
+		motionChanged		= changed && stream.ReadBool();
+		state = *base;
+	}
+	state.id = id;
+
+	auto readComponents = [&](uint32_t* values, const uint32_t* baseValues, int count, const int* bits) {
+		if (baseValues && stream.ReadBool()) {
+			for (int i = 0; i < count; ++i) {
+				uint32_t zigzag = stream.Read(SMALL_DELTA_BITS);
+				int64_t change	= (zigzag & 1) ? -(int64_t)(zigzag >> 1) - 1 : (int64_t)(zigzag >> 1);
+				values[i]		= (uint32_t)((int64_t)baseValues[i] + change);
+			}
+			return;
+		}
+		for (int i = 0; i < count; ++i) {
+			values[i] = stream.Read(bits[i]);
+		}
+	};
+
+	if (positionChanged) {
+		readComponents(state.position, base ? base->position : nullptr, 3, quantiser.positionBits);
+	}
+	if (orientationChanged) {
+		state.orientation = stream.Read(quantiser.orientationBits);
+	}
+	if (motionChanged) {
+		state.hasPhysics	= stream.ReadBool();
+		state.asleep		= state.hasPhysics && stream.ReadBool();
+
+		int linearBits[3]	= { quantiser.linearBits, quantiser.linearBits, quantiser.linearBits };
+		int angularBits[3]	= { quantiser.angularBits, quantiser.angularBits, quantiser.angularBits };
+		bool baseMoving		= base && base->hasPhysics && !base->asleep;
+		if (state.hasPhysics && !state.asleep) {
+			readComponents(state.linearVelocity, baseMoving ? base->linearVelocity : nullptr, 3, linearBits);
+			readComponents(state.angularVelocity, baseMoving ? base->angularVelocity : nullptr, 3, angularBits);
+		}
+		else { //the same zeroed velocities the writer compared against
+			PackedQuantisedState still;
+			quantiser.Quantise(PackedObjectState(), still);
+			std::copy(still.linearVelocity, still.linearVelocity + 3, state.linearVelocity);
+			std::copy(still.angularVelocity, still.angularVelocity + 3, state.angularVelocity);
+		}
+	}
+	if (stream.HasOverflowed()) {
+		valid = false;
+		return false;
+	}
+	lastID = id;
+	objectsRead++;
+	return true;
+}
+
+bool PackedSnapshotReader::Next(PackedObjectState& state) {
+	PackedQuantisedState quantised;
+	if (!NextQuantised(quantised)) {
+		return false;
+	}
+	quantiser.Dequantise(quantised, state);
+	return true;
+}
+
+int PackedSnapshotReader::ApplyToWorld(GameWorld& world) {
+	int applied = 0;
+	PackedObjectState state;
+	while (Next(state)) {
+		GameObject* o = world.GetGameObjectByID((int)state.id);
+		if (!o) {
+			continue;
+		}
+		o->GetTransform()
+			.SetPosition(state.position)
+			.SetOrientation(state.orientation);
+
+		PhysicsObject* phys = o->GetPhysicsObject();
+		if (phys) {
+			phys->ResetPreviousState();
+		}
+		if (phys && state.hasPhysics) {
+			if (state.asleep) {
+				phys->Sleep();
+			}
+			else {
+				phys->Wake();
+				phys->SetLinearVelocity(state.linearVelocity);
+				phys->SetAngularVelocity(state.angularVelocity);
+			}
+		}
+		applied++;
+	}
+	return applied;
+}
+
+PackedSnapshotWriter::PackedSnapshotWriter(const PackedSnapshotFormat& format) : quantiser(format) {
+	buffer				= nullptr;
+	baseline			= nullptr;
+	hasBaselineState	= false;
+	objectCount			= 0;
+	lastID				= -1;
+}
+
+void PackedSnapshotWriter::Begin(std::vector<uint8_t>& outBuffer, uint32_t frame, PackedSnapshotReader* baselineReader) {
+	buffer				= &outBuffer;
+	objectCount			= 0;
+	lastID				= -1;
+	baseline			= nullptr;
+	hasBaselineState	= false;
+
+	if (baselineReader && baselineReader->IsValid() && baselineReader->GetFormat() == quantiser.GetFormat()) {
+		baseline			= baselineReader;
+		hasBaselineState	= baseline->NextQuantised(baselineState);
+	}
+
+	buffer->clear();
+	stream.SetBuffer(*buffer);
+
+	const PackedSnapshotFormat& format = quantiser.GetFormat();
+	stream.Write(SNAPSHOT_MAGIC, 32);
+	stream.Write(SNAPSHOT_VERSION, 16);
+	stream.Write(baseline ? SNAPSHOT_DELTA_FLAG : 0, 16);
+	stream.Write(frame, 32);
+	stream.Write(baseline ? baseline->GetFrame() : frame, 32);
+	stream.Write(0, 32); //the object count, filled in by End
+	stream.WriteFloat(format.worldMin.x);
+	stream.WriteFloat(format.worldMin.y);
+	stream.WriteFloat(format.worldMin.z);
+	stream.WriteFloat(format.worldMax.x);
+	stream.WriteFloat(format.worldMax.y);
+	stream.WriteFloat(format.worldMax.z);
+	stream.WriteFloat(format.positionPrecision);
+	stream.WriteFloat(format.maxLinearVelocity);
+	stream.WriteFloat(format.linearPrecision);
+	stream.WriteFloat(format.maxAngularVelocity);
+	stream.WriteFloat(format.angularPrecision);
+	stream.Write((uint32_t)format.orientationBits, 32);
+}
+
+void PackedSnapshotWriter::AddObject(uint32_t id, const Transform& transform, const PhysicsObject* physics) {
+	PackedObjectState state;
+	state.id			= id;
+	state.position		= transform.GetPosition();
+	state.orientation	= transform.GetOrientation();
+	if (physics) {
+		state.hasPhysics		= true;
+		state.asleep			= physics->IsAsleep();
+		state.linearVelocity	= physics->GetLinearVelocity();
+		state.angularVelocity	= physics->GetAngularVelocity();
+	}
+	AddObject(state);
+}
+
+void PackedSnapshotWriter::AddObject(const PackedObjectState& state) {
+	if ((int64_t)state.id <= lastID) {
+		return; //out of order, so the reader couldn't match it up against the baseline
+	}
+	PackedQuantisedState quantised;
+	quantiser.Quantise(state, quantised);
+	WriteObject(quantised);
+}
+
+void PackedSnapshotWriter::AddQuantisedObject(const PackedQuantisedState& state) {
+	if ((int64_t)state.id <= lastID) {
+		return;
+	}
+	WriteObject(state);
+}
+
+/*
+Each object's record starts with how far its ID is from the last one's -
+a single bit for the usual case of the next ID along. If the baseline has
+the object, a bit says whether it's changed at all, then a bit for each of
+its position, orientation, and motion (its flags and velocities) says
+which parts have. Anything the baseline doesn't have is written in full.
+*/
+void PackedSnapshotWriter::WriteObject(const PackedQuantisedState& state) {
+	WriteGap((uint32_t)(state.id - lastID - 1));
+
+	while (hasBaselineState && baselineState.id < state.id) {
+		hasBaselineState = baseline->NextQuantised(baselineState);
+	}
+	const PackedQuantisedState* base = (hasBaselineState && baselineState.id == state.id) ? &baselineState : nullptr;
+
+	bool positionChanged	= true;
+	bool orientationChanged	= true;
+	bool motionChanged		= true;
+	if (base) {
+		positionChanged		= !std::equal(state.position, state.position + 3, base->position);
+		orientationChanged	= state.orientation != base->orientation;
+		motionChanged		=	state.hasPhysics != base->hasPhysics || state.asleep != base->asleep ||
+								!std::equal(state.linearVelocity, state.linearVelocity + 3, base->linearVelocity) ||
+								!std::equal(state.angularVelocity, state.angularVelocity + 3, base->angularVelocity);
+
+		bool changed = positionChanged || orientationChanged || motionChanged;
+		stream.WriteBool(changed);
+		if (changed) {
+			stream.WriteBool(positionChanged);
+			stream.WriteBool(orientationChanged);
+			stream.WriteBool(motionChanged);
+		}
+	}
+
+	if (positionChanged) {
+		WriteComponents(state.position, base ? base->position : nullptr, 3, quantiser.positionBits);
+	}
+	if (orientationChanged) {
+		stream.Write(state.orientation, quantiser.orientationBits);
+	}
+	if (motionChanged) {
+		stream.WriteBool(state.hasPhysics);
+		if (state.hasPhysics) {
+			stream.WriteBool(state.asleep);
+		}
+		if (state.hasPhysics && !state.asleep) {
+			int linearBits[3]	= { quantiser.linearBits, quantiser.linearBits, quantiser.linearBits };
+			int angularBits[3]	= { quantiser.angularBits, quantiser.angularBits, quantiser.angularBits };
+			bool baseMoving		= base && base->hasPhysics && !base->asleep;
+			WriteComponents(state.linearVelocity, baseMoving ? base->linearVelocity : nullptr, 3, linearBits);
+			WriteComponents(state.angularVelocity, baseMoving ? base->angularVelocity : nullptr, 3, angularBits);
+		}
+	}
+	lastID = state.id;
+	objectCount++;
+}
+
+//IDs are mostly handed out in order, so the gap is usually 0
+void PackedSnapshotWriter::WriteGap(uint32_t gap) {
+	if (gap == 0) {
+		stream.WriteBool(false);
+		return;
+	}
+	int bits = BitsFor(gap);
+	stream.WriteBool(true);
+	stream.Write(bits - 1, 5);
+	stream.Write(gap, bits);
+}
+
+/*
+With something to compare against, a bit says whether every value's
+changed by little enough to be written as the change - zigzagged, so
+small steps either way need only a few bits.
+*/
+void PackedSnapshotWriter::WriteComponents(const uint32_t* values, const uint32_t* baseValues, int count, const int* bits) {
+	if (baseValues) {
+		uint32_t zigzags[3];
+		bool small = true;
+		for (int i = 0; i < count && small; ++i) {
+			int64_t change	= (int64_t)values[i] - (int64_t)baseValues[i];
+			uint64_t zigzag	= change >= 0 ? (uint64_t)change << 1 : (((uint64_t)(-change - 1)) << 1) | 1;
+			small			= zigzag < (1ull << SMALL_DELTA_BITS);
+			zigzags[i]		= (uint32_t)zigzag;
+		}
+		stream.WriteBool(small);
+		if (small) {
+			for (int i = 0; i < count; ++i) {
+				stream.Write(zigzags[i], SMALL_DELTA_BITS);
+			}
+			return;
+		}
+	}
+	for (int i = 0; i < count; ++i) {
+		stream.Write(values[i], bits[i]);
+	}
+}
+
+size_t PackedSnapshotWriter::End() {
+	stream.Flush();
+	uint8_t* count = buffer->data() + OBJECT_COUNT_OFFSET;
+	count[0] = (uint8_t)(objectCount);
+	count[1] = (uint8_t)(objectCount >> 8);
+	count[2] = (uint8_t)(objectCount >> 16);
+	count[3] = (uint8_t)(objectCount >> 24);
+	return buffer->size();
+}
+
+//Going through the world's ID slots in order gives every object in order of increasing ID
+size_t PackedSnapshotWriter::WriteWorld(std::vector<uint8_t>& outBuffer, const GameWorld& world, uint32_t frame, PackedSnapshotReader* baselineReader) {
+	Begin(outBuffer, frame, baselineReader);
+	int idCount = world.GetWorldIDCount();
+	for (int id = 0; id < idCount; ++id) {
+		GameObject* o = world.GetGameObjectByID(id);
+		if (o) {
+			AddObject((uint32_t)id, o->GetTransform(), o->GetPhysicsObject());
+		}
+	}
+	return End();
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include "BitStream.h"
+#include "../../Common/Vector3.h"
+#include "../../Common/Quaternion.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameWorld;
+		class Transform;
+		class PhysicsObject;
+
+		/*
+		How finely each part of an object's state is kept in a packed
+		snapshot. Positions outside of the world bounds, and velocities
+		faster than the maximums, are clamped. The format is written into
+		every snapshot, so a reader never needs to be told it.
+		*/
+		struct PackedSnapshotFormat {
+			Vector3	worldMin			= Vector3(-1024.0f, -1024.0f, -1024.0f);
+			Vector3	worldMax			= Vector3(1024.0f, 1024.0f, 1024.0f);
+			float	positionPrecision	= 1.0f / 1024.0f;	//about a millimetre
+			float	maxLinearVelocity	= 256.0f;
+			float	linearPrecision		= 1.0f / 256.0f;
+			float	maxAngularVelocity	= 64.0f;
+			float	angularPrecision	= 1.0f / 512.0f;
+			int		orientationBits		= 10;				//for each of the smallest three, from 4 to 10
+
+			bool operator==(const PackedSnapshotFormat& other) const;
+			bool operator!=(const PackedSnapshotFormat& other) const {
+				return !(*this == other);
+			}
+		};
+
+		//One object's state, as it comes back out of a snapshot
+		struct PackedObjectState {
+			uint32_t	id				= 0;
+			Vector3		position;
+			Quaternion	orientation;
+			Vector3		linearVelocity;
+			Vector3		angularVelocity;
+			bool		hasPhysics		= false;
+			bool		asleep			= false;
+		};
+
+		/*
+		The whole numbers an object's state is turned into for packing.
+		Deltas are worked out between these, rather than between the floats,
+		so a reader ends up with exactly the values the writer compared
+		against, and errors never build up over a chain of deltas.
+		*/
+		struct PackedQuantisedState {
+			uint32_t	id;
+			uint32_t	position[3];
+			uint32_t	orientation;		//the largest component's index, then the smallest three
+			uint32_t	linearVelocity[3];
+			uint32_t	angularVelocity[3];
+			bool		hasPhysics;
+			bool		asleep;
+		};
+
+		//Turns states into quantised states and back, working out how many bits each value needs
+		class PackedQuantiser {
+		public:
+			PackedQuantiser(const PackedSnapshotFormat& format = PackedSnapshotFormat());
+
+			void Quantise(const PackedObjectState& state, PackedQuantisedState& out) const;
+			void Dequantise(const PackedQuantisedState& state, PackedObjectState& out) const;
+
+			const PackedSnapshotFormat& GetFormat() const {
+				return format;
+			}
+
+			int	positionBits[3];
+			int	orientationBits;
+			int	linearBits;
+			int	angularBits;
+
+		protected:
+			PackedSnapshotFormat format;
+
+			uint32_t	positionMax[3];
+			uint32_t	linearMax;
+			uint32_t	angularMax;
+		};
+
+		/*
+		Reads a packed snapshot straight out of the memory it was given -
+		nothing is copied or allocated, and each object is only unpacked
+		when Next is called. A delta snapshot has to be read alongside the
+		baseline it was written against, which is read through at the same
+		time, so both are gone through exactly once.
+
+		The buffer (and the baseline's reader) has to stay around while the
+		reader is in use.
+		*/
+		class PackedSnapshotReader {
+		public:
+			PackedSnapshotReader(const uint8_t* data, size_t size, PackedSnapshotReader* baseline = nullptr);
+			~PackedSnapshotReader() {}
+
+			//False if the buffer isn't a snapshot, or is a delta and wasn't given the right baseline
+			bool IsValid() const {
+				return valid;
+			}
+
+			bool IsDelta() const {
+				return delta;
+			}
+
+			uint32_t GetFrame() const {
+				return frame;
+			}
+
+			uint32_t GetBaselineFrame() const {
+				return baselineFrame;
+			}
+
+			int GetObjectCount() const {
+				return objectCount;
+			}
+
+			const PackedSnapshotFormat& GetFormat() const {
+				return quantiser.GetFormat();
+			}
+
+			//Unpacks the next object, in order of increasing ID - false once they've all been read
+			bool Next(PackedObjectState& state);
+			bool NextQuantised(PackedQuantisedState& state);
+
+			/*
+			Moves every object still to be read that the world has (matched by
+			world ID) to where the snapshot has it, and sets its velocities.
+			Physics objects are reset to there too, so rendering doesn't blend
+			across from where they were. Returns how many objects were found.
+			*/
+			int ApplyToWorld(GameWorld& world);
+
+			//Reads the frame number of a snapshot without reading the rest of it
+			static bool PeekFrame(const uint8_t* data, size_t size, uint32_t& frame, uint32_t& baselineFrame);
+
+		protected:
+			BitReader				stream;
+			PackedQuantiser			quantiser;
+			PackedSnapshotReader*	baseline;
+			PackedQuantisedState	baselineState;
+			bool					hasBaselineState;
+
+			uint32_t	frame;
+			uint32_t	baselineFrame;
+			int			objectCount;
+			int			objectsRead;
+			int64_t		lastID;
+			bool		delta;
+			bool		valid;
+		};
+
+		/*
+		Packs the state of a set of objects into a buffer - positions to a
+		fixed precision within the world bounds, orientations as their
+		smallest three components, and velocities for bodies that are awake.
+
+		Given a baseline (a snapshot the reader is known to have), only what
+		has changed since is written - an object that hasn't moved costs a
+		bit, and one that's moved a little only needs the difference. The
+		buffer is reused, so once it's grown big enough writing a snapshot
+		doesn't allocate anything.
+		*/
+		class PackedSnapshotWriter {
+		public:
+			PackedSnapshotWriter(const PackedSnapshotFormat& format = PackedSnapshotFormat());
+			~PackedSnapshotWriter() {}
+
+			/*
+			The baseline's read through as objects are added, so it has to be a
+			reader that hasn't been read from yet. If it can't be used (it isn't
+			valid, or has a different format), a full snapshot is written instead.
+			*/
+			void Begin(std::vector<uint8_t>& buffer, uint32_t frame, PackedSnapshotReader* baseline = nullptr);
+
+			//Objects have to be added in order of increasing ID
+			void AddObject(uint32_t id, const Transform& transform, const PhysicsObject* physics);
+			void AddObject(const PackedObjectState& state);
+			//For repacking what a reader's unpacked, without quantising it again
+			void AddQuantisedObject(const PackedQuantisedState& state);
+
+			//Returns the size of the finished snapshot, in bytes
+			size_t End();
+
+			//Writes every object in the world, using their world IDs
+			size_t WriteWorld(std::vector<uint8_t>& buffer, const GameWorld& world, uint32_t frame, PackedSnapshotReader* baseline = nullptr);
+
+		protected:
+			void WriteObject(const PackedQuantisedState& state);
+			void WriteGap(uint32_t gap);
+			void WriteComponents(const uint32_t* values, const uint32_t* baseValues, int count, const int* bits);
+
+			std::vector<uint8_t>*	buffer;
+			BitWriter				stream;
+			PackedQuantiser			quantiser;
+			PackedSnapshotReader*	baseline;
+			PackedQuantisedState	baselineState;
+			bool					hasBaselineState;
+
+			int			objectCount;
+			int64_t		lastID;
+		};
+	}
+}
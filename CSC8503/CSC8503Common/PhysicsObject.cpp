@@ -7,45 +7,95 @@ using namespace CSC8503;
 PhysicsObject::PhysicsObject(Transform* parentTransform, const CollisionVolume* parentVolume)	{
 	transform	= parentTransform;
 	volume		= parentVolume;
-
-	inverseMass = 1.0f;
-	elasticity	= 0.8f;
-	friction	= 0.8f;
+	ownBodies.reset(new RigidBodyStore());
+	bodies		= ownBodies.get();
+	bodyHandle	= bodies->AddBody(parentTransform);
 }
 
 PhysicsObject::~PhysicsObject()	{
+	bodies->RemoveBody(bodyHandle);
+}
 
+void PhysicsObject::SetBodyStore(RigidBodyStore* store) {
+	if (!store) {
+		if (!ownBodies) {
+			ownBodies.reset(new RigidBodyStore());
+		}
+		store = ownBodies.get();
+	}
+	if (store == bodies) {
+		return;
+	}
+	bodyHandle	= bodies->TransferBody(bodyHandle, *store);
+	bodies		= store;
+	if (store != ownBodies.get()) {
+		ownBodies.reset();
+	}
 }
 
+/*
+Impulses can't change the velocity of an object with infinite mass, so
+we don't write to them at all - a static object might be touching
+several islands that are being solved on different threads at once.
+*/
 void PhysicsObject::ApplyAngularImpulse(const Vector3& force) {
-	//if (force.Length() > 0) {
-	//	bool a = true;
-	//}
-	angularVelocity += inverseInteriaTensor * force;
+	int i = Index();
+	if (bodies->inverseMasses[i] == 0.0f) {
+		return;
+	}
+	Wake();
+	bodies->angularVelocities.Set(i, bodies->angularVelocities.Get(i) + bodies->inverseInertiaTensors[i] * force);
 }
 
 void PhysicsObject::ApplyLinearImpulse(const Vector3& force) {
-	linearVelocity += force * inverseMass;
+	int i = Index();
+	if (bodies->inverseMasses[i] == 0.0f) {
+		return;
+	}
+	Wake();
+	bodies->linearVelocities.Set(i, bodies->linearVelocities.Get(i) + force * bodies->inverseMasses[i]);
 }
 
 void PhysicsObject::AddForce(const Vector3& addedForce) {
-	force += addedForce;
+	int i = Index();
+	Wake();
+	bodies->forces.Set(i, bodies->forces.Get(i) + addedForce);
 }
 
 void PhysicsObject::AddForceAtPosition(const Vector3& addedForce, const Vector3& position) {
 	Vector3 localPos = position - transform->GetPosition();
 
-	force  += addedForce;
-	torque += Vector3::Cross(localPos, addedForce);
+	int i = Index();
+	Wake();
+	bodies->forces.Set(i, bodies->forces.Get(i) + addedForce);
+	bodies->torques.Set(i, bodies->torques.Get(i) + Vector3::Cross(localPos, addedForce));
 }
 
 void PhysicsObject::AddTorque(const Vector3& addedTorque) {
-	torque += addedTorque;
+	int i = Index();
+	Wake();
+	bodies->torques.Set(i, bodies->torques.Get(i) + addedTorque);
+}
+
+void PhysicsObject::Sleep() {
+	int i = Index();
+	bodies->sleeping[i] = 1;
+	bodies->linearVelocities.Set(i, Vector3());
+	bodies->angularVelocities.Set(i, Vector3());
+}
+
+void PhysicsObject::ResetPreviousState() {
+	int i = Index();
+	bodies->positions.Set(i, transform->GetPosition());
+	bodies->orientations.Set(i, transform->GetOrientation());
+	bodies->previousPositions.Set(i, transform->GetPosition());
+	bodies->previousOrientations.Set(i, transform->GetOrientation());
 }
 
 void PhysicsObject::ClearForces() {
-	force				= Vector3();
-	torque				= Vector3();
+	int i = Index();
+	bodies->forces.Set(i, Vector3());
+	bodies->torques.Set(i, Vector3());
 }
 
 void PhysicsObject::InitCubeInertia() {
@@ -55,16 +105,19 @@ void PhysicsObject::InitCubeInertia() {
 
 	Vector3 dimsSqr		= fullWidth * fullWidth;
 
+	float inverseMass = GetInverseMass();
+	Vector3 inverseInertia;
 	inverseInertia.x = (12.0f * inverseMass) / (dimsSqr.y + dimsSqr.z);
 	inverseInertia.y = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.z);
 	inverseInertia.z = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.y);
+	bodies->inverseInertias.Set(Index(), inverseInertia);
 }
 
 void PhysicsObject::InitSphereInertia() {
 	float radius	= transform->GetScale().GetMaxElement();
-	float i			= 2.5f * inverseMass / (radius*radius);
+	float i			= 2.5f * GetInverseMass() / (radius*radius);
 
-	inverseInertia	= Vector3(i, i, i);
+	bodies->inverseInertias.Set(Index(), Vector3(i, i, i));
 }
 
 void PhysicsObject::UpdateInertiaTensor() {
@@ -73,6 +126,6 @@ void PhysicsObject::UpdateInertiaTensor() {
 	Matrix3 invOrientation	= Matrix3(q.Conjugate());
 	Matrix3 orientation		= Matrix3(q);
 
-	inverseInteriaTensor = orientation * Matrix3::Scale(inverseInertia) *invOrientation;
+	int i = Index();
+	bodies->inverseInertiaTensors[i] = orientation * Matrix3::Scale(bodies->inverseInertias.Get(i)) *invOrientation;
 }
-
@@ -1,51 +1,78 @@
 #pragma once
 #include "../../Common/Vector3.h"
 #include "../../Common/Matrix3.h"
+#include "RigidBodyStore.h"
+#include <memory>
 
 using namespace NCL::Maths;
 
 namespace NCL {
 	class CollisionVolume;
-	
+
 	namespace CSC8503 {
 		class Transform;
 
+		/*
+		A PhysicsObject doesn't hold its own state any more - it's a view of
+		one body in a RigidBodyStore. Until its object's added to a world, the
+		body's kept in a store of its own, so it can be set up beforehand.
+		*/
 		class PhysicsObject	{
 		public:
 			PhysicsObject(Transform* parentTransform, const CollisionVolume* parentVolume);
 			~PhysicsObject();
 
+			PhysicsObject(const PhysicsObject&) = delete;
+			PhysicsObject& operator=(const PhysicsObject&) = delete;
+
 			Vector3 GetLinearVelocity() const {
-				return linearVelocity;
+				return bodies->linearVelocities.Get(Index());
 			}
 
 			Vector3 GetAngularVelocity() const {
-				return angularVelocity;
+				return bodies->angularVelocities.Get(Index());
 			}
 
 			Vector3 GetTorque() const {
-				return torque;
+				return bodies->torques.Get(Index());
 			}
 
 			Vector3 GetForce() const {
-				return force;
+				return bodies->forces.Get(Index());
 			}
 
-			Vector3 GetInertia() { 
-				return inverseInertia; 
+			Vector3 GetInertia() {
+				return bodies->inverseInertias.Get(Index());
 			}
 
 			void SetInverseMass(float invMass) {
-				inverseMass = invMass;
+				bodies->inverseMasses[Index()] = invMass;
 			}
 
 			float GetInverseMass() const {
-				return inverseMass;
+				return bodies->inverseMasses[Index()];
+			}
+
+			//How much of their speed two bodies keep when they bounce off each other
+			void SetElasticity(float e) {
+				bodies->elasticities[Index()] = e;
+			}
+
+			float GetElasticity() const {
+				return bodies->elasticities[Index()];
+			}
+
+			void SetFriction(float f) {
+				bodies->frictions[Index()] = f;
+			}
+
+			float GetFriction() const {
+				return bodies->frictions[Index()];
 			}
 
 			void ApplyAngularImpulse(const Vector3& force);
 			void ApplyLinearImpulse(const Vector3& force);
-			
+
 			void AddForce(const Vector3& force);
 
 			void AddForceAtPosition(const Vector3& force, const Vector3& position);
@@ -56,11 +83,17 @@ namespace NCL {
 			void ClearForces();
 
 			void SetLinearVelocity(const Vector3& v) {
-				linearVelocity = v;
+				bodies->linearVelocities.Set(Index(), v);
+				if (v.LengthSquared() > 0.0f) {
+					Wake();
+				}
 			}
 
 			void SetAngularVelocity(const Vector3& v) {
-				angularVelocity = v;
+				bodies->angularVelocities.Set(Index(), v);
+				if (v.LengthSquared() > 0.0f) {
+					Wake();
+				}
 			}
 
 			void InitCubeInertia();
@@ -69,27 +102,102 @@ namespace NCL {
 			void UpdateInertiaTensor();
 
 			Matrix3 GetInertiaTensor() const {
-				return inverseInteriaTensor;
+				return bodies->inverseInertiaTensors[Index()];
+			}
+
+			void SetIslandIndex(int index) {
+				bodies->islandIndices[Index()] = index;
+			}
+
+			int GetIslandIndex() const {
+				return bodies->islandIndices[Index()];
+			}
+
+			/*
+			A body that's been resting for a while is put to sleep by the
+			physics system, and is skipped by the integrators and collision
+			detection until something wakes it up again - a force, an impulse,
+			a new velocity, or touching something that's awake.
+			*/
+			bool IsAsleep() const {
+				return bodies->sleeping[Index()] != 0;
+			}
+
+			void Sleep();
+
+			void Wake() {
+				int i = Index();
+				if (bodies->sleeping[i]) {
+					bodies->sleeping[i]		= 0;
+					bodies->sleepTimes[i]	= 0.0f;
+				}
+			}
+
+			float GetSleepTime() const {
+				return bodies->sleepTimes[Index()];
+			}
+
+			void SetSleepTime(float time) {
+				bodies->sleepTimes[Index()] = time;
+			}
+
+			/*
+			Bullets are swept along their path each step, rather than just
+			tested where they end up, so a body moving further than its own
+			size in a step can't pass straight through something thin.
+			*/
+			void SetBullet(bool state) {
+				bodies->bullets[Index()] = state ? 1 : 0;
+			}
+
+			bool IsBullet() const {
+				return bodies->bullets[Index()] != 0;
+			}
+
+			//Where the body was before the last physics step, to interpolate rendering from
+			Vector3 GetPreviousPosition() const {
+				return bodies->previousPositions.Get(Index());
+			}
+
+			Quaternion GetPreviousOrientation() const {
+				return bodies->previousOrientations.Get(Index());
+			}
+
+			/*
+			Takes the body straight to wherever its Transform is now, and forgets
+			where it was before the last step - used after a teleport or a
+			snapshot being loaded, so rendering doesn't blend across the jump.
+			*/
+			void ResetPreviousState();
+
+			/*
+			Moves the body into the given store, which is how a GameWorld takes
+			it in. Given nullptr, the body goes back into a store of its own, so
+			nothing steps it while its object's out of a world.
+			*/
+			void SetBodyStore(RigidBodyStore* store);
+
+			RigidBodyStore& GetBodyStore() const {
+				return *bodies;
+			}
+
+			//Where this body currently lives in the store - this changes as bodies are removed!
+			int GetBodyIndex() const {
+				return Index();
 			}
 
 		protected:
+			int Index() const {
+				return bodies->GetIndex(bodyHandle);
+			}
+
 			const CollisionVolume* volume;
 			Transform*		transform;
 
-			float inverseMass;
-			float elasticity;
-			float friction;
-
-			//linear stuff
-			Vector3 linearVelocity;
-			Vector3 force;
-			
+			int bodyHandle;
 
-			//angular stuff
-			Vector3 angularVelocity;
-			Vector3 torque;
-			Vector3 inverseInertia;
-			Matrix3 inverseInteriaTensor;
+			RigidBodyStore*					bodies;
+			std::unique_ptr<RigidBodyStore>	ownBodies; //only while it's not in a world
 		};
 	}
 }
@@ -3,12 +3,24 @@
 #include "GameObject.h"
 #include "CollisionDetection.h"
 #include "../../Common/Quaternion.h"
+#include "../../Common/Maths.h"
+#include "../../Common/GameTimer.h"
 
 #include "Constraint.h"
+#include "IntegrationKernels.h"
 
 #include "Debug.h"
+#include "Profiler.h"
 
 #include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cfenv>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#define NCL_SSE_FLOAT_STATE
+#endif
 using namespace NCL;
 using namespace CSC8503;
 
@@ -19,15 +31,110 @@ and the forces that are added to objects to change those positions
 
 */
 
-int TotalScore = 0;
-bool gamewin = false;
-bool gamelose = false;
+//This is the fixed timestep we'd LIKE to have
+const int DEFAULT_PHYSICS_HZ = 120;
+
+//Frames that need more steps than this drop the extra time, rather than falling ever further behind
+const int DEFAULT_MAX_SUBSTEPS = 8;
+
+//Static objects hardly ever move, so their broadphase boxes don't need any room to move in
+const float STATIC_TREE_MARGIN = 0.0f;
+
+//How many broadphase pairs each narrowphase job tests at once
+const int NARROWPHASE_CHUNK_SIZE = 64;
+
+//How many bodies each integration job steps - a multiple of 8, so every job fills whole AVX registers
+const int INTEGRATION_CHUNK_SIZE = 1024;
+
+/*
+Bodies moving slower than this for TIME_TO_SLEEP seconds are put to sleep.
+*/
+const float SLEEP_LINEAR_VELOCITY	= 0.3f;
+const float SLEEP_ANGULAR_VELOCITY	= 0.3f;
+const float TIME_TO_SLEEP			= 0.5f;
+
+//Contacts closing slower than this don't bounce, so resting objects can settle
+const float RESTITUTION_VELOCITY = 0.5f;
+
+/*
+Bullets are moved until they're this close to whatever they'd hit, so they
+don't start the next step already overlapping it.
+*/
+const float CCD_TARGET_DISTANCE	= 0.01f;
+
+//A contact point within this distance of one from the last step is treated as the same point
+const float CONTACT_MATCH_DISTANCE = 0.1f;
 
-PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g)	{
+/*
+Objects are only pushed apart until they overlap by this much. If they
+were separated completely, a resting object would lose its contact every
+other step, and there'd be no impulses left over to warm start from.
+*/
+const float PENETRATION_SLOP = 0.01f;
+
+/*
+Something else in the program - a graphics driver, or another library -
+might have turned on flush-to-zero, or changed the rounding mode, and
+either would change the physics' results. In deterministic mode the
+defaults are put back while the physics runs, and whatever was there
+before is restored afterwards.
+*/
+class DeterministicFloatScope {
+public:
+	DeterministicFloatScope(bool enabled) : oldState(0), enabled(enabled) {
+		if (!enabled) {
+			return;
+		}
+#ifdef NCL_SSE_FLOAT_STATE
+		oldState = _mm_getcsr();
+		_mm_setcsr(DEFAULT_MXCSR);
+#else
+		oldState = fegetround();
+		fesetround(FE_TONEAREST);
+#endif
+	}
+
+	~DeterministicFloatScope() {
+		if (!enabled) {
+			return;
+		}
+#ifdef NCL_SSE_FLOAT_STATE
+		_mm_setcsr(oldState);
+#else
+		fesetround(oldState);
+#endif
+	}
+
+protected:
+#ifdef NCL_SSE_FLOAT_STATE
+	static const unsigned int DEFAULT_MXCSR = 0x1F80; //every exception masked, round to nearest, no flush-to-zero
+	unsigned int oldState;
+#else
+	int oldState;
+#endif
+	bool enabled;
+};
+
+PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g), staticTree(STATIC_TREE_MARGIN)	{
 	applyGravity	= false;
-	useBroadPhase	= false;	
+	useBroadPhase	= true;
+	jobSystem		= nullptr;
+	islandCount		= 0;
+	islandBodyCount	= 0;
 	dTOffset		= 0.0f;
 	globalDamping	= 0.995f;
+
+	useFixedTimestep	= true;
+	deterministic		= false;
+	maxSubsteps			= DEFAULT_MAX_SUBSTEPS;
+	interpolationAlpha	= 0.0f;
+	SetFixedTimestep(DEFAULT_PHYSICS_HZ);
+
+	totalScore	= 0;
+	gameWon		= false;
+	gameLost	= false;
+
+	collisionMaterials.emplace_back(CollisionMaterial());
 	SetGravity(Vector3(0.0f, -9.8f, 0.0f));
 }
 
@@ -42,14 +149,26 @@ void PhysicsSystem::SetGravity(const Vector3& g) {
 
 If the 'game' is ever reset, the PhysicsSystem must be
 'cleared' to remove any old collisions that might still
-be hanging around in the collision list. If your engine
-is expanded to allow objects to be removed from the world,
-you'll need to iterate through this collisions list to remove
-any collisions they are in.
+be hanging around in the collision list. Objects removed
+from the world one at a time are taken out of the list by
+RemoveDestroyedPairs instead.
 
 */
 void PhysicsSystem::Clear() {
-	allCollisions.clear();
+	allCollisions.Clear();
+	broadphaseCollisions.clear();
+	broadphaseTree.Clear();
+	broadphaseSAP.Clear();
+	staticTree.Clear();
+	movedProxies.clear();
+	movedStaticProxies.clear();
+}
+
+void PhysicsSystem::SetBroadPhaseType(BroadPhaseType type) {
+	if (type != broadPhaseType) {
+		broadPhaseType = type;
+		Clear();
+	}
 }
 
 /*
@@ -59,18 +178,17 @@ This is the core of the physics engine update
 */
 int constraintIterationCount = 10;
 
-//This is the fixed timestep we'd LIKE to have
-const int   idealHZ = 120;
-const float idealDT = 1.0f / idealHZ;
-
 /*
-This is the fixed update we actually have...
-If physics takes too long it starts to kill the framerate, it'll drop the 
-iteration count down until the FPS stabilises, even if that ends up
-being at a low rate. 
+Contacts are warm started from the last step, so need far fewer iterations
+than the joint constraints, which start from nothing every time.
 */
-int realHZ		= idealHZ;
-float realDT	= idealDT;
+int contactIterationCount = 4;
+
+void PhysicsSystem::SetFixedTimestep(int hz) {
+	idealHZ = hz;
+	realHZ	= hz;
+	realDT	= 1.0f / hz;
+}
 
 void PhysicsSystem::Update(float dt) {	
 	/*if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::B)) {
@@ -91,36 +209,33 @@ void PhysicsSystem::Update(float dt) {
 	GameTimer t;
 	t.GetTimeDeltaSeconds();
 
-	if (useBroadPhase) {
-		UpdateObjectAABBs();
+	bool fixedRate = useFixedTimestep || deterministic;
+
+	/*
+	Work out how many steps fit in the accumulated time up front, so we know
+	which is the last one - the bodies' poses before that step are kept, and
+	rendering interpolates from them to where the step leaves them.
+	*/
+	int		stepCount	= 0;
+	float	remaining	= dTOffset;
+	while (remaining >= realDT) {
+		if (fixedRate && stepCount == maxSubsteps) {
+			remaining = fmod(remaining, realDT); //can't keep up, so let the simulation run slow
+			break;
+		}
+		remaining -= realDT;
+		stepCount++;
 	}
 
-	while(dTOffset >= realDT) {
-		IntegrateAccel(realDT); //Update accelerations from external forces
-		if (useBroadPhase) {
-			BroadPhase();
-			NarrowPhase();
-		}
-		else {
-			BasicCollisionDetection();
-		}
+	RunSteps(stepCount);
 
-		//This is our simple iterative solver - 
-		//we just run things multiple times, slowly moving things forward
-		//and then rechecking that the constraints have been met		
-		float constraintDt = realDT /  (float)constraintIterationCount;
-		for (int i = 0; i < constraintIterationCount; ++i) {
-			UpdateConstraints(constraintDt);	
-		}
-		IntegrateVelocity(realDT); //update positions from new velocity changes
+	dTOffset			= remaining;
+	interpolationAlpha	= dTOffset / realDT;
 
-		dTOffset -= realDT;
+	if (fixedRate) {
+		return;
 	}
 
-	ClearForces();	//Once we've finished with the forces, reset them to zero
-
-	UpdateCollisionList(); //Remove any old collisions
-
 	t.Tick();
 	float updateTime = t.GetTimeDeltaSeconds();
 
@@ -137,7 +252,7 @@ void PhysicsSystem::Update(float dt) {
 
 		if (realHZ > idealHZ) {
 			realHZ = idealHZ;
-			realDT = idealDT;
+			realDT = 1.0f / idealHZ;
 		}
 		if (temp != realHZ) {
 			std::cout << "Raising iteration count due to short physics time...(now " << realHZ << ")\n";
@@ -145,9 +260,181 @@ void PhysicsSystem::Update(float dt) {
 	}
 }
 
+void PhysicsSystem::Step(int stepCount) {
+	RunSteps(stepCount);
+}
+
+void PhysicsSystem::RunSteps(int stepCount) {
+	PROFILE_SCOPE("Physics Update");
+
+	DeterministicFloatScope floatScope(deterministic);
+
+	/*
+	The phase timer is ticked at the end of each part of the update, so its
+	delta is always how long that part took, ready to add to the stats.
+	*/
+	stats = PhysicsStats();
+	GameTimer phaseTimer;
+
+	RemoveDestroyedPairs();
+	phaseTimer.Tick();
+	stats.collisionListTime += phaseTimer.GetTimeDeltaMSec();
+
+	if (useBroadPhase) {
+		UpdateObjectAABBs();
+	}
+	phaseTimer.Tick();
+	stats.broadphaseTime += phaseTimer.GetTimeDeltaMSec();
+
+	for (int step = 0; step < stepCount; ++step) {
+		PROFILE_SCOPE("Physics Step");
+
+		IntegrateAccel(realDT); //Update accelerations from external forces
+
+		if (step == stepCount - 1) {
+			gameWorld.GetBodyStore().StorePreviousState();
+		}
+		phaseTimer.Tick();
+		stats.integrateTime += phaseTimer.GetTimeDeltaMSec();
+
+		solverContacts.clear();
+		solverStep++;
+		if (useBroadPhase) {
+			BroadPhase();
+			phaseTimer.Tick();
+			stats.broadphaseTime	+= phaseTimer.GetTimeDeltaMSec();
+			stats.broadphasePairs	= (int)broadphaseCollisions.size();
+
+			NarrowPhase();
+		}
+		else {
+			BasicCollisionDetection();
+		}
+		phaseTimer.Tick();
+		stats.narrowphaseTime	+= phaseTimer.GetTimeDeltaMSec();
+		stats.contactPairs		= (int)solverContacts.size();
+
+		BuildIslands();
+		SolveIslands(realDT);
+		phaseTimer.Tick();
+		stats.solveTime	+= phaseTimer.GetTimeDeltaMSec();
+		stats.islands	= islandCount;
+
+		ContinuousCollisions(realDT);
+		IntegrateVelocity(realDT); //update positions from new velocity changes
+		ClampBullets();
+		phaseTimer.Tick();
+		stats.integrateTime += phaseTimer.GetTimeDeltaMSec();
+		stats.steps++;
+	}
+
+	ClearForces();	//Once we've finished with the forces, reset them to zero
+	phaseTimer.Tick();
+	stats.integrateTime += phaseTimer.GetTimeDeltaMSec();
+
+	UpdateCollisionList(); //Remove any old collisions
+	phaseTimer.Tick();
+	stats.collisionListTime += phaseTimer.GetTimeDeltaMSec();
+	stats.cachedPairs		= allCollisions.Count();
+}
+
+/*
+The job system's workers are new threads, which don't get the calling
+thread's floating point state on every platform, so in deterministic mode
+each chunk they run sets it up for itself.
+*/
+template<class Func>
+void PhysicsSystem::ParallelFor(int count, int chunkSize, const Func& func) {
+	if (!jobSystem) {
+		func(0, count, 0);
+	}
+	else if (!deterministic) {
+		jobSystem->ParallelFor(count, chunkSize, func);
+	}
+	else {
+		jobSystem->ParallelFor(count, chunkSize, [&](int start, int end, int threadIndex) {
+			DeterministicFloatScope floatScope(threadIndex != 0); //the calling thread's already set up
+			func(start, end, threadIndex);
+		});
+	}
+}
+
+void PhysicsSystem::UseDeterministicMode(bool state) {
+	deterministic = state;
+	if (state) {
+		SetFixedTimestep(idealHZ); //undo anything the old adaptive rate did
+		gameWorld.ShuffleObjects(false);
+		gameWorld.ShuffleConstraints(false);
+	}
+}
+
+/*
+Saving is a handful of array copies - the bodies are already packed into
+the store's arrays, and the pair cache and broadphase trees are just
+vectors, which keep their memory when they're copied over again. The
+trees are saved as they are, rather than rebuilt on restoring, so that
+the broadphase finds its pairs in the same order the second time around.
+*/
+void PhysicsSystem::SaveSnapshot(PhysicsSnapshot& snapshot) const {
+	gameWorld.SaveSnapshot(snapshot.world);
+
+	snapshot.broadphaseProxies.resize(snapshot.world.objects.size());
+	for (size_t i = 0; i < snapshot.world.objects.size(); ++i) {
+		snapshot.broadphaseProxies[i] = snapshot.world.objects[i].object->GetBroadphaseProxy();
+	}
+
+	snapshot.bodies				= gameWorld.GetBodyStore();
+	snapshot.collisions			= allCollisions;
+	snapshot.broadphasePairs.resize(broadphaseCollisions.size());
+	for (size_t i = 0; i < broadphaseCollisions.size(); ++i) {
+		const CollisionDetection::CollisionInfo& pair = broadphaseCollisions[i];
+		snapshot.broadphasePairs[i] = { pair.a, pair.b, pair.cachedAxis };
+	}
+	snapshot.broadphaseTree		= broadphaseTree;
+	snapshot.broadphaseSAP		= broadphaseSAP;
+	snapshot.staticTree			= staticTree;
+	snapshot.movedProxies		= movedProxies;
+	snapshot.movedStaticProxies	= movedStaticProxies;
+	snapshot.broadphaseFrame	= broadphaseFrame;
+	snapshot.solverStep			= solverStep;
+	snapshot.timeOffset			= dTOffset;
+}
+
+bool PhysicsSystem::RestoreSnapshot(const PhysicsSnapshot& snapshot) {
+	RigidBodyStore& bodies = gameWorld.GetBodyStore();
+	if (snapshot.bodies.GetBodyCount() != bodies.GetBodyCount() || !gameWorld.RestoreSnapshot(snapshot.world)) {
+		return false;
+	}
+	for (size_t i = 0; i < snapshot.world.objects.size(); ++i) {
+		snapshot.world.objects[i].object->SetBroadphaseProxy(snapshot.broadphaseProxies[i]);
+	}
+
+	bodies					= snapshot.bodies;
+	allCollisions			= snapshot.collisions;
+	broadphaseCollisions.resize(snapshot.broadphasePairs.size());
+	for (size_t i = 0; i < snapshot.broadphasePairs.size(); ++i) {
+		const PhysicsSnapshot::BroadphasePair& pair = snapshot.broadphasePairs[i];
+		broadphaseCollisions[i]				= CollisionDetection::CollisionInfo();
+		broadphaseCollisions[i].a			= pair.a;
+		broadphaseCollisions[i].b			= pair.b;
+		broadphaseCollisions[i].cachedAxis	= pair.cachedAxis;
+	}
+	broadphaseTree			= snapshot.broadphaseTree;
+	broadphaseSAP			= snapshot.broadphaseSAP;
+	staticTree				= snapshot.staticTree;
+	movedProxies			= snapshot.movedProxies;
+	movedStaticProxies		= snapshot.movedStaticProxies;
+	broadphaseFrame			= snapshot.broadphaseFrame;
+	solverStep				= snapshot.solverStep;
+	dTOffset				= snapshot.timeOffset;
+	interpolationAlpha		= dTOffset / realDT;
+	return true;
+}
+
 /*
 Later on we're going to need to keep track of collisions
-across multiple frames, so we store them in a set.
+across multiple frames, so we store them in a pair cache. If a pair
+is still colliding, the narrowphase refreshes its framesLeft counter.
 
 The first time they are added, we tell the objects they are colliding.
 The frame they are to be removed, we tell them they're no longer colliding.
@@ -157,16 +444,24 @@ OnCollisionBegin / OnCollisionEnd functions (removing health when hit by a
 rocket launcher, gaining a point when the player hits the gold coin, and so on).
 */
 void PhysicsSystem::UpdateCollisionList() {
-	for (std::set<CollisionDetection::CollisionInfo>::iterator i = allCollisions.begin(); i != allCollisions.end(); ) {
-		if ((*i).framesLeft == numCollisionFrames) {
-			i->a->OnCollisionBegin(i->b);
-			i->b->OnCollisionBegin(i->a);
+	PROFILE_SCOPE("UpdateCollisionList");
+
+	for (int i = 0; i < allCollisions.Count(); ) {
+		CachedPair& pair = allCollisions[i];
+		if (!pair.began) {
+			pair.info.a->OnCollisionBegin(pair.info.b);
+			pair.info.b->OnCollisionBegin(pair.info.a);
+			pair.began = true;
 		}
-		(*i).framesLeft = (*i).framesLeft - 1;
-		if ((*i).framesLeft < 0) {
-			i->a->OnCollisionEnd(i->b);
-			i->b->OnCollisionEnd(i->a);
-			i = allCollisions.erase(i);
+		if (IsPairAsleep(pair.info.a, pair.info.b)) { //sleeping pairs aren't retested, but are still touching
+			++i;
+			continue;
+		}
+		pair.info.framesLeft = pair.info.framesLeft - 1;
+		if (pair.info.framesLeft < 0) {
+			pair.info.a->OnCollisionEnd(pair.info.b);
+			pair.info.b->OnCollisionEnd(pair.info.a);
+			allCollisions.RemoveAt(i); //last pair is swapped into i
 		}
 		else {
 			++i;
@@ -174,7 +469,39 @@ void PhysicsSystem::UpdateCollisionList() {
 	}
 }
 
+/*
+An object removed from the world since the last update may well have been
+deleted, so its pairs can't be left in the cache - and they can't ask the
+object itself, either. The pairs remember each object's handle instead,
+which the world stops recognising once the object's gone. Whichever object
+is left is told the collision has ended, with no object to say what with.
+*/
+void PhysicsSystem::RemoveDestroyedPairs() {
+	PROFILE_SCOPE("RemoveDestroyedPairs");
+
+	for (int i = 0; i < allCollisions.Count(); ) {
+		CachedPair& pair = allCollisions[i];
+		bool aAlive = gameWorld.GetGameObject(pair.handleA) != nullptr;
+		bool bAlive = gameWorld.GetGameObject(pair.handleB) != nullptr;
+		if (aAlive && bAlive) {
+			++i;
+			continue;
+		}
+		if (pair.began) {
+			if (aAlive) {
+				pair.info.a->OnCollisionEnd(nullptr);
+			}
+			if (bAlive) {
+				pair.info.b->OnCollisionEnd(nullptr);
+			}
+		}
+		allCollisions.RemoveAt(i); //last pair is swapped into i
+	}
+}
+
 void PhysicsSystem::UpdateObjectAABBs() {
+	PROFILE_SCOPE("UpdateObjectAABBs");
+
 	/*gameWorld.OperateOnContents(
 		[](GameObject* g) {
 			g->UpdateBroadphaseAABB();
@@ -199,6 +526,8 @@ a particular pair will only be added once, so objects colliding for
 multiple frames won't flood the set with duplicates.
 */
 void PhysicsSystem::BasicCollisionDetection() {
+	PROFILE_SCOPE("BasicCollisionDetection");
+
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
@@ -211,12 +540,16 @@ void PhysicsSystem::BasicCollisionDetection() {
 			if ((*j)->GetPhysicsObject() == nullptr){
 			continue;
 		    }
+			if (IsPairAsleep(*i, *j) || !(*i)->CanCollideWith(**j)) {
+				continue;
+			}
+			if ((*i)->GetPhysicsObject()->GetInverseMass() == 0.0f && (*j)->GetPhysicsObject()->GetInverseMass() == 0.0f) {
+				continue; //neither of them can move, so there's nothing to resolve
+			}
 		    CollisionDetection::CollisionInfo info;
 			if (CollisionDetection::ObjectIntersection(*i, *j, info)) {
 				//std::cout << "Collision between " << (*i)->GetName() << " and " << (*j)->GetName() << std::endl;
-				ImpulseResolveCollision(*info.a, *info.b, info.point);
-				info.framesLeft = numCollisionFrames;
-				allCollisions.insert(info);
+				AddContact(info);
 			}
 		}
 	}
@@ -228,194 +561,425 @@ In tutorial 5, we start determining the correct response to a collision,
 so that objects separate back out. 
 
 */
-//use elasticity and firction here
-void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	if (a.GetName() == "bonce1" && b.GetName() == "ball") {
-		Bounce1(a, b, p);
+/*
+Every collision that's been found is stored, and the ones that need a physical
+response are handed on to the solver. Gameplay collisions change global state
+and may disable objects, so they're dealt with here, in pair order, rather than
+from inside the solver's jobs.
+
+If the pair was touching last step too, each of its new contact points picks up
+the impulses from the matching old one, so the solver starts off close to the
+answer it reached last time.
+*/
+void PhysicsSystem::AddContact(CollisionDetection::CollisionInfo& info) {
+	info.framesLeft = numCollisionFrames;
+	if (ResolveGameplayCollision(*info.a, *info.b)) {
+		allCollisions.Insert(info);
 		return;
 	}
-
-	if (a.GetName() == "bonce2" && b.GetName() == "ball") {
-		Bounce2(a, b, p);
-		return;
+	CachedPair* previous = allCollisions.Find(info.a, info.b);
+	if (previous && previous->lastContactStep == solverStep - 1 && previous->info.a == info.a) {
+		MatchContactPoints(previous->info, info);
 	}
+	int pairIndex = allCollisions.Insert(info);
+	allCollisions[pairIndex].lastContactStep = solverStep;
+
+	SolverContact contact;
+	contact.pairIndex	= pairIndex;
+	contact.a			= info.a;
+	contact.b			= info.b;
+	solverContacts.emplace_back(contact);
+}
 
-	if (a.GetName() == "bonce3" && b.GetName() == "ball") {
-		Bounce3(a, b, p);
-		return;
-	}
+void PhysicsSystem::MatchContactPoints(const CollisionDetection::CollisionInfo& previous, CollisionDetection::CollisionInfo& current) {
+	bool used[CollisionDetection::MAX_CONTACT_POINTS] = { false };
 
-	if (a.GetName() == "bonce4" && b.GetName() == "ball") {
-		Bounce4(a, b, p);
-		return;
+	for (int i = 0; i < current.pointCount; ++i) {
+		CollisionDetection::ContactPoint& p = current.points[i];
+
+		int closest			= -1;
+		float closestDist	= CONTACT_MATCH_DISTANCE * CONTACT_MATCH_DISTANCE;
+		for (int j = 0; j < previous.pointCount; ++j) {
+			float dist = (previous.points[j].localA - p.localA).LengthSquared();
+			if (!used[j] && dist <= closestDist) {
+				closest		= j;
+				closestDist = dist;
+			}
+		}
+		if (closest >= 0) {
+			used[closest]			= true;
+			p.normalImpulse			= previous.points[closest].normalImpulse;
+			p.tangentImpulses[0]	= previous.points[closest].tangentImpulses[0];
+			p.tangentImpulses[1]	= previous.points[closest].tangentImpulses[1];
+		}
 	}
-	
-	if (a.GetName() == "bonus" && b.GetName() == "ball") {
-		a.SetActiveFalse();
-		a.SetBoundingVolume(nullptr);
-		TotalScore += 50;
-		return;
+}
+
+//Returns true if the collision has been handled, and needs no physical response
+/*
+Gameplay collisions are looked up by the pair's collision layers, so the
+common case - two objects that just bounce off each other - costs a single
+table lookup. Returns true if the collision shouldn't get a physical
+response as well.
+*/
+bool PhysicsSystem::ResolveGameplayCollision(GameObject& a, GameObject& b) {
+	bool ownerIsA;
+	CollisionResponse response = collisionResponses.GetResponse(a.GetCollisionLayer(), b.GetCollisionLayer(), ownerIsA);
+	if (response == CollisionResponse::Physical) {
+		return false;
 	}
-	
-	if (a.GetName() == "bonus1" && b.GetName() == "ball") {
-		a.SetActiveFalse();
-		a.SetBoundingVolume(nullptr);
-		TotalScore += 50;
-		return;
+	GameObject& owner = ownerIsA ? a : b;
+	GameObject& other = ownerIsA ? b : a;
+	const CollisionMaterial& material = collisionMaterials[owner.GetCollisionMaterial()];
+
+	switch (response) {
+		case CollisionResponse::BouncePad: {
+			BouncePadCollision(owner, other, material);
+			return true;
+		}
+		case CollisionResponse::ScorePickup: {
+			owner.SetActiveFalse();
+			owner.SetBoundingVolume(nullptr);
+			totalScore += material.score;
+			return true;
+		}
+		case CollisionResponse::Trigger: {
+			if (material.winsGame) {
+				gameWon = true;
+			}
+			if (material.losesGame) {
+				gameLost = true;
+			}
+			return false;
+		}
+		default:
+			return false;
 	}
+}
 
-	if (a.GetName() == "bonus2" && b.GetName() == "ball") {
-		a.SetActiveFalse();
-		a.SetBoundingVolume(nullptr);
-		TotalScore += 50;
-		return;
+/*
+Contacts are solved with sequential impulses. Before the iterations start,
+the objects are pushed apart (once, by the deepest point - every point in
+the contact shares the same normal), and the effective mass along the
+normal and the two friction directions is worked out for each point.
+*/
+void PhysicsSystem::PrepareContact(SolverContact& contact) {
+	CollisionDetection::CollisionInfo& info = allCollisions[contact.pairIndex].info;
+
+	PhysicsObject* physA = contact.a->GetPhysicsObject();
+	PhysicsObject* physB = contact.b->GetPhysicsObject();
+
+	Transform& transformA = contact.a->GetTransform();
+	Transform& transformB = contact.b->GetTransform();
+
+	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
+
+	contact.active = totalMass > 0.0f;
+	if (!contact.active) {
+		return; //two static objects?
 	}
 
-	if (a.GetName() == "bonus3" && b.GetName() == "ball") {
-		a.SetActiveFalse();
-		a.SetBoundingVolume(nullptr);
-		TotalScore += 50;
-		return;
+	int deepest = 0;
+	for (int i = 1; i < info.pointCount; ++i) {
+		if (info.points[i].penetration > info.points[deepest].penetration) {
+			deepest = i;
+		}
 	}
+	const CollisionDetection::ContactPoint& deepestPoint = info.points[deepest];
+	float penetration = std::max(deepestPoint.penetration - PENETRATION_SLOP, 0.0f);
 
-	if (a.GetName() == "win" && b.GetName() == "ball") {
-		gamewin = true;
+//Separate them out using projection - static objects might be shared between islands, so leave them alone
+	if (physA->GetInverseMass() > 0.0f) {
+		transformA.SetPosition(transformA.GetPosition() - (deepestPoint.normal * penetration * (physA->GetInverseMass() / totalMass)));
+	}
+	if (physB->GetInverseMass() > 0.0f) {
+		transformB.SetPosition(transformB.GetPosition() + (deepestPoint.normal * penetration * (physB->GetInverseMass() / totalMass)));
 	}
 
-	if (a.GetName() == "lose" && b.GetName() == "ball") {
-		gamelose = true;
+	Vector3 normal = deepestPoint.normal;
+	if (std::abs(normal.x) >= 0.57735f) { //any direction at right angles to the normal will do
+		contact.tangents[0] = Vector3(normal.y, -normal.x, 0.0f).Normalised();
+	}
+	else {
+		contact.tangents[0] = Vector3(0.0f, normal.z, -normal.y).Normalised();
 	}
+	contact.tangents[1] = Vector3::Cross(normal, contact.tangents[0]);
 
-	PhysicsObject* physA = a.GetPhysicsObject();
-	PhysicsObject* physB = b.GetPhysicsObject();
+	contact.friction	= sqrt(physA->GetFriction() * physB->GetFriction());
+	float cRestitution	= (physA->GetElasticity() + physB->GetElasticity()) * 0.5f;//disperse some kinectic energy
 
-	Transform& transformA = a.GetTransform();
-	Transform& transformB = b.GetTransform();
+	auto effectiveMass = [&](const Vector3& relativeA, const Vector3& relativeB, const Vector3& direction) {
+		Vector3 inertiaA = Vector3::Cross(physA->GetInertiaTensor() * Vector3::Cross(relativeA, direction), relativeA);
+		Vector3 inertiaB = Vector3::Cross(physB->GetInertiaTensor() * Vector3::Cross(relativeB, direction), relativeB);
+		return 1.0f / (totalMass + Vector3::Dot(inertiaA + inertiaB, direction));
+	};
 
-	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
+	for (int i = 0; i < info.pointCount; ++i) {
+		CollisionDetection::ContactPoint& p = info.points[i];
 
-	if (totalMass == 0) {
-		return; //two static objects?
+		contact.normalMasses[i]		= effectiveMass(p.localA, p.localB, p.normal);
+		contact.tangentMasses[i][0] = effectiveMass(p.localA, p.localB, contact.tangents[0]);
+		contact.tangentMasses[i][1] = effectiveMass(p.localA, p.localB, contact.tangents[1]);
+
+		Vector3 fullVelocityA = physA->GetLinearVelocity() + Vector3::Cross(physA->GetAngularVelocity(), p.localA);
+		Vector3 fullVelocityB = physB->GetLinearVelocity() + Vector3::Cross(physB->GetAngularVelocity(), p.localB);
+		float closingSpeed = Vector3::Dot(fullVelocityB - fullVelocityA, p.normal);
+
+		contact.velocityBiases[i] = (closingSpeed < -RESTITUTION_VELOCITY) ? -cRestitution * closingSpeed : 0.0f;
 	}
+}
 
-//Separate them out using projection
-	transformA.SetPosition(transformA.GetPosition() - (p.normal * p.penetration * (physA->GetInverseMass() / totalMass)));
+/*
+The impulses kept from last step are applied before the first iteration.
+This has to wait until every contact in the island has been prepared, or
+the bounce worked out for one contact would include the push from
+another's warm start, and stacked objects would bounce off each other.
+*/
+void PhysicsSystem::WarmStartContact(SolverContact& contact) {
+	if (!contact.active) {
+		return;
+	}
+	CollisionDetection::CollisionInfo& info = allCollisions[contact.pairIndex].info;
 
-	transformB.SetPosition(transformB.GetPosition() + (p.normal * p.penetration * (physB->GetInverseMass() / totalMass)));
+	PhysicsObject* physA = contact.a->GetPhysicsObject();
+	PhysicsObject* physB = contact.b->GetPhysicsObject();
+
+	for (int i = 0; i < info.pointCount; ++i) {
+		const CollisionDetection::ContactPoint& p = info.points[i];
+
+		Vector3 warmImpulse =	(p.normal * p.normalImpulse) +
+								(contact.tangents[0] * p.tangentImpulses[0]) +
+								(contact.tangents[1] * p.tangentImpulses[1]);
+		ApplyContactImpulse(*physA, *physB, p, warmImpulse);
+	}
+}
 
-	Vector3 relativeA = p.localA;
-	Vector3 relativeB = p.localB;
+/*
+One iteration of the solver. Each point's total normal impulse can only
+ever push the objects apart, and friction can never push harder than the
+normal impulse at that point allows - so it's the running totals that are
+clamped, not the change made this iteration.
+*/
+void PhysicsSystem::SolveContact(SolverContact& contact) {
+	if (!contact.active) {
+		return;
+	}
+	CollisionDetection::CollisionInfo& info = allCollisions[contact.pairIndex].info;
 
-	Vector3 angVelocityA = Vector3::Cross(physA->GetAngularVelocity(), relativeA);
-	Vector3 angVelocityB = Vector3::Cross(physB->GetAngularVelocity(), relativeB);
+	PhysicsObject* physA = contact.a->GetPhysicsObject();
+	PhysicsObject* physB = contact.b->GetPhysicsObject();
 
-	Vector3 fullVelocityA = physA->GetLinearVelocity() + angVelocityA;
-	Vector3 fullVelocityB = physB->GetLinearVelocity() + angVelocityB;
+	for (int i = 0; i < info.pointCount; ++i) {
+		CollisionDetection::ContactPoint& p = info.points[i];
 
-	Vector3 contactVelocity = fullVelocityB - fullVelocityA;
+		Vector3 fullVelocityA = physA->GetLinearVelocity() + Vector3::Cross(physA->GetAngularVelocity(), p.localA);
+		Vector3 fullVelocityB = physB->GetLinearVelocity() + Vector3::Cross(physB->GetAngularVelocity(), p.localB);
+		Vector3 contactVelocity = fullVelocityB - fullVelocityA;
 
-	float impulseForce = Vector3::Dot(contactVelocity, p.normal);
+		float impulseForce	= Vector3::Dot(contactVelocity, p.normal);
+		float j				= contact.normalMasses[i] * (contact.velocityBiases[i] - impulseForce);
 
-	//now to work out the effect of inertia
-	Vector3 inertiaA = Vector3::Cross(physA->GetInertiaTensor() * Vector3::Cross(relativeA, p.normal), relativeA);
-	Vector3 inertiaB = Vector3::Cross(physB->GetInertiaTensor() * Vector3::Cross(relativeB, p.normal), relativeB);
-	float angularEffect = Vector3::Dot(inertiaA + inertiaB, p.normal);
+		float oldImpulse	= p.normalImpulse;
+		p.normalImpulse		= std::max(oldImpulse + j, 0.0f);
+		ApplyContactImpulse(*physA, *physB, p, p.normal * (p.normalImpulse - oldImpulse));
 
-	float cRestitution = 0.66f;//disperse some kinectic energy
+		float maxFriction = contact.friction * p.normalImpulse;
+		if (maxFriction <= 0.0f) {
+			continue;
+		}
+		fullVelocityA	= physA->GetLinearVelocity() + Vector3::Cross(physA->GetAngularVelocity(), p.localA);
+		fullVelocityB	= physB->GetLinearVelocity() + Vector3::Cross(physB->GetAngularVelocity(), p.localB);
+		contactVelocity = fullVelocityB - fullVelocityA;
 
-	float j = (-(1.0f + cRestitution) * impulseForce) / (totalMass + angularEffect);
+		for (int t = 0; t < 2; ++t) {
+			float slideSpeed	= Vector3::Dot(contactVelocity, contact.tangents[t]);
+			float jt			= -slideSpeed * contact.tangentMasses[i][t];
 
-	Vector3 fullImpulse = p.normal * j;
+			float oldTangent		= p.tangentImpulses[t];
+			p.tangentImpulses[t]	= Maths::Clamp(oldTangent + jt, -maxFriction, maxFriction);
+			ApplyContactImpulse(*physA, *physB, p, contact.tangents[t] * (p.tangentImpulses[t] - oldTangent));
+		}
+	}
+}
 
-	physA->ApplyLinearImpulse(-fullImpulse);
-	physB->ApplyLinearImpulse(fullImpulse);
-	
-	physA->ApplyAngularImpulse(Vector3::Cross(relativeA, -fullImpulse));
-	physB->ApplyAngularImpulse(Vector3::Cross(relativeB, -fullImpulse));
+void PhysicsSystem::ApplyContactImpulse(PhysicsObject& physA, PhysicsObject& physB, const CollisionDetection::ContactPoint& p, const Vector3& impulse) {
+	physA.ApplyLinearImpulse(-impulse);
+	physB.ApplyLinearImpulse(impulse);
 
+	physA.ApplyAngularImpulse(Vector3::Cross(p.localA, -impulse));
+	physB.ApplyAngularImpulse(Vector3::Cross(p.localB, impulse));
 }
 
 void PhysicsSystem::UpdateResult(float dt) {
 	Debug::Print("Total score : ", Vector2(60, 10));
-	Debug::Print(std::to_string(TotalScore), Vector2(90, 10));
+	Debug::Print(std::to_string(totalScore), Vector2(90, 10));
 
-	if (gamewin) {
+	if (gameWon) {
 		Debug::Print("You Win", Vector2(35, 40));
 		Debug::Print("Your Score is ", Vector2(35, 45));
-		Debug::Print(std::to_string(TotalScore), Vector2(65, 45));
+		Debug::Print(std::to_string(totalScore), Vector2(65, 45));
 	}
-	if (gamelose) {
+	if (gameLost) {
 		Debug::Print("You Lose", Vector2(35, 40));
 		Debug::Print("Press F1 to Restart", Vector2(35, 45));
 		Debug::Print("Your Score is ", Vector2(35, 50));
-		Debug::Print(std::to_string(TotalScore), Vector2(65, 50));
+		Debug::Print(std::to_string(totalScore), Vector2(65, 50));
 	}
+}
 
-	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F1)) {
-		TotalScore = 0;
-		gamelose = false;
-		gamewin = false;
-	}
+void PhysicsSystem::ResetResult() {
+	totalScore	= 0;
+	gameLost	= false;
+	gameWon		= false;
 }
 
-void PhysicsSystem::Bounce1(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	PhysicsObject* physA = a.GetPhysicsObject();
-	PhysicsObject* physB = b.GetPhysicsObject();
+//Bounce pads kick whatever lands on them, rather than bouncing it back
+void PhysicsSystem::BouncePadCollision(GameObject& pad, GameObject& other, const CollisionMaterial& material) const {
+	PhysicsObject* physPad		= pad.GetPhysicsObject();
+	PhysicsObject* physOther	= other.GetPhysicsObject();
 
-	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
+	float totalMass = physPad->GetInverseMass() + physOther->GetInverseMass();
 
 	if (totalMass == 0) {
 		return;
 	}
 
-	physB->ApplyLinearImpulse(Vector3(-0.05, 0, 0));
+	physOther->ApplyLinearImpulse(material.linearImpulse);
 
-	physB->ApplyAngularImpulse(Vector3(0, 0, 0));
+	physOther->ApplyAngularImpulse(material.angularImpulse);
 }
 
-void PhysicsSystem::Bounce2(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	PhysicsObject* physA = a.GetPhysicsObject();
-	PhysicsObject* physB = b.GetPhysicsObject();
-
-	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
+/*
+Continuous collision detection for bullets. Each awake bullet is swept from
+where it is now to where its velocity will take it this step, against
+everything it'd physically bounce off. The time of impact is found by
+conservative advancement - GJK says how far apart the two volumes are,
+and as nothing can close that gap faster than the bullet is moving towards
+the other object, it's safe to move it that far along its path and ask
+again, until it's close enough to count as touching.
+
+Only the bullet's straight line motion is swept - it keeps the orientation
+it starts the step with. On a hit, the pair bounce off each other there and
+then, and once the step's been integrated the bullet is put back where it
+hit, losing the rest of the step's movement.
+*/
+void PhysicsSystem::ContinuousCollisions(float dt) {
+	PROFILE_SCOPE("ContinuousCollisions");
 
-	if (totalMass == 0) {
-		return;
-	}
+	bulletHits.clear();
 
-	physB->ApplyLinearImpulse(Vector3(0, 0, 0.1));
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
 
-	physB->ApplyAngularImpulse(Vector3(0.1, 0, 0));
-}
+	for (auto i = first; i != last; ++i) {
+		GameObject* bullet = *i;
+		PhysicsObject* physBullet = bullet->GetPhysicsObject();
+		if (!physBullet || !physBullet->IsBullet() || physBullet->IsAsleep() || !bullet->GetBoundingVolume()) {
+			continue;
+		}
+		Vector3 motion = physBullet->GetLinearVelocity() * dt;
+
+		Vector3 halfSize;
+		bullet->UpdateBroadphaseAABB();
+		bullet->GetBroadphaseAABB(halfSize);
+		float smallestHalfSize = std::min(halfSize.x, std::min(halfSize.y, halfSize.z));
+		if (motion.LengthSquared() <= smallestHalfSize * smallestHalfSize) {
+			continue; //too slow to pass through anything without the discrete tests seeing it
+		}
 
-void PhysicsSystem::Bounce3(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	PhysicsObject* physA = a.GetPhysicsObject();
-	PhysicsObject* physB = b.GetPhysicsObject();
+		Vector3 start	= bullet->GetTransform().GetPosition();
+		Vector3 end		= start + motion;
+		Vector3 sweepMin;
+		Vector3 sweepMax;
+		for (int axis = 0; axis < 3; ++axis) {
+			sweepMin[axis] = std::min(start[axis], end[axis]) - halfSize[axis];
+			sweepMax[axis] = std::max(start[axis], end[axis]) + halfSize[axis];
+		}
 
-	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
+		sweepCandidates.clear();
+		if (useBroadPhase && broadPhaseType == BroadPhaseType::AABBTree) {
+			broadphaseTree.Query(sweepMin, sweepMax, [&](int proxy) {
+				sweepCandidates.emplace_back(broadphaseTree.GetObject(proxy));
+			});
+			staticTree.Query(sweepMin, sweepMax, [&](int proxy) {
+				sweepCandidates.emplace_back(staticTree.GetObject(proxy));
+			});
+		}
+		else {
+			for (auto j = first; j != last; ++j) {
+				Vector3 otherSize;
+				if (useBroadPhase && (*j)->GetBroadphaseAABB(otherSize) &&
+					!CollisionDetection::AABBTest((sweepMin + sweepMax) * 0.5f, (*j)->GetTransform().GetPosition(), (sweepMax - sweepMin) * 0.5f, otherSize)) {
+					continue;
+				}
+				sweepCandidates.emplace_back(*j);
+			}
+		}
 
-	if (totalMass == 0) {
-		return;
+		GameObject* hitObject = nullptr;
+		float	firstHit = 1.0f;
+		Vector3	hitNormal;
+		for (GameObject* other : sweepCandidates) {
+			if (other == bullet || !other->GetPhysicsObject() || !other->GetBoundingVolume() || !bullet->CanCollideWith(*other)) {
+				continue;
+			}
+			bool ownerIsA;
+			if (collisionResponses.GetResponse(bullet->GetCollisionLayer(), other->GetCollisionLayer(), ownerIsA) != CollisionResponse::Physical) {
+				continue; //pickups and triggers have to be touched to do anything, so let bullets go into them
+			}
+			Vector3 relativeMotion = motion - (other->GetPhysicsObject()->GetLinearVelocity() * dt);
+			float	toi;
+			Vector3	normal;
+			if (TimeOfImpact(*bullet, *other, relativeMotion, toi, normal) && toi < firstHit) {
+				firstHit	= toi;
+				hitObject	= other;
+				hitNormal	= normal;
+			}
+		}
+		if (!hitObject) {
+			continue;
+		}
+		//bounce them off each other now, as they won't overlap for the discrete tests to see
+		PhysicsObject* physOther = hitObject->GetPhysicsObject();
+		float totalMass = physBullet->GetInverseMass() + physOther->GetInverseMass();
+		float closingSpeed = Vector3::Dot(physBullet->GetLinearVelocity() - physOther->GetLinearVelocity(), hitNormal);
+		if (totalMass > 0.0f && closingSpeed > 0.0f) {
+			float restitution = (physBullet->GetElasticity() + physOther->GetElasticity()) * 0.5f;
+			Vector3 impulse = hitNormal * (-(1.0f + restitution) * closingSpeed / totalMass);
+			physBullet->ApplyLinearImpulse(impulse);
+			physOther->ApplyLinearImpulse(-impulse);
+		}
+		if (firstHit > 0.0f) { //if it's already touching, taking its velocity away is enough
+			bulletHits.push_back({ bullet, start + motion * firstHit });
+		}
 	}
-
-	physB->ApplyLinearImpulse(Vector3(0.1, 0, 0));
-
-	physB->ApplyAngularImpulse(Vector3(0, 0, 0.1));
 }
 
-void PhysicsSystem::Bounce4(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
-	PhysicsObject* physA = a.GetPhysicsObject();
-	PhysicsObject* physB = b.GetPhysicsObject();
-
-	float totalMass = physA->GetInverseMass() + physB->GetInverseMass();
-
-	if (totalMass == 0) {
-		return;
+/*
+Returns true if moving the bullet along its motion would make it touch the
+other object, along with how far along it that happens (0 to 1), and the
+normal from the bullet to the other object there. Bullets that are already
+touching something are left to the discrete tests.
+*/
+bool PhysicsSystem::TimeOfImpact(GameObject& bullet, GameObject& other, const Vector3& motion, float& toi, Vector3& normal) const {
+	const CollisionVolume* volumeA = bullet.GetBoundingVolume();
+	const CollisionVolume* volumeB = other.GetBoundingVolume();
+	if (!CollisionDetection::IsConvex(*volumeA) || !CollisionDetection::IsConvex(*volumeB)) {
+		return false;
 	}
+	if (!CollisionDetection::ConvexCast(*volumeA, bullet.GetTransform(), motion, *volumeB, other.GetTransform(), CCD_TARGET_DISTANCE, toi, normal)) {
+		return false;
+	}
+	return toi > 0.0f || normal.LengthSquared() > 0.0f;
+}
 
-	physB->ApplyLinearImpulse(Vector3(0.1, 2.0, 0));
+void PhysicsSystem::ClampBullets() {
+	PROFILE_SCOPE("ClampBullets");
 
-	physB->ApplyAngularImpulse(Vector3(0, 0, 0));
+	for (const BulletHit& hit : bulletHits) {
+		hit.object->GetTransform().SetPosition(hit.position);
+	}
 }
 
 /*
@@ -427,52 +991,287 @@ compare the collisions that we absolutely need to.
 
 */
 
-//octrees exchange
 void PhysicsSystem::BroadPhase() {
+	PROFILE_SCOPE("BroadPhase");
+
+	if (broadPhaseType == BroadPhaseType::SweepAndPrune) {
+		SweepAndPruneBroadPhase();
+	}
+	else {
+		TreeBroadPhase();
+	}
+}
+
+/*
+The broadphase tree is kept between frames. Each step we only have to
+reinsert the objects that have moved outside of their fat AABB, and only
+those objects can have gained any new pairs. A pair where neither object
+moved has the same fat AABBs as last step, so it can just be kept.
+
+Objects that can't move (they have no inverse mass) live in their own
+tree, which is only ever looked at by the moving objects - nothing in it
+is tested against anything else in it. Static objects do still get
+reinserted if something moves them, but that's rare.
+*/
+void PhysicsSystem::TreeBroadPhase() {
+	UpdateProxies(broadphaseTree);
+
+	auto hasMoved = [&](const GameObject* o) {
+		int proxy = o->GetBroadphaseProxy();
+		if (proxy < 0) {
+			return true;
+		}
+		return staticTree.IsValidProxy(proxy, (GameObject*)o) ? staticTree.HasMoved(proxy) : broadphaseTree.HasMoved(proxy);
+	};
+	broadphaseCollisions.erase(std::remove_if(broadphaseCollisions.begin(), broadphaseCollisions.end(),
+		[&](const CollisionDetection::CollisionInfo& pair) {
+			return hasMoved(pair.a) || hasMoved(pair.b);
+		}), broadphaseCollisions.end());
+
+	for (int proxy : movedProxies) {
+		Vector3 fatMin;
+		Vector3 fatMax;
+		broadphaseTree.GetFatAABB(proxy, fatMin, fatMax);
+		GameObject* object = broadphaseTree.GetObject(proxy);
+
+		broadphaseTree.Query(fatMin, fatMax, [&](int other) {
+			if (other == proxy) {
+				return;
+			}
+			if (broadphaseTree.HasMoved(other) && other < proxy) {
+				return; //pair will be found when 'other' queries the tree
+			}
+			AddBroadphasePair(object, broadphaseTree.GetObject(other));
+		});
+		staticTree.Query(fatMin, fatMax, [&](int other) {
+			AddBroadphasePair(object, staticTree.GetObject(other));
+		});
+	}
+	//static objects that have been moved pick up the moving objects that didn't move
+	for (int proxy : movedStaticProxies) {
+		Vector3 fatMin;
+		Vector3 fatMax;
+		staticTree.GetFatAABB(proxy, fatMin, fatMax);
+		GameObject* object = staticTree.GetObject(proxy);
+
+		broadphaseTree.Query(fatMin, fatMax, [&](int other) {
+			if (!broadphaseTree.HasMoved(other)) {
+				AddBroadphasePair(object, broadphaseTree.GetObject(other));
+			}
+		});
+	}
+	for (int proxy : movedProxies) {
+		broadphaseTree.ClearMoved(proxy);
+	}
+	for (int proxy : movedStaticProxies) {
+		staticTree.ClearMoved(proxy);
+	}
+	movedProxies.clear();
+	movedStaticProxies.clear();
+}
+
+/*
+Sweep and prune doesn't keep its pairs between steps, but as its endpoint
+lists stay sorted between frames, finding them all again is cheap. Box
+pairs do lose the axis their last SAT test cached, though. Only moving
+objects are swept - each awake one then looks itself up in the static tree.
+*/
+void PhysicsSystem::SweepAndPruneBroadPhase() {
+	UpdateProxies(broadphaseSAP);
+	movedProxies.clear();
+	for (int proxy : movedStaticProxies) {
+		staticTree.ClearMoved(proxy);
+	}
+	movedStaticProxies.clear();
+
 	broadphaseCollisions.clear();
-	QuadTree<GameObject*> tree(Vector2(1024, 1024), 7, 6);
+	broadphaseSAP.FindPairs([&](GameObject* a, GameObject* b) {
+		if (!IsPairAsleep(a, b)) {
+			AddBroadphasePair(a, b);
+		}
+	});
 
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
 	gameWorld.GetObjectIterators(first, last);
 	for (auto i = first; i != last; ++i) {
-		Vector3 halfSizes;
-		if (!(*i)->GetBroadphaseAABB(halfSizes)) {
+		GameObject* object = *i;
+		if (!broadphaseSAP.IsValidProxy(object->GetBroadphaseProxy(), object) || object->GetPhysicsObject()->IsAsleep()) {
 			continue;
 		}
-		Vector3 pos = (*i)->GetTransform().GetPosition();
-		tree.Insert(*i, pos, halfSizes);
+		Vector3 halfSizes;
+		object->GetBroadphaseAABB(halfSizes);
+		Vector3 pos = object->GetTransform().GetPosition();
+		staticTree.Query(pos - halfSizes, pos + halfSizes, [&](int other) {
+			AddBroadphasePair(object, staticTree.GetObject(other));
+		});
 	}
+}
 
-	tree.OperateOnContents([&](std::list<QuadTreeEntry<GameObject*>>& data) {
-		CollisionDetection::CollisionInfo info;
-		    for (auto i = data.begin(); i != data.end(); ++i) {
-		    	for (auto j = std::next(i); j != data.end(); ++j) {
-		    		//is this pair of items already in the collision set
-		    		//if the same pair is in another quadtree node together etc
-		    		info.a = min((*i).object, (*j).object);
-		    		info.b = max((*i).object, (*j).object);
-		    		broadphaseCollisions.insert(info);
-		    	}
-		    }
-		});
+//Pairs are ordered by world ID, to match the order BasicCollisionDetection uses
+void PhysicsSystem::AddBroadphasePair(GameObject* a, GameObject* b) {
+	if (!a->CanCollideWith(*b)) { //their layers never interact
+		return;
+	}
+	CollisionDetection::CollisionInfo info;
+	if (a->GetWorldID() < b->GetWorldID()) {
+		info.a = a;
+		info.b = b;
+	}
+	else {
+		info.a = b;
+		info.b = a;
+	}
+	broadphaseCollisions.emplace_back(info);
+}
+
+template<class BroadPhaseStructure>
+void PhysicsSystem::UpdateProxies(BroadPhaseStructure& structure) {
+	broadphaseFrame++;
+
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
+	for (auto i = first; i != last; ++i) {
+		GameObject* o	= *i;
+		int proxy		= o->GetBroadphaseProxy();
+		bool wasStatic	= staticTree.IsValidProxy(proxy, o);
+		if (!wasStatic && !structure.IsValidProxy(proxy, o)) {
+			proxy = -1;
+		}
+		Vector3 halfSizes;
+		bool isStatic = o->GetPhysicsObject() && o->GetPhysicsObject()->GetInverseMass() == 0.0f;
+		if (!o->GetPhysicsObject() || !o->GetBroadphaseAABB(halfSizes) || (proxy >= 0 && wasStatic != isStatic)) {
+			if (proxy >= 0) { //lost its volume, or gained or lost its mass, since last step
+				if (wasStatic) {
+					staticTree.Remove(proxy);
+				}
+				else {
+					structure.Remove(proxy);
+				}
+			}
+			o->SetBroadphaseProxy(-1);
+			proxy = -1;
+			if (!o->GetPhysicsObject() || !o->GetBroadphaseAABB(halfSizes)) {
+				continue;
+			}
+		}
+		Vector3 pos = o->GetTransform().GetPosition();
+
+		if (isStatic) {
+			UpdateProxy(staticTree, o, proxy, pos, halfSizes, movedStaticProxies);
+		}
+		else {
+			UpdateProxy(structure, o, proxy, pos, halfSizes, movedProxies);
+		}
+	}
+	RemoveStaleProxies(structure);
+	RemoveStaleProxies(staticTree);
+}
+
+template<class BroadPhaseStructure>
+void PhysicsSystem::UpdateProxy(BroadPhaseStructure& structure, GameObject* o, int proxy,
+	const Vector3& pos, const Vector3& halfSizes, std::vector<int>& moved) {
+	if (proxy < 0) {
+		proxy = structure.Insert(o, pos, halfSizes);
+		o->SetBroadphaseProxy(proxy);
+		moved.emplace_back(proxy);
+	}
+	else if (structure.Update(proxy, pos, halfSizes)) {
+		moved.emplace_back(proxy);
+	}
+	structure.SetLastSeen(proxy, broadphaseFrame);
+}
+
+/*
+Objects that have been removed from the world since the last step will
+still have a proxy in the broadphase, and may be in the pair list. They
+might have been deleted, so they're only ever compared by address here.
+*/
+template<class BroadPhaseStructure>
+void PhysicsSystem::RemoveStaleProxies(BroadPhaseStructure& structure) {
+	staleObjects.clear();
+	structure.OperateOnStaleProxies(broadphaseFrame, [&](int proxy) {
+		staleObjects.emplace_back(structure.GetObject(proxy));
+		structure.Remove(proxy);
+	});
+	if (staleObjects.empty()) {
+		return;
+	}
+	broadphaseCollisions.erase(std::remove_if(broadphaseCollisions.begin(), broadphaseCollisions.end(),
+		[&](const CollisionDetection::CollisionInfo& pair) {
+			return	std::find(staleObjects.begin(), staleObjects.end(), pair.a) != staleObjects.end() ||
+					std::find(staleObjects.begin(), staleObjects.end(), pair.b) != staleObjects.end();
+		}), broadphaseCollisions.end());
 }
 
 /*
 
 The broadphase will now only give us likely collisions, so we can now go through them,
-and work out if they are truly colliding, and if so, add them into the main collision list
+and work out if they are truly colliding, and if so, add them into the main collision list.
+
+The intersection tests only read from the objects, so they can be split up across the
+job system, with each thread writing its contacts into its own buffer. Once they're all
+done, the buffers are merged back into pair order before any collisions are resolved, so
+the results don't depend on which thread happened to test which pair.
+The contacts aren't resolved here, but collected up for the island solver.
 */
 void PhysicsSystem::NarrowPhase() {
-	for (std::set<CollisionDetection::CollisionInfo>::iterator
-		i = broadphaseCollisions.begin();
-		i != broadphaseCollisions.end(); ++i) {
-		CollisionDetection::CollisionInfo info = *i;
-		if (CollisionDetection::ObjectIntersection(info.a, info.b, info)) {
-			info.framesLeft = numCollisionFrames;
-			ImpulseResolveCollision(*info.a, *info.b, info.point);
-			allCollisions.insert(info);//insert into our main set
+	PROFILE_SCOPE("NarrowPhase");
+
+	int pairCount	= (int)broadphaseCollisions.size();
+	int threadCount = jobSystem ? jobSystem->GetThreadCount() : 1;
+
+	if ((int)threadContacts.size() < threadCount) {
+		threadContacts.resize(threadCount);
+	}
+	for (std::vector<NarrowPhaseContact>& buffer : threadContacts) {
+		buffer.clear();
+	}
+
+	auto testPairs = [&](int start, int end, int threadIndex) {
+		PROFILE_SCOPE("NarrowPhase Batch");
+		std::vector<NarrowPhaseContact>& buffer = threadContacts[threadIndex];
+		for (int i = start; i < end; ++i) {
+			CollisionDetection::CollisionInfo info = broadphaseCollisions[i];
+			if (IsPairAsleep(info.a, info.b)) { //the tree keeps sleeping pairs around, ready for when they wake
+				continue;
+			}
+			bool colliding = CollisionDetection::ObjectIntersection(info.a, info.b, info);
+			broadphaseCollisions[i].cachedAxis = info.cachedAxis; //only this job touches pair i
+
+			if (colliding) {
+				buffer.push_back({ i, info });
+			}
 		}
+	};
+	ParallelFor(pairCount, NARROWPHASE_CHUNK_SIZE, testPairs);
+
+	mergedContacts.clear();
+	for (const std::vector<NarrowPhaseContact>& buffer : threadContacts) {
+		mergedContacts.insert(mergedContacts.end(), buffer.begin(), buffer.end());
+	}
+	/*
+	The broadphase's pair order depends on the shape its trees have grown
+	into, so in deterministic mode contacts go in the order of their world
+	IDs instead, which only depends on what's in the world.
+	*/
+	if (deterministic) {
+		std::sort(mergedContacts.begin(), mergedContacts.end(),
+			[](const NarrowPhaseContact& a, const NarrowPhaseContact& b) {
+				return	CollisionPairCache::MakeKey(a.info.a->GetWorldID(), a.info.b->GetWorldID()) <
+						CollisionPairCache::MakeKey(b.info.a->GetWorldID(), b.info.b->GetWorldID());
+			});
+	}
+	else {
+		std::sort(mergedContacts.begin(), mergedContacts.end(),
+			[](const NarrowPhaseContact& a, const NarrowPhaseContact& b) {
+				return a.pairIndex < b.pairIndex;
+			});
+	}
+
+	for (NarrowPhaseContact& contact : mergedContacts) {
+		AddContact(contact.info);
 	}
 }
 
@@ -483,43 +1282,40 @@ without worrying about repeated forces accumulating etc.
 
 This function will update both linear and angular acceleration,
 based on any forces that have been accumulated in the objects during
-the course of the previous game frame.
+the course of the previous game frame. The linear part is done by the
+SIMD kernels in IntegrationKernels, but the inertia tensors are still
+one matrix at a time.
 */
 void PhysicsSystem::IntegrateAccel(float dt) {
-	std::vector<GameObject*>::const_iterator first;
-	std::vector<GameObject*>::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
+	PROFILE_SCOPE("IntegrateAccel");
 
-	for (auto i = first; i != last; ++i)
-	{
-		PhysicsObject* object = (*i)->GetPhysicsObject();
-		if (object == nullptr)
-		{
-			continue;  //no physics object for this gameobject
-		}
-		float inverseMass = object->GetInverseMass();
+	RigidBodyStore& bodies = gameWorld.GetBodyStore();
+	int bodyCount = bodies.GetBodyCount();
 
-		Vector3 linearVel = object->GetLinearVelocity();
-		Vector3 force = object->GetForce();
-		Vector3 accel = force * inverseMass;
+	bodies.GatherTransforms(); //inertia tensors follow the current orientation
 
-		if (applyGravity && inverseMass > 0)
-		{
-			accel += gravity; // don't move infinitely heavy things
-		}
+	Vector3 gravityStep = applyGravity ? gravity * dt : Vector3();
 
-		linearVel += accel * dt; //integrate accel
-		object->SetLinearVelocity(linearVel);
+	auto integrateLinear = [&](int start, int end, int /*threadIndex*/) {
+		PROFILE_SCOPE("IntegrateAccel Batch");
+		IntegrationKernels::IntegrateLinearAccel(bodies, start, end, gravityStep, dt);
+	};
+	ParallelFor(bodyCount, INTEGRATION_CHUNK_SIZE, integrateLinear);
 
-		Vector3 torque = object->GetTorque();
-		Vector3 angVel = object->GetAngularVelocity();
+	const char* asleep = bodies.sleeping.data();
+	for (int i = 0; i < bodyCount; ++i) {
+		if (asleep[i]) {
+			continue;
+		}
+		Quaternion q = bodies.orientations.Get(i);
+		Matrix3 orientation		= Matrix3(q);
+		Matrix3 invOrientation	= Matrix3(q.Conjugate());
 
-		object->UpdateInertiaTensor(); //update tensor vs orientation
-		
-		Vector3 angAccel = object->GetInertiaTensor() * torque;
+		Matrix3& tensor = bodies.inverseInertiaTensors[i]; //update tensor vs orientation
+		tensor = orientation * Matrix3::Scale(bodies.inverseInertias.Get(i)) * invOrientation;
 
-		angVel += angAccel * dt; //integrate angular accel
-		object->SetAngularVelocity(angVel);
+		Vector3 angAccel = tensor * bodies.torques.Get(i);
+		bodies.angularVelocities.Set(i, bodies.angularVelocities.Get(i) + angAccel * dt); //integrate angular accel
 	}
 }
 /*
@@ -529,41 +1325,27 @@ throughout a physics update, to slowly move the objects through
 the world, looking for collisions.
 */
 void PhysicsSystem::IntegrateVelocity(float dt) {
-	std::vector<GameObject*>::const_iterator first;
-	std::vector<GameObject*>::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
-	float frameLinearDamping = 1.0f - (0.4f * dt);
+	PROFILE_SCOPE("IntegrateVelocity");
 
-	for (auto i = first; i != last; ++i)
-	{
-		PhysicsObject* object = (*i)->GetPhysicsObject();
-		if (object == nullptr)
-		{
-			continue;
-		}
-		Transform& transform = (*i)->GetTransform();
-		//position stuff
-		Vector3 position = transform.GetPosition();
-		Vector3 linearVel = object->GetLinearVelocity();
-		position += linearVel * dt;
-		transform.SetPosition(position);
-		//linear damping
-		linearVel = linearVel * frameLinearDamping;
-		object->SetLinearVelocity(linearVel);
+	RigidBodyStore& bodies = gameWorld.GetBodyStore();
+	int bodyCount = bodies.GetBodyCount();
 
-		Quaternion orientation = transform.GetOrientation();
-		Vector3 angVel = object->GetAngularVelocity();
+	bodies.GatherTransforms(); //collision resolution may have moved things
 
-		orientation = orientation + (Quaternion(angVel * dt * 0.5f, 0.0f) * orientation);
-		orientation.Normalise();
+	IntegrationKernels::VelocityParams params;
+	params.dt				= dt;
+	params.linearDamping	= 1.0f - (0.4f * dt);
+	params.angularDamping	= 1.0f - (0.4f * dt);
+	params.linearSleepSq	= SLEEP_LINEAR_VELOCITY * SLEEP_LINEAR_VELOCITY;
+	params.angularSleepSq	= SLEEP_ANGULAR_VELOCITY * SLEEP_ANGULAR_VELOCITY;
 
-		transform.SetOrientation(orientation);
+	auto integrate = [&](int start, int end, int /*threadIndex*/) {
+		PROFILE_SCOPE("IntegrateVelocity Batch");
+		IntegrationKernels::IntegrateVelocity(bodies, start, end, params);
+	};
+	ParallelFor(bodyCount, INTEGRATION_CHUNK_SIZE, integrate);
 
-		//damp the angular velocity too
-		float frameAngularDamping = 1.0f - (0.4f * dt);
-		angVel = angVel * frameAngularDamping;
-		object->SetAngularVelocity(angVel);
-	}
+	bodies.ScatterTransforms();
 }
 
 /*
@@ -572,11 +1354,15 @@ clear out any accumulated forces, ready to receive new
 ones in the next 'game' frame.
 */
 void PhysicsSystem::ClearForces() {
-	gameWorld.OperateOnContents(
-		[](GameObject* o) {
-			o->GetPhysicsObject()->ClearForces();
-		}
-	);
+	PROFILE_SCOPE("ClearForces");
+
+	RigidBodyStore& bodies = gameWorld.GetBodyStore();
+	std::fill(bodies.forces.x.begin(), bodies.forces.x.end(), 0.0f);
+	std::fill(bodies.forces.y.begin(), bodies.forces.y.end(), 0.0f);
+	std::fill(bodies.forces.z.begin(), bodies.forces.z.end(), 0.0f);
+	std::fill(bodies.torques.x.begin(), bodies.torques.x.end(), 0.0f);
+	std::fill(bodies.torques.y.begin(), bodies.torques.y.end(), 0.0f);
+	std::fill(bodies.torques.z.begin(), bodies.torques.z.end(), 0.0f);
 }
 
 
@@ -586,13 +1372,210 @@ As part of the final physics tutorials, we add in the ability
 to constrain objects based on some extra calculation, allowing
 us to model springs and ropes etc. 
 
+Contacts and constraints only ever change the two objects they connect,
+so we can use a union-find to group connected objects into islands, and
+then solve each island on its own, on whichever thread is free. Static
+objects don't join islands together, as nothing can move them - a floor
+with two separate piles of boxes on it is still two islands.
+
+Islands are numbered in the order of their first object in the world, and
+each island solves its contacts and constraints in the order they were
+found, so the results don't depend on how many threads there are.
+
+Islands are also what we put to sleep - once every body in an island has
+been still for long enough, the whole island sleeps, and if any body in
+it is awake (maybe something awake has just hit it), the whole island is
+woken up again. A single body can't sleep while it's propping up another.
 */
-void PhysicsSystem::UpdateConstraints(float dt) {
-	std::vector<Constraint*>::const_iterator first;
-	std::vector<Constraint*>::const_iterator last;
-	gameWorld.GetConstraintIterators(first, last);
+bool PhysicsSystem::IsPairAsleep(const GameObject* a, const GameObject* b) {
+	const PhysicsObject* physA = a->GetPhysicsObject();
+	const PhysicsObject* physB = b->GetPhysicsObject();
+	if (!physA || !physB) {
+		return false;
+	}
+	const RigidBodyStore& bodies = physA->GetBodyStore();
+	int indexA = physA->GetBodyIndex();
+	int indexB = physB->GetBodyIndex();
+
+	bool sleepingA	= bodies.sleeping[indexA] != 0;
+	bool sleepingB	= bodies.sleeping[indexB] != 0;
+	bool awakeA		= !sleepingA && bodies.inverseMasses[indexA] > 0.0f;
+	bool awakeB		= !sleepingB && bodies.inverseMasses[indexB] > 0.0f;
+
+	return (sleepingA || sleepingB) && !awakeA && !awakeB;
+}
+
+int PhysicsSystem::GetIslandBody(GameObject* o) const {
+	PhysicsObject* phys = o->GetPhysicsObject();
+	if (!phys) {
+		return -1;
+	}
+	int body = phys->GetIslandIndex();
+	return body < islandBodyCount ? body : -1;
+}
+
+int PhysicsSystem::FindIslandRoot(int body) {
+	while (islandParents[body] != body) {
+		islandParents[body] = islandParents[islandParents[body]];
+		body = islandParents[body];
+	}
+	return body;
+}
+
+void PhysicsSystem::JoinIslands(GameObject* a, GameObject* b) {
+	int bodyA = GetIslandBody(a);
+	int bodyB = GetIslandBody(b);
+	if (bodyA < 0 || bodyB < 0) {
+		return;
+	}
+	int rootA = FindIslandRoot(bodyA);
+	int rootB = FindIslandRoot(bodyB);
+	if (rootA < rootB) { //lowest body is always the root, to keep things deterministic
+		islandParents[rootB] = rootA;
+	}
+	else if (rootB < rootA) {
+		islandParents[rootA] = rootB;
+	}
+}
+
+int PhysicsSystem::GetIsland(GameObject* a, GameObject* b) {
+	int body = GetIslandBody(a);
+	if (body < 0) {
+		body = GetIslandBody(b);
+	}
+	return body < 0 ? -1 : islandIDs[FindIslandRoot(body)];
+}
+
+void PhysicsSystem::BuildIslands() {
+	PROFILE_SCOPE("BuildIslands");
+
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetObjectIterators(first, last);
 
+	islandBodyCount = 0;
+	islandBodies.clear();
 	for (auto i = first; i != last; ++i) {
-		(*i)->UpdateConstraint(dt);
+		PhysicsObject* phys = (*i)->GetPhysicsObject();
+		if (!phys) {
+			continue;
+		}
+		if (phys->GetInverseMass() > 0.0f) {
+			phys->SetIslandIndex(islandBodyCount++);
+			islandBodies.emplace_back(phys);
+		}
+		else {
+			phys->SetIslandIndex(-1);
+		}
+	}
+	islandParents.resize(islandBodyCount);
+	for (int i = 0; i < islandBodyCount; ++i) {
+		islandParents[i] = i;
 	}
-}
\ No newline at end of file
+
+	std::vector<Constraint*>::const_iterator firstConstraint;
+	std::vector<Constraint*>::const_iterator lastConstraint;
+	gameWorld.GetConstraintIterators(firstConstraint, lastConstraint);
+
+	for (const SolverContact& contact : solverContacts) {
+		JoinIslands(contact.a, contact.b);
+	}
+	for (auto i = firstConstraint; i != lastConstraint; ++i) {
+		JoinIslands((*i)->GetObjectA(), (*i)->GetObjectB());
+	}
+
+	islandCount = 0;
+	islandIDs.assign(islandBodyCount, -1);
+	for (int i = 0; i < islandBodyCount; ++i) {
+		int root = FindIslandRoot(i);
+		if (islandIDs[root] < 0) {
+			islandIDs[root] = islandCount++;
+		}
+	}
+	if ((int)islands.size() < islandCount) {
+		islands.resize(islandCount);
+	}
+	for (int i = 0; i < islandCount; ++i) { //keep the old allocations around
+		islands[i].bodies.clear();
+		islands[i].contacts.clear();
+		islands[i].constraints.clear();
+	}
+	for (int i = 0; i < islandBodyCount; ++i) {
+		islands[islandIDs[FindIslandRoot(i)]].bodies.emplace_back(islandBodies[i]);
+	}
+	for (int i = 0; i < islandCount; ++i) {
+		UpdateIslandSleep(islands[i]);
+	}
+
+	for (int i = 0; i < (int)solverContacts.size(); ++i) {
+		int island = GetIsland(solverContacts[i].a, solverContacts[i].b);
+		if (island >= 0) { //two static objects can't respond to each other anyway
+			islands[island].contacts.emplace_back(i);
+		}
+	}
+	for (auto i = firstConstraint; i != lastConstraint; ++i) {
+		int island = GetIsland((*i)->GetObjectA(), (*i)->GetObjectB());
+		if (island >= 0) {
+			islands[island].constraints.emplace_back(*i);
+		}
+	}
+}
+
+void PhysicsSystem::UpdateIslandSleep(PhysicsIsland& island) {
+	float minSleepTime = FLT_MAX;
+	for (PhysicsObject* body : island.bodies) {
+		minSleepTime = std::min(minSleepTime, body->GetSleepTime());
+	}
+	island.asleep = useSleeping && minSleepTime >= TIME_TO_SLEEP;
+
+	for (PhysicsObject* body : island.bodies) {
+		if (island.asleep) {
+			body->Sleep();
+		}
+		else {
+			body->Wake();
+		}
+	}
+}
+
+/*
+This is our simple iterative solver - we just run things multiple
+times, slowly moving things forward and then rechecking that the
+constraints have been met. As contacts are warm started from the
+last step, only a few iterations are needed for things to stack.
+*/
+void PhysicsSystem::SolveIslands(float dt) {
+	PROFILE_SCOPE("SolveIslands");
+
+	float constraintDt = dt / (float)constraintIterationCount;
+
+	auto solveIslands = [&](int start, int end, int /*threadIndex*/) {
+		PROFILE_SCOPE("SolveIslands Batch");
+		for (int i = start; i < end; ++i) {
+			PhysicsIsland& island = islands[i];
+			if (island.asleep) {
+				continue;
+			}
+			for (int contact : island.contacts) {
+				PrepareContact(solverContacts[contact]);
+			}
+			for (int contact : island.contacts) {
+				WarmStartContact(solverContacts[contact]);
+			}
+			int iterations = std::max(contactIterationCount, island.constraints.empty() ? 0 : constraintIterationCount);
+			for (int iteration = 0; iteration < iterations; ++iteration) {
+				if (iteration < contactIterationCount) {
+					for (int contact : island.contacts) {
+						SolveContact(solverContacts[contact]);
+					}
+				}
+				if (iteration < constraintIterationCount) {
+					for (Constraint* c : island.constraints) {
+						c->UpdateConstraint(constraintDt);
+					}
+				}
+			}
+		}
+	};
+	ParallelFor(islandCount, 1, solveIslands);
+}
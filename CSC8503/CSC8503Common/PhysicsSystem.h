@@ -1,9 +1,71 @@
 #pragma once
 #include "../CSC8503Common/GameWorld.h"
-#include <set>
+#include "AABBTree.h"
+#include "SweepAndPrune.h"
+#include "CollisionPairCache.h"
+#include "CollisionResponse.h"
+#include "RigidBodyStore.h"
+#include "../../Common/JobSystem.h"
 
 namespace NCL {
 	namespace CSC8503 {
+		enum class BroadPhaseType {
+			AABBTree,
+			SweepAndPrune
+		};
+
+		/*
+		How long the last Update spent in each part of the physics, in
+		milliseconds - added up over however many steps it took - and how
+		many pairs the last of those steps had to deal with.
+		*/
+		struct PhysicsStats {
+			int		steps				= 0;
+			float	integrateTime		= 0.0f;	//forces, velocities and positions, including bullet sweeps
+			float	broadphaseTime		= 0.0f;
+			float	narrowphaseTime		= 0.0f;
+			float	solveTime			= 0.0f;	//building the islands and solving them
+			float	collisionListTime	= 0.0f;	//begin and end events, and pairs left by removed objects
+
+			int		broadphasePairs		= 0;
+			int		contactPairs		= 0;	//pairs touching with a physical response
+			int		cachedPairs			= 0;	//pairs in the collision list, triggers and all
+			int		islands				= 0;
+		};
+
+		/*
+		Everything the physics system carries over from one step to the
+		next - the bodies, the broadphase, and the contact impulses kept
+		for warm starting - so that restoring it and stepping again gives
+		exactly the same results as the first time round. Like the world
+		snapshot it holds, it's meant to be reused, so that saving one
+		every tick is just a few big copies.
+		*/
+		struct PhysicsSnapshot {
+			WorldSnapshot	world;
+			std::vector<int> broadphaseProxies;	//for each object, in the world's order
+
+			RigidBodyStore		bodies;
+			CollisionPairCache	collisions;
+
+			//The broadphase's pairs haven't been tested yet, so only the objects and the box test's axis matter
+			struct BroadphasePair {
+				GameObject*	a;
+				GameObject*	b;
+				int			cachedAxis;
+			};
+			std::vector<BroadphasePair>	broadphasePairs;
+			AABBTree<GameObject*>		broadphaseTree;
+			SweepAndPrune<GameObject*>	broadphaseSAP;
+			AABBTree<GameObject*>		staticTree;
+			std::vector<int>			movedProxies;
+			std::vector<int>			movedStaticProxies;
+
+			int		broadphaseFrame	= 0;
+			int		solverStep		= 0;
+			float	timeOffset		= 0.0f;
+		};
+
 		class PhysicsSystem	{
 		public:
 			PhysicsSystem(GameWorld& g);
@@ -17,13 +79,131 @@ namespace NCL {
 				applyGravity = state;
 			}
 
+			void UseSleeping(bool state) {
+				useSleeping = state;
+			}
+
+			void UseBroadPhase(bool state) {
+				useBroadPhase = state;
+			}
+
+			void SetBroadPhaseType(BroadPhaseType type);
+
+			//Lets the narrowphase, integration and island solver run across the job system's threads
+			void SetJobSystem(JobSystem* jobs) {
+				jobSystem = jobs;
+			}
+
+			/*
+			The physics always steps at a fixed rate (120Hz unless told
+			otherwise), running as many steps as fit in the time that's
+			passed, up to a limit. The time left over is given back as an
+			alpha between 0 and 1, for drawing each body part way between its
+			pose before the last step and its pose after it - so physics can
+			run at 60Hz while the screen updates at 144Hz.
+
+			Turning the fixed timestep off goes back to the old behaviour, of
+			halving and doubling the rate depending on how long updates take.
+			*/
+			void SetFixedTimestep(int hz);
+
+			void SetMaxSubsteps(int steps) {
+				maxSubsteps = steps;
+			}
+
+			void UseFixedTimestep(bool state) {
+				useFixedTimestep = state;
+				if (state) {
+					SetFixedTimestep(idealHZ);
+				}
+			}
+
+			float GetTimestep() const {
+				return realDT;
+			}
+
+			float GetInterpolationAlpha() const {
+				return interpolationAlpha;
+			}
+
+			/*
+			Lockstep and rollback networking need every machine - and every
+			re-run of a frame - to come up with exactly the same simulation.
+			Deterministic mode steps at the fixed rate and never adapts it,
+			turns off the world's shuffling, hands contacts to the solver in
+			the order of their objects' world IDs rather than the order the
+			broadphase found them in, and makes sure the floating point
+			rounding mode is the default one while the physics runs.
+
+			The results are the same however many threads the job system has,
+			but only between builds made with the same compiler and settings.
+			*/
+			void UseDeterministicMode(bool state);
+
+			bool IsDeterministic() const {
+				return deterministic;
+			}
+
+			/*
+			Runs this many fixed steps as a single update, without touching
+			the time accumulated by Update. Lockstep and rollback games should
+			call it once per tick, after applying that tick's inputs - forces
+			added before an update act on every step in it, and the collision
+			list is only updated once at the end, so Step(2) isn't the same
+			as calling Step() twice.
+			*/
+			void Step(int stepCount = 1);
+
+			/*
+			Restoring fails if the world's objects have changed since the
+			snapshot was saved. Gameplay state isn't in the snapshot, and
+			collision callbacks are sent again as the steps are re-run, so
+			anything they change has to be rolled back by the game itself.
+			*/
+			void SaveSnapshot(PhysicsSnapshot& snapshot) const;
+			bool RestoreSnapshot(const PhysicsSnapshot& snapshot);
+
+			//Gameplay responses between pairs of collision layers - anything not set just bounces
+			void SetCollisionResponse(CollisionLayer owner, CollisionLayer other, CollisionResponse response) {
+				collisionResponses.SetResponse(owner, other, response);
+			}
+
+			//Returns the index to give GameObject::SetCollisionMaterial. Material 0 is the default
+			int AddCollisionMaterial(const CollisionMaterial& material) {
+				collisionMaterials.emplace_back(material);
+				return (int)collisionMaterials.size() - 1;
+			}
+
 			void SetGlobalDamping(float d) {
 				globalDamping = d;
 			}
+
+			const PhysicsStats& GetStats() const {
+				return stats;
+			}
 			
 			void UpdateResult(float dt);
+			void ResetResult();
+
+			//What the gameplay collisions have added up to since the result was last reset
+			int GetScore() const {
+				return totalScore;
+			}
+
+			bool HasWon() const {
+				return gameWon;
+			}
+
+			bool HasLost() const {
+				return gameLost;
+			}
 			void SetGravity(const Vector3& g);
 		protected:
+			void RunSteps(int stepCount);
+
+			template<class Func>
+			void ParallelFor(int count, int chunkSize, const Func& func);
+
 			void BasicCollisionDetection();
 			void BroadPhase();
 			void NarrowPhase();
@@ -33,17 +213,50 @@ namespace NCL {
 			void IntegrateAccel(float dt);
 			void IntegrateVelocity(float dt);
 
-			void UpdateConstraints(float dt);
+			void BuildIslands();
+			void SolveIslands(float dt);
 
+			int  GetIslandBody(GameObject* o) const;
+			int  FindIslandRoot(int body);
+			void JoinIslands(GameObject* a, GameObject* b);
+			int  GetIsland(GameObject* a, GameObject* b);
+
+			struct PhysicsIsland;
+			void UpdateIslandSleep(PhysicsIsland& island);
+			static bool IsPairAsleep(const GameObject* a, const GameObject* b);
+
+			void RemoveDestroyedPairs();
 			void UpdateCollisionList();
 			void UpdateObjectAABBs();
 
-			void ImpulseResolveCollision(GameObject& a , GameObject&b, CollisionDetection::ContactPoint& p) const;
+			void TreeBroadPhase();
+			void SweepAndPruneBroadPhase();
+
+			template<class BroadPhaseStructure>
+			void UpdateProxies(BroadPhaseStructure& structure);
+			template<class BroadPhaseStructure>
+			void UpdateProxy(BroadPhaseStructure& structure, GameObject* o, int proxy,
+				const Vector3& pos, const Vector3& halfSizes, std::vector<int>& moved);
+			template<class BroadPhaseStructure>
+			void RemoveStaleProxies(BroadPhaseStructure& structure);
+
+			void AddBroadphasePair(GameObject* a, GameObject* b);
 
-			void Bounce1(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const;
-			void Bounce2(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const;
-			void Bounce3(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const;
-			void Bounce4(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const;
+			void AddContact(CollisionDetection::CollisionInfo& info);
+			bool ResolveGameplayCollision(GameObject& a, GameObject& b);
+			static void MatchContactPoints(const CollisionDetection::CollisionInfo& previous, CollisionDetection::CollisionInfo& current);
+
+			struct SolverContact;
+			void PrepareContact(SolverContact& contact);
+			void WarmStartContact(SolverContact& contact);
+			void SolveContact(SolverContact& contact);
+			static void ApplyContactImpulse(PhysicsObject& physA, PhysicsObject& physB, const CollisionDetection::ContactPoint& p, const Vector3& impulse);
+
+			void BouncePadCollision(GameObject& pad, GameObject& other, const CollisionMaterial& material) const;
+
+			void ContinuousCollisions(float dt);
+			bool TimeOfImpact(GameObject& bullet, GameObject& other, const Vector3& motion, float& toi, Vector3& normal) const;
+			void ClampBullets();
 
 
 
@@ -53,14 +266,97 @@ namespace NCL {
 			bool    gameresult;
 			Vector3 gravity;
 			float	dTOffset;
+			int		idealHZ;
+			int		realHZ;
+			float	realDT;
+			int		maxSubsteps;
+			bool	useFixedTimestep;
+			bool	deterministic;
+			float	interpolationAlpha;
 			float	globalDamping;
 
-			std::set<CollisionDetection::CollisionInfo> allCollisions;
+			CollisionPairCache allCollisions;
+
+			CollisionResponseTable			collisionResponses;
+			std::vector<CollisionMaterial>	collisionMaterials;
 
-			std::set<CollisionDetection::CollisionInfo> broadphaseCollisions;
+			int		totalScore;
+			bool	gameWon;
+			bool	gameLost;
+
+			std::vector<CollisionDetection::CollisionInfo> broadphaseCollisions;
+
+			BroadPhaseType				broadPhaseType = BroadPhaseType::AABBTree;
+			AABBTree<GameObject*>		broadphaseTree;
+			SweepAndPrune<GameObject*>	broadphaseSAP;
+			std::vector<int>			movedProxies;
+			AABBTree<GameObject*>		staticTree;			//every object with no inverse mass
+			std::vector<int>			movedStaticProxies;
+			std::vector<GameObject*>	staleObjects;
+			int							broadphaseFrame = 0;
+
+			struct NarrowPhaseContact {
+				int									pairIndex;
+				CollisionDetection::CollisionInfo	info;
+			};
+			JobSystem*										jobSystem;
+			std::vector<std::vector<NarrowPhaseContact>>	threadContacts;
+			std::vector<NarrowPhaseContact>					mergedContacts;
+
+			/*
+			A contact that needs a physical response. Its manifold stays in the
+			pair cache, so the impulses the solver builds up on it are still
+			there to warm start from when the pair is found again next step.
+			The rest is worked out once per step, and reused every iteration.
+			*/
+			struct SolverContact {
+				int			pairIndex;	//into allCollisions
+				GameObject*	a;
+				GameObject*	b;
+				bool		active;
+				Vector3		tangents[2];
+				float		friction;
+				float		normalMasses[CollisionDetection::MAX_CONTACT_POINTS];
+				float		tangentMasses[CollisionDetection::MAX_CONTACT_POINTS][2];
+				float		velocityBiases[CollisionDetection::MAX_CONTACT_POINTS];
+			};
+
+			/*
+			Objects that are touching or constrained together form an island,
+			which can be solved without affecting any other island.
+			*/
+			struct PhysicsIsland {
+				std::vector<PhysicsObject*>	bodies;
+				std::vector<int>			contacts;	//indices into solverContacts
+				std::vector<Constraint*>	constraints;
+				bool						asleep;
+			};
+			std::vector<SolverContact>						solverContacts;
+			int												solverStep = 0;
+			std::vector<PhysicsIsland>						islands;
+			std::vector<PhysicsObject*>						islandBodies;
+			std::vector<int>								islandParents;
+			std::vector<int>								islandIDs;
+			int												islandCount;
+			int												islandBodyCount;
+
+			/*
+			A bullet that would have hit something part way through the step,
+			and the position it hit it at - the bullet's sent there once the
+			step has been integrated, so it never ends up on the far side.
+			*/
+			struct BulletHit {
+				GameObject*	object;
+				Vector3		position;
+			};
+			std::vector<BulletHit>							bulletHits;
+			std::vector<GameObject*>						sweepCandidates;
 
 			bool useBroadPhase		= true;
+			bool useSleeping		= true;
 			int numCollisionFrames	= 5;
+
+			PhysicsStats	stats;
 		};
 	}
 }
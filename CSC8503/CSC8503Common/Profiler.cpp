@@ -0,0 +1,197 @@
+#include "Profiler.h"
+#include "Debug.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+
+using namespace NCL;
+using namespace NCL::CSC8503;
+
+std::atomic<bool>								Profiler::enabled(false);
+std::mutex										Profiler::bufferMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>>	Profiler::buffers;
+
+int64_t Profiler::frameStart		= 0;
+int64_t Profiler::lastFrameStart	= 0;
+int64_t Profiler::lastFrameEnd		= 0;
+
+thread_local int ProfileScope::threadDepth = 0;
+
+const std::chrono::high_resolution_clock::time_point PROFILER_EPOCH = std::chrono::high_resolution_clock::now();
+
+int64_t Profiler::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - PROFILER_EPOCH).count();
+}
+
+/*
+A thread only has to take the lock the first time it records anything,
+to add its buffer to the list - after that it keeps a pointer to it.
+*/
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+	if (!threadBuffer) {
+		std::lock_guard<std::mutex> lock(bufferMutex);
+		buffers.emplace_back(new ThreadBuffer((int)buffers.size()));
+		threadBuffer = buffers.back().get();
+	}
+	return *threadBuffer;
+}
+
+//The thread that turns the profiler on gets the first buffer, so it shows up first in the trace
+void Profiler::SetEnabled(bool state) {
+	if (state) {
+		GetThreadBuffer();
+	}
+	enabled.store(state, std::memory_order_relaxed);
+}
+
+//Only the owning thread ever writes to a buffer, so bumping the head after the event's in is enough
+void Profiler::Record(const char* name, int64_t start, int64_t end, int depth) {
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	buffer.events[head & (EVENTS_PER_THREAD - 1)] = Event{ name, start, end, depth };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::NextFrame() {
+	int64_t now = Now();
+	if (IsEnabled() && frameStart > 0) {
+		Record("Frame", frameStart, now, -1);
+	}
+	lastFrameStart	= frameStart;
+	lastFrameEnd	= now;
+	frameStart		= now;
+}
+
+//Copies out whatever's still in the buffer, oldest first
+void Profiler::CopyEvents(const ThreadBuffer& buffer, std::vector<Event>& events) {
+	uint64_t head	= buffer.head.load(std::memory_order_acquire);
+	uint64_t first	= head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+
+	size_t oldSize = events.size();
+	for (uint64_t i = first; i < head; ++i) {
+		events.emplace_back(buffer.events[i & (EVENTS_PER_THREAD - 1)]);
+	}
+
+	//If the thread was still recording, anything it wrapped around onto while we copied is junk
+	uint64_t newHead = buffer.head.load(std::memory_order_acquire);
+	if (newHead > EVENTS_PER_THREAD && newHead - EVENTS_PER_THREAD > first) {
+		size_t overwritten = (size_t)std::min(newHead - EVENTS_PER_THREAD - first, head - first);
+		events.erase(events.begin() + oldSize, events.begin() + oldSize + overwritten);
+	}
+}
+
+void Profiler::Clear() {
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	for (std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+		buffer->head.store(0, std::memory_order_relaxed);
+	}
+}
+
+static void WriteTraceName(std::ostream& out, const char* name) {
+	out << '"';
+	for (const char* c = name; *c; ++c) {
+		if (*c == '"' || *c == '\\') {
+			out << '\\';
+		}
+		out << *c;
+	}
+	out << '"';
+}
+
+/*
+Chrome's trace format wants times in microseconds. Each event's written
+as a 'complete' event, with its start and duration, and each thread gets
+named, so the main thread's easy to find.
+*/
+bool Profiler::ExportChromeTrace(const std::string& filename) {
+	std::ofstream file(filename);
+	if (!file) {
+		return false;
+	}
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	std::lock_guard<std::mutex> lock(bufferMutex);
+
+	bool firstEvent = true;
+	std::vector<Event> events;
+	for (std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+		int tid = buffer->threadIndex;
+
+		file << (firstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+			<< ",\"args\":{\"name\":\"" << (tid == 0 ? "Main thread" : "Worker thread") << " " << tid << "\"}}";
+		firstEvent = false;
+
+		events.clear();
+		CopyEvents(*buffer, events);
+		for (const Event& e : events) {
+			file << ",\n{\"name\":";
+			WriteTraceName(file, e.name);
+			file << ",\"cat\":\"" << (e.depth < 0 ? "frame" : "physics") << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+				<< ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+		}
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
+
+void Profiler::DrawOverlay(const Vector2& position, float budgetMS, int maxDepth) {
+	if (!IsEnabled() || lastFrameStart == 0) {
+		return;
+	}
+	struct ScopeTotal {
+		const char*	name;
+		int			depth;
+		int64_t		firstStart;
+		int64_t		time;
+	};
+	std::vector<ScopeTotal> totals;
+	std::vector<Event>		events;
+	{
+		std::lock_guard<std::mutex> lock(bufferMutex);
+		for (std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+			CopyEvents(*buffer, events);
+		}
+	}
+	for (const Event& e : events) {
+		if (e.depth < 0 || e.depth > maxDepth || e.start < lastFrameStart || e.end > lastFrameEnd) {
+			continue;
+		}
+		auto total = std::find_if(totals.begin(), totals.end(), [&](const ScopeTotal& t) {
+			return t.depth == e.depth && strcmp(t.name, e.name) == 0;
+		});
+		if (total == totals.end()) {
+			totals.push_back({ e.name, e.depth, e.start, 0 });
+			total = totals.end() - 1;
+		}
+		total->firstStart	= std::min(total->firstStart, e.start);
+		total->time			+= e.end - e.start;
+	}
+	//Show them in the order they first ran in, so the nested scopes sit under their parents
+	std::stable_sort(totals.begin(), totals.end(), [](const ScopeTotal& a, const ScopeTotal& b) {
+		return a.firstStart < b.firstStart;
+	});
+
+	float frameMS = (lastFrameEnd - lastFrameStart) / 1000000.0f;
+
+	std::stringstream line;
+	line << std::fixed << std::setprecision(2) << "Frame " << frameMS << "ms / " << budgetMS << "ms";
+	Debug::Print(line.str(), position, frameMS > budgetMS ? Debug::RED : Debug::GREEN);
+
+	Vector2 linePosition = position;
+	for (const ScopeTotal& t : totals) {
+		float ms = t.time / 1000000.0f;
+
+		line.str("");
+		line << std::string(t.depth * 2, ' ') << t.name << " " << ms << "ms (" << std::setprecision(0) << (ms * 100.0f) / budgetMS << "%)" << std::setprecision(2);
+
+		linePosition.y += 3.0f;
+		Debug::Print(line.str(), linePosition);
+	}
+}
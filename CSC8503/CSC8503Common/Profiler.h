@@ -0,0 +1,119 @@
+#pragma once
+#include "../../Common/Vector2.h"
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstdint>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		/*
+		Records how long each PROFILE_SCOPE takes, on every thread, so we can
+		see where the time in a frame actually goes. Each thread writes into
+		its own ring buffer, so recording never takes a lock or waits for
+		another thread - once the buffer's full, the oldest events are
+		overwritten. While the profiler's turned off, a scope costs one load
+		and a branch, and building with NCL_DISABLE_PROFILER removes them
+		altogether.
+
+		The events can be written out as a Chrome trace (open it in
+		chrome://tracing or ui.perfetto.dev), or summed up for the last frame
+		and drawn over the game with Debug::Print. Do either of those, and
+		Clear, between frames, while nothing else is recording.
+		*/
+		class Profiler {
+		public:
+			struct Event {
+				const char*	name;	//has to outlive the profiler, so use a string literal
+				int64_t		start;	//in nanoseconds since the program started
+				int64_t		end;
+				int			depth;	//how many other scopes this thread was inside, -1 for frames
+			};
+
+			static void SetEnabled(bool state);
+
+			static bool IsEnabled() {
+				return enabled.load(std::memory_order_relaxed);
+			}
+
+			static int64_t Now();
+
+			static void Record(const char* name, int64_t start, int64_t end, int depth);
+
+			//Call once at the start of every frame - the frame before becomes the one the overlay shows
+			static void NextFrame();
+
+			static bool ExportChromeTrace(const std::string& filename);
+
+			/*
+			Prints the scopes from the last frame that were no more than
+			maxDepth deep, added up across every thread, along with how much
+			of the frame budget each one took.
+			*/
+			static void DrawOverlay(const Vector2& position, float budgetMS, int maxDepth = 2);
+
+			static void Clear();
+
+			static const int EVENTS_PER_THREAD = 1 << 16; //has to be a power of 2
+
+		protected:
+			struct ThreadBuffer {
+				ThreadBuffer(int index) : threadIndex(index), events(EVENTS_PER_THREAD), head(0) {}
+
+				int						threadIndex;
+				std::vector<Event>		events;
+				std::atomic<uint64_t>	head;	//how many events have ever been written
+			};
+
+			static ThreadBuffer& GetThreadBuffer();
+			static void CopyEvents(const ThreadBuffer& buffer, std::vector<Event>& events);
+
+			static std::atomic<bool>							enabled;
+			static std::mutex									bufferMutex;
+			static std::vector<std::unique_ptr<ThreadBuffer>>	buffers;
+
+			static int64_t	frameStart;
+			static int64_t	lastFrameStart;
+			static int64_t	lastFrameEnd;
+		};
+
+		//Times everything from here to the end of the enclosing block
+		class ProfileScope {
+		public:
+			ProfileScope(const char* name) : name(name) {
+				if (Profiler::IsEnabled()) {
+					depth = threadDepth++;
+					start = Profiler::Now();
+				}
+				else {
+					start = -1;
+				}
+			}
+
+			~ProfileScope() {
+				if (start >= 0) {
+					Profiler::Record(name, start, Profiler::Now(), depth);
+					threadDepth--;
+				}
+			}
+
+		protected:
+			const char*	name;
+			int64_t		start;
+			int			depth;
+
+			static thread_local int threadDepth;
+		};
+	}
+}
+
+#ifdef NCL_DISABLE_PROFILER
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_SCOPE_JOIN(a, b) a##b
+#define PROFILE_SCOPE_NAME(line) PROFILE_SCOPE_JOIN(profileScope, line)
+#define PROFILE_SCOPE(name) NCL::CSC8503::ProfileScope PROFILE_SCOPE_NAME(__LINE__)(name)
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 #include "../../Common/Vector3.h"
 #include "../../Common/Plane.h"
+#include <cfloat>
 
 namespace NCL {
 	namespace Maths {
@@ -0,0 +1,182 @@
+#include "RigidBodyStore.h"
+#include "Transform.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+template<class T>
+static void CopyElement(std::vector<T>& dest, int to, const std::vector<T>& src, int from) {
+	dest[to] = src[from];
+}
+
+static void CopyElement(Vector3Array& dest, int to, const Vector3Array& src, int from) {
+	CopyElement(dest.x, to, src.x, from);
+	CopyElement(dest.y, to, src.y, from);
+	CopyElement(dest.z, to, src.z, from);
+}
+
+static void CopyElement(QuaternionArray& dest, int to, const QuaternionArray& src, int from) {
+	CopyElement(dest.x, to, src.x, from);
+	CopyElement(dest.y, to, src.y, from);
+	CopyElement(dest.z, to, src.z, from);
+	CopyElement(dest.w, to, src.w, from);
+}
+
+template<class T>
+static void PopElement(std::vector<T>& v) {
+	v.pop_back();
+}
+
+static void PopElement(Vector3Array& a) {
+	a.x.pop_back();
+	a.y.pop_back();
+	a.z.pop_back();
+}
+
+static void PopElement(QuaternionArray& a) {
+	a.x.pop_back();
+	a.y.pop_back();
+	a.z.pop_back();
+	a.w.pop_back();
+}
+
+int RigidBodyStore::AddBody(Transform* transform) {
+	int handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (int)handleToIndex.size();
+		handleToIndex.emplace_back(-1);
+	}
+	handleToIndex[handle] = GetBodyCount();
+	indexToHandle.emplace_back(handle);
+
+	positions.Add(transform->GetPosition());
+	orientations.Add(transform->GetOrientation());
+	previousPositions.Add(transform->GetPosition());
+	previousOrientations.Add(transform->GetOrientation());
+	linearVelocities.Add(Vector3());
+	angularVelocities.Add(Vector3());
+	forces.Add(Vector3());
+	torques.Add(Vector3());
+	inverseInertias.Add(Vector3());
+	inverseInertiaTensors.emplace_back(Matrix3());
+	inverseMasses.emplace_back(1.0f);
+	elasticities.emplace_back(0.66f);
+	frictions.emplace_back(0.8f);
+	sleepTimes.emplace_back(0.0f);
+	sleeping.emplace_back(0);
+	bullets.emplace_back(0);
+	islandIndices.emplace_back(-1);
+	transforms.emplace_back(transform);
+
+	return handle;
+}
+
+void RigidBodyStore::RemoveBody(int handle) {
+	int index = handleToIndex[handle];
+	int last  = GetBodyCount() - 1;
+	if (index != last) {
+		MoveBody(index, last);
+		handleToIndex[indexToHandle[last]]	= index;
+		indexToHandle[index]				= indexToHandle[last];
+	}
+	PopBody();
+	indexToHandle.pop_back();
+
+	handleToIndex[handle] = -1;
+	freeHandles.emplace_back(handle);
+}
+
+/*
+Moving a body to another store gives it a new handle there - the old
+handle is freed up, so whoever held it has to swap to the new one.
+*/
+int RigidBodyStore::TransferBody(int handle, RigidBodyStore& to) {
+	int from		= GetIndex(handle);
+	int newHandle	= to.AddBody(transforms[from]);
+	CopyBody(to, to.GetIndex(newHandle), *this, from);
+	to.islandIndices[to.GetIndex(newHandle)] = -1; //islands belong to the old store's world
+	RemoveBody(handle);
+	return newHandle;
+}
+
+void RigidBodyStore::MoveBody(int to, int from) {
+	CopyBody(*this, to, *this, from);
+}
+
+void RigidBodyStore::CopyBody(RigidBodyStore& dest, int to, const RigidBodyStore& src, int from) {
+	CopyElement(dest.positions, to, src.positions, from);
+	CopyElement(dest.orientations, to, src.orientations, from);
+	CopyElement(dest.previousPositions, to, src.previousPositions, from);
+	CopyElement(dest.previousOrientations, to, src.previousOrientations, from);
+	CopyElement(dest.linearVelocities, to, src.linearVelocities, from);
+	CopyElement(dest.angularVelocities, to, src.angularVelocities, from);
+	CopyElement(dest.forces, to, src.forces, from);
+	CopyElement(dest.torques, to, src.torques, from);
+	CopyElement(dest.inverseInertias, to, src.inverseInertias, from);
+	CopyElement(dest.inverseInertiaTensors, to, src.inverseInertiaTensors, from);
+	CopyElement(dest.inverseMasses, to, src.inverseMasses, from);
+	CopyElement(dest.elasticities, to, src.elasticities, from);
+	CopyElement(dest.frictions, to, src.frictions, from);
+	CopyElement(dest.sleepTimes, to, src.sleepTimes, from);
+	CopyElement(dest.sleeping, to, src.sleeping, from);
+	CopyElement(dest.bullets, to, src.bullets, from);
+	CopyElement(dest.islandIndices, to, src.islandIndices, from);
+	CopyElement(dest.transforms, to, src.transforms, from);
+}
+
+void RigidBodyStore::PopBody() {
+	PopElement(positions);
+	PopElement(orientations);
+	PopElement(previousPositions);
+	PopElement(previousOrientations);
+	PopElement(linearVelocities);
+	PopElement(angularVelocities);
+	PopElement(forces);
+	PopElement(torques);
+	PopElement(inverseInertias);
+	PopElement(inverseInertiaTensors);
+	PopElement(inverseMasses);
+	PopElement(elasticities);
+	PopElement(frictions);
+	PopElement(sleepTimes);
+	PopElement(sleeping);
+	PopElement(bullets);
+	PopElement(islandIndices);
+	PopElement(transforms);
+}
+
+/*
+Collision resolution and gameplay code move objects through their
+Transforms, so bodies pick up their latest position and orientation
+before each integration pass. That includes sleeping bodies - the physics
+won't have moved them, but gameplay code might have teleported one, and
+the pose kept for rendering to interpolate from would otherwise be stuck
+where it was when it fell asleep.
+*/
+void RigidBodyStore::GatherTransforms() {
+	int count = GetBodyCount();
+	for (int i = 0; i < count; ++i) {
+		positions.Set(i, transforms[i]->GetPosition());
+		orientations.Set(i, transforms[i]->GetOrientation());
+	}
+}
+
+void RigidBodyStore::ScatterTransforms() {
+	int count = GetBodyCount();
+	for (int i = 0; i < count; ++i) {
+		if (sleeping[i]) {
+			continue;
+		}
+		transforms[i]->SetPosition(positions.Get(i));
+		transforms[i]->SetOrientation(orientations.Get(i));
+	}
+}
+
+void RigidBodyStore::StorePreviousState() {
+	previousPositions		= positions;
+	previousOrientations	= orientations;
+}
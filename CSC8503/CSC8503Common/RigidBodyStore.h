@@ -0,0 +1,131 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "../../Common/Matrix3.h"
+#include "../../Common/Quaternion.h"
+#include <vector>
+
+using namespace NCL::Maths;
+
+namespace NCL {
+	namespace CSC8503 {
+		class Transform;
+
+		//Keeps each component in its own array, so loops over them can be vectorised
+		struct Vector3Array {
+			std::vector<float> x;
+			std::vector<float> y;
+			std::vector<float> z;
+
+			Vector3 Get(int i) const {
+				return Vector3(x[i], y[i], z[i]);
+			}
+
+			void Set(int i, const Vector3& v) {
+				x[i] = v.x;
+				y[i] = v.y;
+				z[i] = v.z;
+			}
+
+			void Add(const Vector3& v) {
+				x.push_back(v.x);
+				y.push_back(v.y);
+				z.push_back(v.z);
+			}
+		};
+
+		struct QuaternionArray {
+			std::vector<float> x;
+			std::vector<float> y;
+			std::vector<float> z;
+			std::vector<float> w;
+
+			Quaternion Get(int i) const {
+				return Quaternion(x[i], y[i], z[i], w[i]);
+			}
+
+			void Set(int i, const Quaternion& q) {
+				x[i] = q.x;
+				y[i] = q.y;
+				z[i] = q.z;
+				w[i] = q.w;
+			}
+
+			void Add(const Quaternion& q) {
+				x.push_back(q.x);
+				y.push_back(q.y);
+				z.push_back(q.z);
+				w.push_back(q.w);
+			}
+		};
+
+		/*
+		Holds the state of every rigid body, packed into contiguous arrays so
+		that the integrators can run straight through them rather than chasing
+		a pointer per object. Bodies are kept densely packed - removing one
+		moves the last body into its place - so a PhysicsObject refers to its
+		body by a handle, which stays the same even when its index changes.
+
+		Each GameWorld has its own store, and a body is moved into it when its
+		object's added to the world, and back out into a store of its own
+		when it's removed, so only the bodies in a world are ever stepped.
+
+		Positions and orientations are copies of the ones in each body's
+		Transform, which is still what collision detection and rendering use.
+		The physics system gathers them before integrating, and scatters the
+		results back out afterwards.
+		*/
+		class RigidBodyStore {
+		public:
+			RigidBodyStore() {}
+			~RigidBodyStore() {}
+
+			int AddBody(Transform* transform);
+			void RemoveBody(int handle);
+
+			//Moves a body, and everything about it, into another store - returns its handle there
+			int TransferBody(int handle, RigidBodyStore& to);
+
+			int GetIndex(int handle) const {
+				return handleToIndex[handle];
+			}
+
+			int GetBodyCount() const {
+				return (int)transforms.size();
+			}
+
+			void GatherTransforms();
+			void ScatterTransforms();
+
+			//Keeps the pose every body is in before a physics step, for rendering to interpolate from
+			void StorePreviousState();
+
+			Vector3Array				positions;
+			QuaternionArray				orientations;
+			Vector3Array				previousPositions;
+			QuaternionArray				previousOrientations;
+			Vector3Array				linearVelocities;
+			Vector3Array				angularVelocities;
+			Vector3Array				forces;
+			Vector3Array				torques;
+			Vector3Array				inverseInertias;
+			std::vector<Matrix3>		inverseInertiaTensors;
+			std::vector<float>			inverseMasses;
+			std::vector<float>			elasticities;
+			std::vector<float>			frictions;
+			std::vector<float>			sleepTimes;
+			std::vector<char>			sleeping; //not vector<bool>, as threads write to neighbouring bodies
+			std::vector<char>			bullets;
+			std::vector<int>			islandIndices;
+			std::vector<Transform*>		transforms;
+
+		protected:
+			void MoveBody(int to, int from);
+			static void CopyBody(RigidBodyStore& dest, int to, const RigidBodyStore& src, int from);
+			void PopBody();
+
+			std::vector<int> handleToIndex;
+			std::vector<int> indexToHandle;
+			std::vector<int> freeHandles;
+		};
+	}
+}
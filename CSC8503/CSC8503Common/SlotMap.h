@@ -0,0 +1,168 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Refers to an item in a SlotMap. The generation is bumped every time
+		a slot is emptied, so a handle to something that's been removed stops
+		working, even once the slot has been given to something else.
+		*/
+		struct SlotHandle {
+			static const uint32_t NullIndex = 0xFFFFFFFF;
+
+			uint32_t index		= NullIndex;
+			uint32_t generation	= 0;
+
+			bool IsNull() const {
+				return index == NullIndex;
+			}
+
+			bool operator==(const SlotHandle& other) const {
+				return index == other.index && generation == other.generation;
+			}
+
+			bool operator!=(const SlotHandle& other) const {
+				return !(*this == other);
+			}
+		};
+
+		/*
+		Keeps its items densely packed, so they can be iterated through like
+		any vector, while handing out handles that stay the same however the
+		items get moved about. Adding and removing are both O(1) - removing
+		an item moves the last one into its place, just like RigidBodyStore
+		does with its bodies, so don't remove while iterating!
+		*/
+		template<class T>
+		class SlotMap {
+		public:
+			typedef typename std::vector<T>::const_iterator const_iterator;
+
+			SlotMap() {}
+			~SlotMap() {}
+
+			SlotHandle Add(const T& item) {
+				uint32_t slot;
+				if (!freeHandles.empty()) {
+					slot = freeHandles.back();
+					freeHandles.pop_back();
+				}
+				else {
+					slot = (uint32_t)handleToIndex.size();
+					handleToIndex.emplace_back(-1);
+					generations.emplace_back(0);
+				}
+				handleToIndex[slot] = Count();
+				indexToHandle.emplace_back(slot);
+				items.emplace_back(item);
+
+				SlotHandle handle;
+				handle.index		= slot;
+				handle.generation	= generations[slot];
+				return handle;
+			}
+
+			bool Remove(SlotHandle handle) {
+				if (!Contains(handle)) {
+					return false;
+				}
+				int index	= handleToIndex[handle.index];
+				int last	= Count() - 1;
+				if (index != last) {
+					items[index]						= items[last];
+					indexToHandle[index]				= indexToHandle[last];
+					handleToIndex[indexToHandle[index]]	= index;
+				}
+				items.pop_back();
+				indexToHandle.pop_back();
+
+				handleToIndex[handle.index] = -1;
+				generations[handle.index]++;
+				freeHandles.emplace_back(handle.index);
+				return true;
+			}
+
+			bool Contains(SlotHandle handle) const {
+				return	handle.index < generations.size() &&
+						generations[handle.index] == handle.generation &&
+						handleToIndex[handle.index] >= 0;
+			}
+
+			//Returns nullptr if the handle's item has been removed
+			const T* Get(SlotHandle handle) const {
+				return Contains(handle) ? &items[handleToIndex[handle.index]] : nullptr;
+			}
+
+			T* Get(SlotHandle handle) {
+				return Contains(handle) ? &items[handleToIndex[handle.index]] : nullptr;
+			}
+
+			//How many slots there are, in use or not - every handle's index is less than this
+			uint32_t GetSlotCount() const {
+				return (uint32_t)handleToIndex.size();
+			}
+
+			//The item in a slot, whatever its generation - nullptr if the slot's empty
+			const T* GetInSlot(uint32_t slot) const {
+				return (slot < handleToIndex.size() && handleToIndex[slot] >= 0) ? &items[handleToIndex[slot]] : nullptr;
+			}
+
+			//The handle of the item currently at the given index of the dense array
+			SlotHandle GetHandle(int index) const {
+				SlotHandle handle;
+				handle.index		= indexToHandle[index];
+				handle.generation	= generations[handle.index];
+				return handle;
+			}
+
+			int Count() const {
+				return (int)items.size();
+			}
+
+			T& operator[](int index) {
+				return items[index];
+			}
+
+			const T& operator[](int index) const {
+				return items[index];
+			}
+
+			//Swaps two items in the dense array, without changing their handles
+			void Swap(int a, int b) {
+				std::swap(items[a], items[b]);
+				std::swap(indexToHandle[a], indexToHandle[b]);
+				handleToIndex[indexToHandle[a]] = a;
+				handleToIndex[indexToHandle[b]] = b;
+			}
+
+			//Removes everything - every handle given out so far stops working
+			void Clear() {
+				for (uint32_t handle : indexToHandle) {
+					handleToIndex[handle] = -1;
+					generations[handle]++;
+					freeHandles.emplace_back(handle);
+				}
+				items.clear();
+				indexToHandle.clear();
+			}
+
+			const_iterator begin() const {
+				return items.begin();
+			}
+
+			const_iterator end() const {
+				return items.end();
+			}
+
+		protected:
+			std::vector<T>			items;
+			std::vector<uint32_t>	indexToHandle;
+			std::vector<int>		handleToIndex;
+			std::vector<uint32_t>	generations;
+			std::vector<uint32_t>	freeHandles;
+		};
+	}
+}
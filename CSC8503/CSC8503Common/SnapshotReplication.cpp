@@ -0,0 +1,238 @@
+#include "SnapshotReplication.h"
+#include "GameWorld.h"
+#include "GameObject.h"
+#include "PhysicsObject.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+//If playback gets further than this many ticks from where it should be, it's just moved there
+const double MAX_PLAYBACK_DRIFT = 16.0;
+//The most playback is sped up or slowed down by to catch up - 5% isn't noticeable
+const double MAX_PLAYBACK_ADJUST = 0.05;
+
+SnapshotHistory::SnapshotHistory(int historySize, const PackedSnapshotFormat& format) : writer(format) {
+	frames.resize(std::max(historySize, 2));
+	latestFrame	= 0;
+	hasLatest	= false;
+}
+
+const SnapshotHistory::Frame* SnapshotHistory::Find(uint32_t frame) const {
+	const Frame& f = frames[frame % frames.size()];
+	return (f.used && f.frame == frame) ? &f : nullptr;
+}
+
+uint32_t SnapshotHistory::Record(const GameWorld& world) {
+	latestFrame = hasLatest ? latestFrame + 1 : 0;
+	hasLatest	= true;
+
+	Frame& f	= frames[latestFrame % frames.size()];
+	f.frame		= latestFrame;
+	f.used		= true;
+	writer.WriteWorld(f.packed, world, latestFrame);
+	return latestFrame;
+}
+
+size_t SnapshotHistory::WriteForClient(std::vector<uint8_t>& buffer, bool hasAck, uint32_t ackedFrame) {
+	const Frame* latest = hasLatest ? Find(latestFrame) : nullptr;
+	if (!latest) {
+		buffer.clear();
+		return 0;
+	}
+	const Frame* baseline = (hasAck && ackedFrame < latestFrame) ? Find(ackedFrame) : nullptr;
+	if (!baseline) {
+		buffer = latest->packed;
+		return buffer.size();
+	}
+	/*
+	Rather than packing the world all over again, the newest frame is read
+	back and written out against the baseline - the quantised values come
+	back out exactly as they went in, so this gives the same snapshot.
+	*/
+	PackedSnapshotReader baselineReader(baseline->packed.data(), baseline->packed.size());
+	PackedSnapshotReader latestReader(latest->packed.data(), latest->packed.size());
+
+	PackedSnapshotWriter deltaWriter(latestReader.GetFormat());
+	deltaWriter.Begin(buffer, latestFrame, &baselineReader);
+	PackedQuantisedState state;
+	while (latestReader.NextQuantised(state)) {
+		deltaWriter.AddQuantisedObject(state);
+	}
+	return deltaWriter.End();
+}
+
+SnapshotInterpolator::SnapshotInterpolator(int tickRate, int bufferSize) {
+	frames.resize(std::max(bufferSize, 2));
+	this->tickRate		= tickRate;
+	delay				= 3.0f;
+	playbackFrame		= 0.0;
+	latestFrame			= 0;
+	hasLatest			= false;
+	missingBaselines	= 0;
+}
+
+const SnapshotInterpolator::Frame* SnapshotInterpolator::Find(uint32_t frame) const {
+	const Frame& f = frames[frame % frames.size()];
+	return (f.used && f.frame == frame) ? &f : nullptr;
+}
+
+bool SnapshotInterpolator::ReceiveSnapshot(const uint8_t* data, size_t size) {
+	uint32_t frame;
+	uint32_t baselineFrame;
+	if (!PackedSnapshotReader::PeekFrame(data, size, frame, baselineFrame)) {
+		return false;
+	}
+	Frame& slot = frames[frame % frames.size()];
+	if (slot.used && slot.frame >= frame) {
+		return false; //a duplicate, or so late that something newer has taken its place
+	}
+
+	const Frame* baseline = nullptr;
+	if (baselineFrame != frame) {
+		baseline = Find(baselineFrame);
+		if (!baseline || baseline == &slot) {
+			missingBaselines++;
+			return false;
+		}
+	}
+	PackedSnapshotReader baselineReader(baseline ? baseline->packed.data() : nullptr, baseline ? baseline->packed.size() : 0);
+	PackedSnapshotReader reader(data, size, baseline ? &baselineReader : nullptr);
+	if (!reader.IsValid()) {
+		return false;
+	}
+
+	/*
+	Whatever's been sent, it's kept in full, so that it can be the baseline
+	for the snapshots after it, whichever baseline this one was sent against.
+	*/
+	PackedQuantiser			quantiser(reader.GetFormat());
+	PackedSnapshotWriter	repacker(reader.GetFormat());
+	repacker.Begin(scratchPacked, frame);
+	scratchObjects.clear();
+
+	PackedQuantisedState	quantised;
+	PackedObjectState		state;
+	while (reader.NextQuantised(quantised)) {
+		repacker.AddQuantisedObject(quantised);
+		quantiser.Dequantise(quantised, state);
+		scratchObjects.emplace_back(state);
+	}
+	repacker.End();
+	if (!reader.IsValid()) {
+		return false;
+	}
+
+	slot.frame	= frame;
+	slot.used	= true;
+	slot.packed.swap(scratchPacked);
+	slot.objects.swap(scratchObjects);
+
+	if (!hasLatest) {
+		playbackFrame = (double)frame - delay;
+	}
+	if (!hasLatest || frame > latestFrame) {
+		latestFrame	= frame;
+		hasLatest	= true;
+	}
+	return true;
+}
+
+void SnapshotInterpolator::Update(float dt) {
+	if (!hasLatest) {
+		return;
+	}
+	double target	= (double)latestFrame - delay;
+	double error	= target - playbackFrame;
+	if (std::abs(error) > std::max(MAX_PLAYBACK_DRIFT, (double)delay * 2.0)) {
+		playbackFrame = target;
+		return;
+	}
+	double speed = 1.0 + std::max(-MAX_PLAYBACK_ADJUST, std::min(error * 0.1, MAX_PLAYBACK_ADJUST));
+	playbackFrame += dt * tickRate * speed;
+}
+
+int SnapshotInterpolator::Apply(GameWorld& world) const {
+	if (!hasLatest) {
+		return 0;
+	}
+	//The newest snapshot at or before the playback time, and the oldest after it
+	const Frame* from	= nullptr;
+	const Frame* to		= nullptr;
+	for (const Frame& f : frames) {
+		if (!f.used) {
+			continue;
+		}
+		if ((double)f.frame <= playbackFrame) {
+			if (!from || f.frame > from->frame) {
+				from = &f;
+			}
+		}
+		else if (!to || f.frame < to->frame) {
+			to = &f;
+		}
+	}
+	if (!from) { //playback's behind everything that's been kept
+		from	= to;
+		to		= nullptr;
+	}
+	if (!from) {
+		return 0;
+	}
+	float t = to ? (float)((playbackFrame - from->frame) / (double)(to->frame - from->frame)) : 0.0f;
+	t = std::max(0.0f, std::min(t, 1.0f));
+
+	/*
+	Both lists are in order of increasing ID, so they can be walked along
+	together - objects only in one of the two snapshots are just put where
+	that one has them.
+	*/
+	int applied = 0;
+	size_t i = 0;
+	size_t j = 0;
+	size_t fromCount	= from->objects.size();
+	size_t toCount		= to ? to->objects.size() : 0;
+	while (i < fromCount || j < toCount) {
+		const PackedObjectState* a = i < fromCount	? &from->objects[i]	: nullptr;
+		const PackedObjectState* b = j < toCount	? &to->objects[j]	: nullptr;
+
+		Vector3		position;
+		Quaternion	orientation;
+		uint32_t	id;
+		if (a && b && a->id == b->id) {
+			id			= a->id;
+			position	= a->position + ((b->position - a->position) * t);
+			orientation	= Quaternion::Lerp(a->orientation, b->orientation, t);
+			orientation.Normalise();
+			i++;
+			j++;
+		}
+		else if (a && (!b || a->id < b->id)) {
+			id			= a->id;
+			position	= a->position;
+			orientation	= a->orientation;
+			i++;
+		}
+		else {
+			id			= b->id;
+			position	= b->position;
+			orientation	= b->orientation;
+			j++;
+		}
+
+		GameObject* o = world.GetGameObjectByID((int)id);
+		if (o) {
+			o->GetTransform()
+				.SetPosition(position)
+				.SetOrientation(orientation);
+			if (o->GetPhysicsObject()) { //already blended here, so rendering mustn't blend again
+				o->GetPhysicsObject()->ResetPreviousState();
+			}
+			applied++;
+		}
+	}
+	return applied;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "PackedSnapshot.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameWorld;
+
+		/*
+		The server's side of replicating a world. Every tick the whole world
+		is packed and kept, so each client can be sent the newest frame as a
+		delta from whichever frame it last said it had - if a snapshot goes
+		missing, the next one is still against a frame the client knows
+		about, so nothing ever has to be sent reliably.
+
+		Clients keep the same number of frames, so anything the server can
+		still send a delta against, the client still has.
+		*/
+		class SnapshotHistory {
+		public:
+			SnapshotHistory(int historySize = 64, const PackedSnapshotFormat& format = PackedSnapshotFormat());
+			~SnapshotHistory() {}
+
+			//Packs every object in the world as the next frame, and returns its frame number
+			uint32_t Record(const GameWorld& world);
+
+			/*
+			Writes the newest frame for a client, as a delta from the frame it's
+			acknowledged, or in full if it hasn't acknowledged one that's still
+			kept. Returns the size of the snapshot, in bytes.
+			*/
+			size_t WriteForClient(std::vector<uint8_t>& buffer, bool hasAck, uint32_t ackedFrame);
+
+			uint32_t GetLatestFrame() const {
+				return latestFrame;
+			}
+
+		protected:
+			struct Frame {
+				uint32_t				frame	= 0;
+				bool					used	= false;
+				std::vector<uint8_t>	packed;
+			};
+			const Frame* Find(uint32_t frame) const;
+
+			PackedSnapshotWriter	writer;
+			std::vector<Frame>		frames;
+			uint32_t				latestFrame;
+			bool					hasLatest;
+		};
+
+		/*
+		The client's side. Snapshots are unpacked as they come in, and held
+		in a jitter buffer - rather than showing the newest one straight
+		away, the world's shown a few ticks behind it, blending between the
+		two snapshots either side of that time. Snapshots turning up late or
+		not at all then just means blending across a wider gap, rather than
+		objects stopping and jumping.
+
+		The playback time speeds up or slows down slightly to stay the right
+		distance behind the newest snapshot, so it follows the server's clock
+		without ever jumping, unless it's fallen a long way behind.
+		*/
+		class SnapshotInterpolator {
+		public:
+			SnapshotInterpolator(int tickRate = 64, int bufferSize = 64);
+			~SnapshotInterpolator() {}
+
+			//Has to match the rate the server's sending at
+			void SetTickRate(int hz) {
+				tickRate = hz;
+			}
+
+			//How many ticks behind the newest snapshot the world is shown
+			void SetInterpolationDelay(float ticks) {
+				delay = ticks;
+			}
+
+			/*
+			Unpacks a snapshot from the server into the buffer. Returns false if
+			it couldn't be read, is a delta against a frame that's no longer
+			kept, or is older than what's already in its place.
+			*/
+			bool ReceiveSnapshot(const uint8_t* data, size_t size);
+
+			//Moves the playback time on
+			void Update(float dt);
+
+			/*
+			Moves every object in the world that's in the snapshots either side
+			of the playback time to somewhere between the two, matched up by
+			world ID. Returns how many objects were moved.
+			*/
+			int Apply(GameWorld& world) const;
+
+			bool HasSnapshot() const {
+				return hasLatest;
+			}
+
+			//The newest frame received - what the server should be told about
+			uint32_t GetLatestFrame() const {
+				return latestFrame;
+			}
+
+			double GetPlaybackFrame() const {
+				return playbackFrame;
+			}
+
+			//How many snapshots couldn't be used as their baseline wasn't kept
+			int GetMissingBaselineCount() const {
+				return missingBaselines;
+			}
+
+		protected:
+			struct Frame {
+				uint32_t						frame	= 0;
+				bool							used	= false;
+				std::vector<uint8_t>			packed;		//repacked in full, to use as a baseline
+				std::vector<PackedObjectState>	objects;
+			};
+			const Frame* Find(uint32_t frame) const;
+
+			std::vector<Frame>				frames;
+			std::vector<uint8_t>			scratchPacked;
+			std::vector<PackedObjectState>	scratchObjects;
+
+			int			tickRate;
+			float		delay;
+			double		playbackFrame;
+			uint32_t	latestFrame;
+			bool		hasLatest;
+			int			missingBaselines;
+		};
+	}
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+#include <cfloat>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		/*
+		A sweep and prune broadphase. Every box has a min and max endpoint on
+		each axis, and the endpoint arrays are kept sorted between frames. As
+		most objects barely move from one step to the next (and static walls
+		and floors don't move at all), re-sorting them with an insertion sort
+		is close to linear. Each box also tracks where its endpoints are in
+		each array, so testing the other two axes during the sweep is just a
+		pair of integer comparisons.
+		*/
+		template<class T>
+		class SweepAndPrune {
+		public:
+			SweepAndPrune() {
+				Clear();
+			}
+			~SweepAndPrune() {}
+
+			void Clear() {
+				for (int i = 0; i < 3; ++i) {
+					endpoints[i].clear();
+				}
+				boxes.clear();
+				activeBoxes.clear();
+				freeList		= -1;
+				pendingRemoves	= 0;
+				boxCount		= 0;
+			}
+
+			int Insert(T object, const Vector3& pos, const Vector3& halfSize) {
+				int proxy;
+				if (freeList >= 0) {
+					proxy		= freeList;
+					freeList	= boxes[proxy].next;
+				}
+				else {
+					proxy = (int)boxes.size();
+					boxes.emplace_back();
+				}
+				SAPBox& b	= boxes[proxy];
+				b.object	= object;
+				b.inUse		= true;
+				b.removed	= false;
+				b.lastSeen	= -1;
+				b.next		= -1;
+
+				for (int i = 0; i < 3; ++i) {
+					b.minIndex[i] = (int)endpoints[i].size();
+					endpoints[i].push_back({ pos[i] - halfSize[i], proxy << 1 });
+					b.maxIndex[i] = (int)endpoints[i].size();
+					endpoints[i].push_back({ pos[i] + halfSize[i], (proxy << 1) | 1 });
+				}
+				boxCount++;
+				return proxy;
+			}
+
+			/*
+			Removal is deferred until the next sort - the box's endpoints are
+			pushed to the very end of each axis, where they can be popped off.
+			*/
+			void Remove(int proxy) {
+				SAPBox& b = boxes[proxy];
+				for (int i = 0; i < 3; ++i) {
+					endpoints[i][b.minIndex[i]].value = FLT_MAX;
+					endpoints[i][b.maxIndex[i]].value = FLT_MAX;
+				}
+				b.removed	= true;
+				b.object	= T();
+				pendingRemoves++;
+				boxCount--;
+			}
+
+			bool Update(int proxy, const Vector3& pos, const Vector3& halfSize) {
+				SAPBox& b = boxes[proxy];
+				bool moved = false;
+				for (int i = 0; i < 3; ++i) {
+					float newMin = pos[i] - halfSize[i];
+					float newMax = pos[i] + halfSize[i];
+					moved = moved || endpoints[i][b.minIndex[i]].value != newMin || endpoints[i][b.maxIndex[i]].value != newMax;
+					endpoints[i][b.minIndex[i]].value = newMin;
+					endpoints[i][b.maxIndex[i]].value = newMax;
+				}
+				return moved;
+			}
+
+			bool IsValidProxy(int proxy, const T& object) const {
+				return proxy >= 0 && proxy < (int)boxes.size() &&
+					boxes[proxy].inUse && !boxes[proxy].removed && boxes[proxy].object == object;
+			}
+
+			T& GetObject(int proxy) {
+				return boxes[proxy].object;
+			}
+
+			void SetLastSeen(int proxy, int frame) {
+				boxes[proxy].lastSeen = frame;
+			}
+
+			int GetBoxCount() const {
+				return boxCount;
+			}
+
+			template<class Func>
+			void OperateOnStaleProxies(int frame, Func func) {
+				for (int i = 0; i < (int)boxes.size(); ++i) {
+					if (boxes[i].inUse && !boxes[i].removed && boxes[i].lastSeen != frame) {
+						func(i);
+					}
+				}
+			}
+
+			/*
+			Fixes up the endpoint order, then sweeps along whichever axis the
+			boxes are most spread out on, calling func(objectA, objectB) once
+			for every pair of boxes that overlap on all three axes.
+			*/
+			template<class Func>
+			void FindPairs(Func func) {
+				for (int i = 0; i < 3; ++i) {
+					SortAxis(i);
+				}
+				if (pendingRemoves > 0) {
+					PopRemovedBoxes();
+				}
+				int axis	= ChooseSweepAxis();
+				int axisB	= (axis + 1) % 3;
+				int axisC	= (axis + 2) % 3;
+
+				activeBoxes.clear();
+				for (const SAPEndpoint& e : endpoints[axis]) {
+					int proxy = e.data >> 1;
+					SAPBox& b = boxes[proxy];
+
+					if (e.data & 1) { //max endpoint, this box is finished
+						int last = activeBoxes.back();
+						activeBoxes[b.activeSlot]	= last;
+						boxes[last].activeSlot		= b.activeSlot;
+						activeBoxes.pop_back();
+						continue;
+					}
+					for (int other : activeBoxes) {
+						const SAPBox& o = boxes[other];
+						if (b.minIndex[axisB] < o.maxIndex[axisB] && o.minIndex[axisB] < b.maxIndex[axisB] &&
+							b.minIndex[axisC] < o.maxIndex[axisC] && o.minIndex[axisC] < b.maxIndex[axisC]) {
+							func(o.object, b.object);
+						}
+					}
+					b.activeSlot = (int)activeBoxes.size();
+					activeBoxes.emplace_back(proxy);
+				}
+			}
+
+		protected:
+			struct SAPEndpoint {
+				float	value;
+				int		data; //box index << 1, low bit set for a max endpoint
+			};
+
+			struct SAPBox {
+				T		object;
+				int		minIndex[3];
+				int		maxIndex[3];
+				int		activeSlot;
+				int		lastSeen;
+				int		next;
+				bool	inUse;
+				bool	removed;
+			};
+
+			void SetEndpointIndex(int axis, int index) {
+				const SAPEndpoint& e = endpoints[axis][index];
+				SAPBox& b = boxes[e.data >> 1];
+				if (e.data & 1) {
+					b.maxIndex[axis] = index;
+				}
+				else {
+					b.minIndex[axis] = index;
+				}
+			}
+
+			void SortAxis(int axis) {
+				std::vector<SAPEndpoint>& list = endpoints[axis];
+				for (int i = 1; i < (int)list.size(); ++i) {
+					if (!(list[i].value < list[i - 1].value)) {
+						continue;
+					}
+					SAPEndpoint e = list[i];
+					int j = i - 1;
+					while (j >= 0 && e.value < list[j].value) {
+						list[j + 1] = list[j];
+						SetEndpointIndex(axis, j + 1);
+						--j;
+					}
+					list[j + 1] = e;
+					SetEndpointIndex(axis, j + 1);
+				}
+			}
+
+			void PopRemovedBoxes() {
+				for (int i = 0; i < 3; ++i) {
+					while (!endpoints[i].empty() && boxes[endpoints[i].back().data >> 1].removed) {
+						endpoints[i].pop_back();
+					}
+				}
+				for (int i = 0; i < (int)boxes.size(); ++i) {
+					if (boxes[i].inUse && boxes[i].removed) {
+						boxes[i].inUse	= false;
+						boxes[i].next	= freeList;
+						freeList		= i;
+					}
+				}
+				pendingRemoves = 0;
+			}
+
+			int ChooseSweepAxis() const {
+				Vector3 sum;
+				Vector3 sumSq;
+				int count = 0;
+				for (const SAPBox& b : boxes) {
+					if (!b.inUse) {
+						continue;
+					}
+					Vector3 centre;
+					for (int i = 0; i < 3; ++i) {
+						centre[i] = (endpoints[i][b.minIndex[i]].value + endpoints[i][b.maxIndex[i]].value) * 0.5f;
+					}
+					sum		+= centre;
+					sumSq	+= centre * centre;
+					count++;
+				}
+				if (count == 0) {
+					return 0;
+				}
+				Vector3 variance = sumSq - (sum * sum) / (float)count;
+				int axis = 0;
+				if (variance.y > variance[axis]) {
+					axis = 1;
+				}
+				if (variance.z > variance[axis]) {
+					axis = 2;
+				}
+				return axis;
+			}
+
+			std::vector<SAPEndpoint>	endpoints[3];
+			std::vector<SAPBox>			boxes;
+			std::vector<int>			activeBoxes;
+
+			int freeList;
+			int pendingRemoves;
+			int boxCount;
+		};
+	}
+}
@@ -4,7 +4,9 @@ using namespace NCL::CSC8503;
 
 Transform::Transform()
 {
-	scale	= Vector3(1, 1, 1);
+	scale		= Vector3(1, 1, 1);
+	parent		= nullptr;
+	matrixDirty	= true;
 }
 
 Transform::~Transform()
@@ -12,42 +14,54 @@ Transform::~Transform()
 
 }
 
-void Transform::UpdateMatrix() {
-	matrix =
-		Matrix4::Translation(position) *
-		Matrix4(orientation) *
-		Matrix4::Scale(scale);
+/*
+Translation * Rotation * Scale, without the two matrix multiplies - the
+rotation's columns are scaled, and the position goes in the last column.
+*/
+Matrix4 Transform::BuildMatrix(const Vector3& position, const Quaternion& orientation, const Vector3& scale) {
+	Matrix4 m(orientation);
+	for (int column = 0; column < 3; ++column) {
+		for (int row = 0; row < 3; ++row) {
+			m.array[column * 4 + row] *= scale[column];
+		}
+	}
+	m.SetPositionVector(position);
+	return m;
+}
+
+void Transform::UpdateMatrix() const {
+	matrix		= BuildMatrix(position, orientation, scale);
+	matrixDirty	= false;
 }
 
 Transform& Transform::SetPosition(const Vector3& worldPos) {
-	position = worldPos;
-	UpdateMatrix();
+	position	= worldPos;
+	matrixDirty	= true;
 	return *this;
 }
 
 Transform& Transform::SetScale(const Vector3& worldScale) {
-	scale = worldScale;
-	UpdateMatrix();
+	scale		= worldScale;
+	matrixDirty	= true;
 	return *this;
 }
 
 Transform& Transform::SetOrientation(const Quaternion& worldOrientation) {
-	orientation = worldOrientation;
-	UpdateMatrix();
+	orientation	= worldOrientation;
+	matrixDirty	= true;
 	return *this;
 }
 
 //========================//
 void Transform::SetWorldPosition(const Vector3& worldPos) {
-	if (parent) {
-		Vector3 parentPos = parent->GetWorldMatrix().GetPositionVector();
-		Vector3 posDiff = parentPos - worldPos;
-
-		position = posDiff;
-		matrix.SetPositionVector(posDiff);
+	if (parent) { //move into the parent's space
+		SetPosition(parent->GetWorldMatrix().Inverse() * worldPos);
 	}
 	else {
-		position = worldPos;
-		worldMatrix.SetPositionVector(worldPos);
+		SetPosition(worldPos);
 	}
-}
\ No newline at end of file
+}
+
+void Transform::SetLocalPosition(const Vector3& localPos) {
+	SetPosition(localPos);
+}
@@ -27,7 +27,7 @@ namespace NCL {
 			}
 
 			Vector3 GetWorldPosition() const {
-				return worldMatrix.GetPositionVector();
+				return parent ? parent->GetWorldMatrix() * position : position;
 			}
 
 			Vector3 GetScale() const {
@@ -43,22 +43,43 @@ namespace NCL {
 				return Vector3(2 * (orientation.x * orientation.y - orientation.w * orientation.z), 1 - 2 * (orientation.x * orientation.x + orientation.z * orientation.z), 2 * (orientation.y * orientation.z + orientation.w * orientation.x));
 			}
 
+			/*
+			Setting the position, orientation or scale only marks the matrix
+			as dirty - it's rebuilt the next time something asks for it, so
+			moving an object several times in a frame (as the physics does)
+			only costs one rebuild, when it's drawn. That does mean the first
+			GetMatrix after a change writes to the Transform, so don't call it
+			from more than one thread at a time.
+			*/
 			Matrix4 GetMatrix() const {
+				if (matrixDirty) {
+					UpdateMatrix();
+				}
 				return matrix;
 			}
 
 			Matrix4 GetWorldMatrix() const {
-				return worldMatrix;
+				return parent ? parent->GetWorldMatrix() * GetMatrix() : GetMatrix();
 			}
 
+			void SetParent(Transform* newParent) {
+				parent = newParent;
+			}
+
+			Transform* GetParent() const {
+				return parent;
+			}
+
+			void UpdateMatrix() const;
 
-			void UpdateMatrix();
+			//The matrix a Transform with this position, orientation and scale would have
+			static Matrix4 BuildMatrix(const Vector3& position, const Quaternion& orientation, const Vector3& scale);
 			void SetWorldPosition(const Vector3& worldPos);
 			void SetLocalPosition(const Vector3& localPos);
 
 		protected:
-			Matrix4		matrix;
-			Matrix4		worldMatrix;
+			mutable Matrix4	matrix;
+			mutable bool	matrixDirty;
 
 			Quaternion	orientation;
 
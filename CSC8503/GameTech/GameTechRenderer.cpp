@@ -1,9 +1,12 @@
 #include "GameTechRenderer.h"
 #include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/PhysicsObject.h"
+#include "../CSC8503Common/Debug.h"
 #include "../../Common/Camera.h"
 #include "../../Common/Vector2.h"
 #include "../../Common/Vector3.h"
 #include "../../Common/TextureLoader.h"
+#include "../../Common/Maths.h"
 using namespace NCL;
 using namespace Rendering;
 using namespace CSC8503;
@@ -42,6 +45,8 @@ GameTechRenderer::GameTechRenderer(GameWorld& world) : OGLRenderer(*Window::GetW
 	lightRadius = 1000.0f;
 	lightPosition = Vector3(-200.0f, 60.0f, -200.0f);
 
+	interpolationAlpha = 1.0f;
+
 	//Skybox!
 	skyboxShader = new OGLShader("skyboxVertex.glsl", "skyboxFragment.glsl");
 	skyboxMesh = new OGLMesh();
@@ -105,9 +110,20 @@ void GameTechRenderer::RenderFrame() {
 	RenderShadowMap();
 	RenderSkybox();
 	RenderCamera();
+	QueueDebugEntries();
 	glDisable(GL_CULL_FACE); //Todo - text indices are going the wrong way...
 }
 
+//Anything given to Debug this frame gets drawn along with our own debug data, once the frame ends
+void GameTechRenderer::QueueDebugEntries() {
+	for (const Debug::DebugStringEntry& s : Debug::GetDebugStrings()) {
+		DrawString(s.data, s.position);
+	}
+	for (const Debug::DebugLineEntry& l : Debug::GetDebugLines()) {
+		DrawLine(l.start, l.end, l.colour);
+	}
+}
+
 void GameTechRenderer::BuildObjectList() {
 	activeObjects.clear();
 
@@ -116,13 +132,34 @@ void GameTechRenderer::BuildObjectList() {
 			if (o->IsActive()) {
 				const RenderObject* g = o->GetRenderObject();
 				if (g) {
-					activeObjects.emplace_back(g);
+					activeObjects.push_back({ g, GetInterpolatedMatrix(*o) });
 				}
 			}
 		}
 	);
 }
 
+/*
+The physics runs at its own fixed rate, so most frames land somewhere
+between two physics steps. Moving objects are drawn that far between where
+they were before the last step and where they are now, so that they move
+smoothly even when the screen updates faster than the physics does.
+*/
+Matrix4 GameTechRenderer::GetInterpolatedMatrix(GameObject& o) const {
+	const Transform&		transform	= o.GetTransform();
+	const PhysicsObject*	physics		= o.GetPhysicsObject();
+
+	if (!physics || transform.GetParent()) {
+		return transform.GetWorldMatrix();
+	}
+	Vector3 position = Maths::Lerp(physics->GetPreviousPosition(), transform.GetPosition(), interpolationAlpha);
+
+	Quaternion orientation = Quaternion::Lerp(physics->GetPreviousOrientation(), transform.GetOrientation(), interpolationAlpha);
+	orientation.Normalise();
+
+	return Transform::BuildMatrix(position, orientation, transform.GetScale());
+}
+
 void GameTechRenderer::SortObjectList() {
 	//Who cares!
 }
@@ -145,8 +182,9 @@ void GameTechRenderer::RenderShadowMap() {
 
 	shadowMatrix = biasMatrix * mvMatrix; //we'll use this one later on
 
-	for (const auto&i : activeObjects) {
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
+	for (const ActiveObject& active : activeObjects) {
+		const RenderObject* i = active.renderObject;
+		Matrix4 modelMatrix = active.modelMatrix;
 		Matrix4 mvpMatrix	= mvMatrix * modelMatrix;
 		glUniformMatrix4fv(mvpLocation, 1, false, (float*)&mvpMatrix);
 		BindMesh((*i).GetMesh());
@@ -216,7 +254,8 @@ void GameTechRenderer::RenderCamera() {
 	glActiveTexture(GL_TEXTURE0 + 1);
 	glBindTexture(GL_TEXTURE_2D, shadowTex);
 
-	for (const auto&i : activeObjects) {
+	for (const ActiveObject& active : activeObjects) {
+		const RenderObject* i = active.renderObject;
 		OGLShader* shader = (OGLShader*)(*i).GetShader();
 		BindShader(shader);
 
@@ -251,7 +290,7 @@ void GameTechRenderer::RenderCamera() {
 			activeShader = shader;
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
+		Matrix4 modelMatrix = active.modelMatrix;
 		glUniformMatrix4fv(modelLocation, 1, false, (float*)&modelMatrix);			
 		
 		Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
@@ -17,6 +17,11 @@ namespace NCL {
 			GameTechRenderer(GameWorld& world);
 			~GameTechRenderer();
 
+			//How far between their last two physics steps to draw objects - see PhysicsSystem::GetInterpolationAlpha
+			void SetInterpolationAlpha(float alpha) {
+				interpolationAlpha = alpha;
+			}
+
 		protected:
 			void RenderFrame()	override;
 
@@ -28,14 +33,21 @@ namespace NCL {
 			GameWorld&	gameWorld;
 
 			void BuildObjectList();
+			Matrix4 GetInterpolatedMatrix(GameObject& o) const;
 			void SortObjectList();
 			void RenderShadowMap();
 			void RenderCamera(); 
 			void RenderSkybox();
+			void QueueDebugEntries();
 
 			void LoadSkybox();
 
-			vector<const RenderObject*> activeObjects;
+			struct ActiveObject {
+				const RenderObject*	renderObject;
+				Matrix4				modelMatrix;
+			};
+			vector<ActiveObject> activeObjects;
+			float interpolationAlpha;
 
 			OGLShader*  skyboxShader;
 			OGLMesh*	skyboxMesh;
@@ -11,8 +11,18 @@
 #include "../CSC8503Common/BehaviourSequence.h"
 #include "../CSC8503Common/BehaviourAction.h"
 
+#include "../CSC8503Common/GameServer.h"
+#include "../CSC8503Common/GameClient.h"
+#include "../CSC8503Common/GameWorld.h"
+#include "../CSC8503Common/GameObject.h"
+
 #include "TutorialGame.h"
 
+#include <thread>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
 using namespace NCL;
 using namespace CSC8503;
 
@@ -270,6 +280,83 @@ using namespace CSC8503;
 //}
 //==========AI part=============//
 
+//==========Networking part=============//
+
+/*
+Runs a server and a client in the same process, talking over localhost -
+run the game with --test-replication to try it.
+Both worlds get the same objects in the same order, so they end up with
+the same world IDs - the server's objects are moved round in circles, and
+the client's only move when the snapshots say so. They all move at 10
+units a second, so if the client's interpolating properly, its objects
+should be too, rather than stopping and jumping between snapshots.
+*/
+void TestReplication() {
+	const int	objectCount	= 64;
+	const int	tickRate	= 64;
+	const float	frameTime	= 1.0f / 128.0f;	//two frames to every tick, so each snapshot is the same time apart
+
+	auto PositionAt = [](int i, float time) {
+		return Vector3(cos(time + i) * 10.0f, (float)i, sin(time + i) * 10.0f);
+	};
+
+	GameWorld serverWorld;
+	GameWorld clientWorld;
+	for (int i = 0; i < objectCount; ++i) {
+		serverWorld.AddGameObject(new GameObject("Replicated"));
+		clientWorld.AddGameObject(new GameObject("Replicated"));
+	}
+
+	NetworkBase::Initialise();
+	int port = NetworkBase::GetDefaultPort();
+
+	GameServer* server = new GameServer(port, 1);
+	server->SetGameWorld(serverWorld);
+	server->SetSnapshotRate(tickRate);
+
+	GameClient* client = new GameClient();
+	client->SetGameWorld(clientWorld);
+	client->GetInterpolator().SetTickRate(tickRate);
+	client->Connect(127, 0, 0, 1, port);
+
+	GameObject* watched		= clientWorld.GetGameObjectByID(0);
+	Vector3		lastPos		= watched->GetTransform().GetPosition();
+	float		minSpeed	= FLT_MAX;
+	float		maxSpeed	= 0.0f;
+	float		time		= 0.0f;
+
+	for (int frame = 1; frame <= 128 * 5; ++frame) {
+		time += frameTime;
+		for (int i = 0; i < objectCount; ++i) {
+			serverWorld.GetGameObjectByID(i)->GetTransform().SetPosition(PositionAt(i, time));
+		}
+		server->UpdateServer(frameTime);
+		client->UpdateClient(frameTime);
+
+		Vector3 pos = watched->GetTransform().GetPosition();
+		if (client->GetInterpolator().HasSnapshot()) {
+			float speed = (pos - lastPos).Length() / frameTime;
+			minSpeed = std::min(minSpeed, speed);
+			maxSpeed = std::max(maxSpeed, speed);
+		}
+		lastPos = pos;
+
+		if (frame % 128 == 0) {
+			std::cout << "Client at frame " << client->GetInterpolator().GetPlaybackFrame()
+				<< " of " << client->GetInterpolator().GetLatestFrame()
+				<< ", speed between " << minSpeed << " and " << maxSpeed << "\n";
+			minSpeed = FLT_MAX;
+			maxSpeed = 0.0f;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds((int)(frameTime * 1000000.0f)));
+	}
+	delete client;
+	delete server;
+	NetworkBase::Destroy();
+
+	serverWorld.ClearAndErase();
+	clientWorld.ClearAndErase();
+}
 
 /*
 
@@ -284,7 +371,13 @@ hide or show the
 
 */
 
-int main() {
+int main(int argc, char** argv) {
+	//The networking test doesn't need the game, or even a window
+	if (argc > 1 && std::string(argv[1]) == "--test-replication") {
+		TestReplication();
+		return 0;
+	}
+
 	Window*w = Window::CreateGameWindow("CSC8503 Game technology!", 1280, 720);
 
 	if (!w->HasInitialised()) {
@@ -301,6 +394,8 @@ int main() {
 	//DisplayPathfinding();
 	//TestBehaviourTrss();
 
+	//Networking test - run with --test-replication
+
 	TutorialGame* g = new TutorialGame();
 	w->GetTimer()->GetTimeDeltaSeconds(); //Clear the timer so we don't get a larget first dt!
 
@@ -11,6 +11,9 @@ StateGameObject::StateGameObject(string objectName) {
 	counter = 0.0f;
 	stateMachine = new StateMachine();
 
+	//the state machine only ever pushes this object about, so it can be updated alongside others
+	SetThreadSafe(true);
+
 	State* stateA = new State([&](float dt)->void {
 		this->MoveLeft(dt);
 		});
@@ -9,6 +9,8 @@
 #include "../CSC8503Common/GameObject.h"
 #include "../CSC8503Common/NavigationGrid.h"
 #include "../CSC8503Common/SliderConstraint.h"
+#include "../CSC8503Common/Profiler.h"
+#include "../CSC8503Common/PackedSnapshot.h"
 #include "../CSC8503Common/HingeConstraint.h"
 #include "../CSC8503Common/PositionConstraint.h"
 
@@ -23,18 +25,24 @@ using namespace CSC8503;
 std::ifstream infile;
 std::ofstream outfile;
 
+const float FRAME_BUDGET_MS = 1000.0f / 60.0f; //what the profiler overlay measures each frame against
+
 TutorialGame::TutorialGame()	{
 	machine = new PushdownMachine(new IntroScreen(this));
 	world		= new GameWorld();
 	renderer	= new GameTechRenderer(*world);
 	physics		= new PhysicsSystem(*world);
+	jobSystem	= new JobSystem();
+
+	physics->SetJobSystem(jobSystem);
+	world->SetJobSystem(jobSystem);
+	physics->SetFixedTimestep(60); //the ball and shooters are bullets, so they can't tunnel through the walls at this rate
+	InitCollisionResponses();
 
 	forceMagnitude	= 100.0f;
 	useGravity		= false;
 	inSelectionMode = false;
 
-	Debug::SetRenderer(renderer);
-
 	InitialiseAssets();
 }
 
@@ -83,6 +91,7 @@ TutorialGame::~TutorialGame()	{
 	delete basicShader;
 
 	delete physics;
+	delete jobSystem;
 	delete renderer;
 	delete world;
 }
@@ -90,6 +99,8 @@ TutorialGame::~TutorialGame()	{
 
 
 void TutorialGame::UpdateGame(float dt) {
+	Profiler::NextFrame();
+
 	//float totalscore = PhysicsSystem::ShowTotalScore();
 	//Debug::Print("Total score : " + std::to_string(totalscore), Vector2(95, 95));
 	if (!inSelectionMode) {
@@ -119,6 +130,8 @@ void TutorialGame::UpdateGame(float dt) {
 	SelectObject();
 	MoveSelectedObject();
 	physics->Update(dt);
+	renderer->SetInterpolationAlpha(physics->GetInterpolationAlpha());
+	Profiler::DrawOverlay(Vector2(2, 5), FRAME_BUDGET_MS);
 
 	//ĿӽǸ
 	if (lockedObject != nullptr) {
@@ -143,15 +156,8 @@ void TutorialGame::UpdateGame(float dt) {
 	world->UpdateWorld(dt);
 	renderer->Update(dt);
 
-	Debug::FlushRenderables(dt);
 	renderer->Render();
-
-	if (testStateObjectLeft) {
-		testStateObjectLeft->Update(dt);
-	}
-	if (testStateObjectRight) {
-		testStateObjectRight->Update(dt);
-	}
+	Debug::UpdateRenderables(dt);
 }
 
 
@@ -159,6 +165,7 @@ void TutorialGame::UpdateGame(float dt) {
 void TutorialGame::UpdateKeys() {
 	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F1)) {
 		InitWorld(); //We can reset the simulation at any time with F1
+		physics->ResetResult();
 		selectionObject = nullptr;
 		lockedObject	= nullptr;
 	}
@@ -189,6 +196,33 @@ void TutorialGame::UpdateKeys() {
 		world->ShuffleObjects(false);
 	}
 
+	//F5 toggles the profiler overlay, and F6 saves what it's recorded, for chrome://tracing
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F5)) {
+		Profiler::SetEnabled(!Profiler::IsEnabled());
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F6)) {
+		if (Profiler::ExportChromeTrace("PhysicsTrace.json")) {
+			std::cout << "Saved profiler trace to PhysicsTrace.json\n";
+		}
+	}
+
+	//F3 quick saves every object's position and velocity into a packed snapshot, and F4 loads it back in
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F3)) {
+		std::vector<uint8_t> snapshot;
+		PackedSnapshotWriter().WriteWorld(snapshot, *world, 0);
+		std::ofstream file("QuickSave.snapshot", std::ios::binary);
+		file.write((const char*)snapshot.data(), snapshot.size());
+		std::cout << "Saved " << world->GetWorldIDCount() << " world IDs into " << snapshot.size() << " bytes\n";
+	}
+	if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F4)) {
+		std::ifstream file("QuickSave.snapshot", std::ios::binary);
+		std::vector<uint8_t> snapshot((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		PackedSnapshotReader reader(snapshot.data(), snapshot.size());
+		if (reader.IsValid()) {
+			std::cout << "Loaded " << reader.ApplyToWorld(*world) << " objects from the quick save\n";
+		}
+	}
+
 	if (lockedObject) {
 		LockedObjectMovement();
 	}
@@ -299,6 +333,37 @@ void TutorialGame::InitWorld() {
 }
 
 
+/*
+The gameplay objects are told apart by their collision layers, and what
+each one does is set by its material.
+*/
+void TutorialGame::InitCollisionResponses() {
+	physics->SetCollisionResponse(CollisionLayer::BouncePad,	CollisionLayer::Ball, CollisionResponse::BouncePad);
+	physics->SetCollisionResponse(CollisionLayer::Pickup,		CollisionLayer::Ball, CollisionResponse::ScorePickup);
+	physics->SetCollisionResponse(CollisionLayer::WinZone,		CollisionLayer::Ball, CollisionResponse::Trigger);
+
+	Vector3 padImpulses[4][2] = {
+		{ Vector3(-0.05f, 0, 0),	Vector3(0, 0, 0) },
+		{ Vector3(0, 0, 0.1f),		Vector3(0.1f, 0, 0) },
+		{ Vector3(0.1f, 0, 0),		Vector3(0, 0, 0.1f) },
+		{ Vector3(0.1f, 2.0f, 0),	Vector3(0, 0, 0) }
+	};
+	for (int i = 0; i < 4; ++i) {
+		CollisionMaterial pad;
+		pad.linearImpulse	= padImpulses[i][0];
+		pad.angularImpulse	= padImpulses[i][1];
+		bounceMaterials[i]	= physics->AddCollisionMaterial(pad);
+	}
+
+	CollisionMaterial bonus;
+	bonus.score		= 50;
+	bonusMaterial	= physics->AddCollisionMaterial(bonus);
+
+	CollisionMaterial win;
+	win.winsGame	= true;
+	winMaterial		= physics->AddCollisionMaterial(win);
+}
+
 void TutorialGame::BridgeConstraintTest() {
 	Vector3 cubeSize = Vector3(1, 1, 1);
 
@@ -473,6 +538,9 @@ GameObject* TutorialGame::AddBounce1(const Vector3& position) {
 	BounceTile->GetPhysicsObject()->SetInverseMass(0);
 	BounceTile->GetPhysicsObject()->InitCubeInertia();
 
+	BounceTile->SetCollisionLayer(CollisionLayer::BouncePad);
+	BounceTile->SetCollisionMaterial(bounceMaterials[0]);
+
 	world->AddGameObject(BounceTile);
 
 	return BounceTile;
@@ -496,6 +564,9 @@ GameObject* TutorialGame::AddBounce2(const Vector3& position) {
 	BounceTile->GetPhysicsObject()->SetInverseMass(0);
 	BounceTile->GetPhysicsObject()->InitCubeInertia();
 
+	BounceTile->SetCollisionLayer(CollisionLayer::BouncePad);
+	BounceTile->SetCollisionMaterial(bounceMaterials[1]);
+
 	world->AddGameObject(BounceTile);
 
 	return BounceTile;
@@ -519,6 +590,9 @@ GameObject* TutorialGame::AddBounce3(const Vector3& position) {
 	BounceTile->GetPhysicsObject()->SetInverseMass(0);
 	BounceTile->GetPhysicsObject()->InitCubeInertia();
 
+	BounceTile->SetCollisionLayer(CollisionLayer::BouncePad);
+	BounceTile->SetCollisionMaterial(bounceMaterials[2]);
+
 	world->AddGameObject(BounceTile);
 
 	return BounceTile;
@@ -542,6 +616,9 @@ GameObject* TutorialGame::AddBounce4(const Vector3& position) {
 	BounceTile->GetPhysicsObject()->SetInverseMass(0);
 	BounceTile->GetPhysicsObject()->InitCubeInertia();
 
+	BounceTile->SetCollisionLayer(CollisionLayer::BouncePad);
+	BounceTile->SetCollisionMaterial(bounceMaterials[3]);
+
 	world->AddGameObject(BounceTile);
 
 	return BounceTile;
@@ -652,6 +729,7 @@ GameObject* TutorialGame::AddRightShootCube(const Vector3& position, const Vecto
 	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
 	cube->GetPhysicsObject()->InitCubeInertia();
 
+	cube->GetPhysicsObject()->SetBullet(true);
 	cube->SetShootDir(shootDir);
 
 	world->AddGameObject(cube);
@@ -814,13 +892,17 @@ void TutorialGame::InitDefaultFloor() {
 	AddWallToWorld(Vector3(25, 25, 0));//,"lose"
 	AddSlopeToWorld(Vector3(0, 1, 0));
 
-	AddSphereToWorld(Vector3(70, 1, -25), 2.0f,10.0f,"ball");
+	GameObject* ball = AddSphereToWorld(Vector3(70, 1, -25), 2.0f,10.0f,"ball");
+	ball->SetCollisionLayer(CollisionLayer::Ball);
+	ball->GetPhysicsObject()->SetBullet(true);
 	AddBounce1(Vector3(0, 0, -25));
 	AddBounce2(Vector3(-75, 0, -15));
 	AddBounce3(Vector3(-75, 0, 35));
 	AddBounce4(Vector3(-25, 0, 25));
 	AddDoorToWorld(Vector3(-12.5, 1, -10));
-	AddTargetFloorToWorld(Vector3(50, 0, 25),"win");
+	GameObject* target = AddTargetFloorToWorld(Vector3(50, 0, 25),"win");
+	target->SetCollisionLayer(CollisionLayer::WinZone);
+	target->SetCollisionMaterial(winMaterial);
 
 	//other func
 	AddCapsuleToWorld(Vector3(10, 100, 10),2.0f,1.0f);
@@ -846,6 +928,7 @@ GameObject* TutorialGame::AddPlayerToWorld(const Vector3& position, const std::s
 	AABBVolume* volume = new AABBVolume(Vector3(0.3f, 0.85f, 0.3f) * meshSize);
 
 	character->SetBoundingVolume((CollisionVolume*)volume);
+	character->SetCollisionLayer(CollisionLayer::Character);
 
 	character->GetTransform()
 		.SetScale(Vector3(meshSize, meshSize, meshSize))
@@ -910,6 +993,9 @@ GameObject* TutorialGame::AddBonusToWorld(const Vector3& position, const std::st
 	apple->GetPhysicsObject()->SetInverseMass(0.0f);
 	apple->GetPhysicsObject()->InitSphereInertia();
 
+	apple->SetCollisionLayer(CollisionLayer::Pickup);
+	apple->SetCollisionMaterial(bonusMaterial);
+
 	world->AddGameObject(apple);
 
 	return apple;
@@ -1027,10 +1113,10 @@ void TutorialGame::MoveSelectedObject() {
 //====MENU=========//
 void TutorialGame::DrawMenu() {
 	glClearColor(0, 0, 0, 1);
-	Debug::FlushRenderables(0);
 	renderer->DrawString("Welcome to game", Vector2(10, 10));
 	renderer->DrawString("Press '1' for game", Vector2(10, 20));
 	renderer->Render();
+	Debug::UpdateRenderables(0);
 	world->ClearAndErase();
 	physics->Clear();
 }
@@ -1075,13 +1161,22 @@ void TutorialGame::UpdateBot()
 	}
 }
 
+/*
+The enemy looks for the player with overlap queries on the Character layer,
+so it's only ever told about the player, however much else is around it.
+*/
+const Vector3 CHASE_RANGE	= Vector3(100, 1000, 50);
+const Vector3 CATCH_RANGE	= Vector3(20, 1000, 20);
+
 void TutorialGame::Chasing() {
 	enemyPosition = enemy->GetTransform().GetPosition();
 	playerPosition = player->GetTransform().GetPosition();
-	if (enemyPosition.x - playerPosition.x < 100 && enemyPosition.x - playerPosition.x >-100 && enemyPosition.z - playerPosition.z<50 && enemyPosition.z - playerPosition.z>-50) {
+
+	GameObject* found = nullptr;
+	if (world->OverlapAABB(enemyPosition, CHASE_RANGE, &found, 1, LayerBit(CollisionLayer::Character))) {
 
 		enemy->GetPhysicsObject()->AddForce(Vector3(playerPosition.x - enemyPosition.x, 0, playerPosition.z - enemyPosition.z));
-		if (enemyPosition.x - playerPosition.x < 20 && enemyPosition.x - playerPosition.x >-20 && enemyPosition.z - playerPosition.z<20 && enemyPosition.z - playerPosition.z>-20) {
+		if (world->OverlapAABB(enemyPosition, CATCH_RANGE, &found, 1, LayerBit(CollisionLayer::Character))) {
 			if (forceMagnitude > 100.0f || forceMagnitude < -100.0f) {
 				std::cout << "You destroyed the enemy!" << std::endl;
 				enemy->GetTransform().SetWorldPosition(enemyPosition);
@@ -62,6 +62,8 @@ namespace NCL {
 			GameObject* AddSlopeToWorld(const Vector3& position, const std::string& name = "");
 			GameObject* AddTargetFloorToWorld(const Vector3& position, const std::string& name = "");
 	
+			void InitCollisionResponses();
+
 			GameObject* AddBounce1(const Vector3& position);
 			GameObject* AddBounce2(const Vector3& position);
 			GameObject* AddBounce3(const Vector3& position);
@@ -80,8 +82,6 @@ namespace NCL {
 			void DrawPause();
 			int totalscore = 0;
 			//AI
-			StateGameObject* testStateObjectLeft;
-			StateGameObject* testStateObjectRight;
 
 			GameObject* player;
 			GameObject* enemy;
@@ -101,6 +101,10 @@ namespace NCL {
 			//void str2int(int& int_temp, const string& string_temp);
 
 
+			int bounceMaterials[4];
+			int bonusMaterial;
+			int winMaterial;
+
 			int hitcount = 0;
 			int readcount = 0;
 			//AI
@@ -131,6 +135,7 @@ namespace NCL {
 			GameTechRenderer*	renderer;
 			PhysicsSystem*		physics;
 			GameWorld*			world;
+			JobSystem*			jobSystem;
 
 			bool useGravity;
 			bool inSelectionMode;
@@ -0,0 +1,138 @@
+#include "../CSC8503Common/IntegrationKernels.h"
+#include "../CSC8503Common/Transform.h"
+#include "../../Common/GameTimer.h"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cstring>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+Steps a store full of bodies through the integration kernels with each
+instruction set this CPU supports, and checks that every one of them ends
+up with exactly the same bodies as the scalar version did.
+*/
+
+const float BENCHMARK_DT = 1.0f / 120.0f;
+
+//Every run starts from the same bodies - some static, some asleep, all spinning
+void FillBodies(RigidBodyStore& bodies, std::vector<Transform>& transforms) {
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> range(-10.0f, 10.0f);
+
+	for (Transform& t : transforms) {
+		t.SetPosition(Vector3(range(random), range(random), range(random)));
+		t.SetOrientation(Quaternion::EulerAnglesToQuaternion(range(random) * 18.0f, range(random) * 18.0f, range(random) * 18.0f));
+		int i = bodies.AddBody(&t);
+		i = bodies.GetIndex(i);
+
+		bodies.linearVelocities.Set(i, Vector3(range(random), range(random), range(random)));
+		bodies.angularVelocities.Set(i, Vector3(range(random), range(random), range(random)) * 0.1f);
+		bodies.forces.Set(i, Vector3(range(random), range(random), range(random)) * 5.0f);
+		bodies.inverseMasses[i] = (i % 8 == 0) ? 0.0f : 1.0f / (1.0f + (i % 5));
+		bodies.sleeping[i]		= (i % 7 == 0) ? 1 : 0;
+	}
+}
+
+void StepBodies(RigidBodyStore& bodies, int steps) {
+	IntegrationKernels::VelocityParams params;
+	params.dt				= BENCHMARK_DT;
+	params.linearDamping	= 1.0f - (0.4f * BENCHMARK_DT);
+	params.angularDamping	= 1.0f - (0.4f * BENCHMARK_DT);
+	params.linearSleepSq	= 0.3f * 0.3f;
+	params.angularSleepSq	= 0.3f * 0.3f;
+
+	Vector3 gravityStep = Vector3(0, -9.8f, 0) * BENCHMARK_DT;
+	int count = bodies.GetBodyCount();
+
+	for (int i = 0; i < steps; ++i) {
+		IntegrationKernels::IntegrateLinearAccel(bodies, 0, count, gravityStep, BENCHMARK_DT);
+		IntegrationKernels::IntegrateVelocity(bodies, 0, count, params);
+	}
+}
+
+bool SameFloats(const std::vector<float>& a, const std::vector<float>& b) {
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+bool SameBodies(const RigidBodyStore& a, const RigidBodyStore& b) {
+	return	SameFloats(a.positions.x, b.positions.x) &&
+			SameFloats(a.positions.y, b.positions.y) &&
+			SameFloats(a.positions.z, b.positions.z) &&
+			SameFloats(a.orientations.x, b.orientations.x) &&
+			SameFloats(a.orientations.y, b.orientations.y) &&
+			SameFloats(a.orientations.z, b.orientations.z) &&
+			SameFloats(a.orientations.w, b.orientations.w) &&
+			SameFloats(a.linearVelocities.x, b.linearVelocities.x) &&
+			SameFloats(a.linearVelocities.y, b.linearVelocities.y) &&
+			SameFloats(a.linearVelocities.z, b.linearVelocities.z) &&
+			SameFloats(a.angularVelocities.x, b.angularVelocities.x) &&
+			SameFloats(a.angularVelocities.y, b.angularVelocities.y) &&
+			SameFloats(a.angularVelocities.z, b.angularVelocities.z) &&
+			SameFloats(a.sleepTimes, b.sleepTimes);
+}
+
+int main() {
+	typedef IntegrationKernels::InstructionSet InstructionSet;
+
+	InstructionSet best = IntegrationKernels::DetectInstructionSet();
+	std::cout << "Best instruction set: " << IntegrationKernels::GetInstructionSetName(best) << "\n\n";
+
+	std::vector<InstructionSet> sets = { InstructionSet::Scalar };
+	if ((int)best >= (int)InstructionSet::SSE41) {
+		sets.emplace_back(InstructionSet::SSE41);
+	}
+	if ((int)best >= (int)InstructionSet::AVX2) {
+		sets.emplace_back(InstructionSet::AVX2);
+	}
+
+	int bodyCounts[] = { 1000, 10000, 100000 };
+	bool allMatched = true;
+
+	std::cout << std::setw(8) << "Bodies" << std::setw(10) << "Kernel" << std::setw(14) << "ms/step"
+		<< std::setw(14) << "ns/body" << std::setw(10) << "Speedup" << std::setw(10) << "Result" << "\n";
+
+	for (int bodyCount : bodyCounts) {
+		int steps = 10000000 / bodyCount; //roughly the same amount of work for each size
+
+		//The scalar run goes first, and is what the others have to match
+		RigidBodyStore scalarBodies;
+		std::vector<Transform> scalarTransforms(bodyCount);
+		double scalarTime = 0.0;
+
+		for (InstructionSet set : sets) {
+			RigidBodyStore otherBodies;
+			std::vector<Transform> otherTransforms(bodyCount);
+
+			bool isScalar = (set == InstructionSet::Scalar);
+			RigidBodyStore& bodies = isScalar ? scalarBodies : otherBodies;
+			FillBodies(bodies, isScalar ? scalarTransforms : otherTransforms);
+
+			IntegrationKernels::SetInstructionSet(set);
+
+			GameTimer timer;
+			StepBodies(bodies, steps);
+			timer.Tick();
+			double time = timer.GetTimeDeltaMSec();
+
+			if (isScalar) {
+				scalarTime = time;
+			}
+			bool matched = isScalar || SameBodies(bodies, scalarBodies);
+			allMatched &= matched;
+
+			std::cout << std::setw(8) << bodyCount
+				<< std::setw(10) << IntegrationKernels::GetInstructionSetName(set)
+				<< std::setw(14) << std::fixed << std::setprecision(4) << time / steps
+				<< std::setw(14) << std::setprecision(2) << (time * 1000000.0) / ((double)steps * bodyCount)
+				<< std::setw(9) << std::setprecision(2) << scalarTime / time << "x"
+				<< std::setw(10) << (matched ? "match" : "MISMATCH") << "\n";
+		}
+	}
+	IntegrationKernels::SetInstructionSet(best);
+
+	return allMatched ? 0 : 1;
+}
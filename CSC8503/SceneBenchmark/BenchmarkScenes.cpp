@@ -0,0 +1,150 @@
+#include "BenchmarkScenes.h"
+#include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/PhysicsObject.h"
+#include "../CSC8503Common/AABBVolume.h"
+#include "../CSC8503Common/SphereVolume.h"
+#include "../CSC8503Common/PositionConstraint.h"
+
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+using namespace BenchmarkScenes;
+
+/*
+The TutorialGame grids start 10 units up, but these start just above the
+floor instead, so they land in the first few frames, and the frames that
+are measured are spent dealing with contacts rather than free falling.
+*/
+const float GRID_SPACING	= 3.0f;
+const float GRID_HEIGHT		= 2.0f;
+const float FLOOR_BORDER	= 10.0f;
+
+//Each bridge is the BridgeConstraintTest one - two anchors, with links hanging between them
+const int	BRIDGE_LINKS		= 7;
+const int	BRIDGE_BODIES		= BRIDGE_LINKS + 2;
+const float	BRIDGE_SPACING		= 40.0f;
+
+const char* BenchmarkScenes::GetSceneName(SceneType type) {
+	switch (type) {
+		case SceneType::SphereGrid:	return "spheres";
+		case SceneType::CubeGrid:	return "cubes";
+		case SceneType::MixedGrid:	return "mixed";
+		case SceneType::Bridges:	return "bridges";
+	}
+	return "unknown";
+}
+
+bool BenchmarkScenes::GetSceneType(const std::string& name, SceneType& type) {
+	SceneType types[] = { SceneType::SphereGrid, SceneType::CubeGrid, SceneType::MixedGrid, SceneType::Bridges };
+	for (SceneType t : types) {
+		if (name == GetSceneName(t)) {
+			type = t;
+			return true;
+		}
+	}
+	return false;
+}
+
+GameObject* AddSphere(GameWorld& world, const Vector3& position, float radius, float inverseMass) {
+	GameObject* sphere = new GameObject();
+
+	SphereVolume* volume = new SphereVolume(radius);
+	sphere->SetBoundingVolume((CollisionVolume*)volume);
+
+	sphere->GetTransform()
+		.SetScale(Vector3(radius, radius, radius))
+		.SetPosition(position);
+
+	sphere->SetPhysicsObject(new PhysicsObject(&sphere->GetTransform(), sphere->GetBoundingVolume()));
+	sphere->GetPhysicsObject()->SetInverseMass(inverseMass);
+	sphere->GetPhysicsObject()->InitSphereInertia();
+
+	world.AddGameObject(sphere);
+	return sphere;
+}
+
+GameObject* AddCube(GameWorld& world, const Vector3& position, const Vector3& dimensions, float inverseMass) {
+	GameObject* cube = new GameObject();
+
+	AABBVolume* volume = new AABBVolume(dimensions);
+	cube->SetBoundingVolume((CollisionVolume*)volume);
+
+	cube->GetTransform()
+		.SetPosition(position)
+		.SetScale(dimensions * 2);
+
+	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
+	cube->GetPhysicsObject()->InitCubeInertia();
+
+	world.AddGameObject(cube);
+	return cube;
+}
+
+//A static slab under everything between min and max, with its top at y = 0
+void AddFloor(GameWorld& world, const Vector3& min, const Vector3& max) {
+	Vector3 centre		= (min + max) * 0.5f;
+	Vector3 halfSizes	= (max - min) * 0.5f + Vector3(FLOOR_BORDER, 0, FLOOR_BORDER);
+	halfSizes.y			= 0.5f;
+
+	AddCube(world, Vector3(centre.x, -0.5f, centre.z), halfSizes, 0.0f);
+}
+
+int AddGrid(GameWorld& world, SceneType type, int bodyCount) {
+	int columns = (int)std::ceil(std::sqrt((float)bodyCount));
+	int rows	= (bodyCount + columns - 1) / columns;
+
+	std::mt19937 random(1234);
+
+	for (int i = 0; i < bodyCount; ++i) {
+		Vector3 position = Vector3((i % columns) * GRID_SPACING, GRID_HEIGHT, (i / columns) * GRID_SPACING);
+
+		bool sphere = (type == SceneType::SphereGrid) || (type == SceneType::MixedGrid && (random() % 2) == 0);
+		if (sphere) {
+			AddSphere(world, position, 1.0f, (type == SceneType::MixedGrid) ? 10.0f : 1.0f);
+		}
+		else {
+			AddCube(world, position, Vector3(1, 1, 1), (type == SceneType::MixedGrid) ? 10.0f : 1.0f);
+		}
+	}
+	AddFloor(world, Vector3(0, 0, 0), Vector3((columns - 1) * GRID_SPACING, 0, (rows - 1) * GRID_SPACING));
+	return bodyCount;
+}
+
+int AddBridges(GameWorld& world, int bodyCount) {
+	int bridgeCount = std::max(1, bodyCount / BRIDGE_BODIES);
+	int columns		= (int)std::ceil(std::sqrt((float)bridgeCount));
+	int rows		= (bridgeCount + columns - 1) / columns;
+
+	Vector3 cubeSize		= Vector3(1, 1, 1);
+	float	invCubeMass		= 5;
+	float	maxDistance		= 4;
+	float	cubeDistance	= 3;
+
+	for (int i = 0; i < bridgeCount; ++i) {
+		Vector3 startPos = Vector3((i % columns) * BRIDGE_SPACING, 15, (i / columns) * BRIDGE_SPACING);
+
+		GameObject* start		= AddCube(world, startPos, cubeSize, 0);
+		GameObject* end			= AddCube(world, startPos + Vector3(0, 0, (BRIDGE_LINKS + 2) * cubeDistance), cubeSize, 0);
+		GameObject* previous	= start;
+
+		for (int j = 0; j < BRIDGE_LINKS; ++j) {
+			GameObject* block = AddCube(world, startPos + Vector3((j + 1) * cubeDistance, 0, 0), cubeSize, invCubeMass);
+			world.AddConstraint(new PositionConstraint(previous, block, maxDistance));
+			previous = block;
+		}
+		world.AddConstraint(new PositionConstraint(previous, end, maxDistance));
+	}
+	AddFloor(world, Vector3(0, 0, 0), Vector3(columns * BRIDGE_SPACING, 0, rows * BRIDGE_SPACING));
+	return bridgeCount * BRIDGE_BODIES;
+}
+
+int BenchmarkScenes::BuildScene(GameWorld& world, SceneType type, int bodyCount) {
+	if (type == SceneType::Bridges) {
+		return AddBridges(world, bodyCount);
+	}
+	return AddGrid(world, type, bodyCount);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "../CSC8503Common/GameWorld.h"
+#include <string>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Headless versions of the TutorialGame test scenes - the same shapes,
+		masses and spacings, but with no render objects, so they can be built
+		without a window. Each one is scaled up to roughly bodyCount bodies
+		by growing its grid, and sits on a floor big enough to catch it all.
+		Any randomness comes from a fixed seed, so every run gets the same scene.
+		*/
+		namespace BenchmarkScenes {
+			enum class SceneType {
+				SphereGrid,
+				CubeGrid,
+				MixedGrid,
+				Bridges
+			};
+
+			const char* GetSceneName(SceneType type);
+			bool GetSceneType(const std::string& name, SceneType& type);
+
+			//Returns how many bodies were actually added, not counting the floor
+			int BuildScene(GameWorld& world, SceneType type, int bodyCount);
+		}
+	}
+}
@@ -0,0 +1,443 @@
+#include "BenchmarkScenes.h"
+#include "../CSC8503Common/PhysicsSystem.h"
+#include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/IntegrationKernels.h"
+#include "../CSC8503Common/Profiler.h"
+#include "../CSC8503Common/PackedSnapshot.h"
+#include "../../Common/GameTimer.h"
+#include "../../Common/JobSystem.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+using namespace BenchmarkScenes;
+
+/*
+Builds each test scene at each size, steps it for a number of frames, and
+writes out how long each part of the physics took as JSON, so a change to
+the physics can be checked against the numbers from before it.
+
+Every frame is exactly one physics step, and the scenes are the same every
+run, so the only thing that should change the numbers is the code (and the
+machine). Run with --help to see the options.
+*/
+
+const int BENCHMARK_HZ = 120;
+
+struct BenchmarkOptions {
+	std::vector<SceneType>	scenes		= { SceneType::SphereGrid, SceneType::CubeGrid, SceneType::MixedGrid, SceneType::Bridges };
+	std::vector<int>		bodyCounts	= { 100, 1000, 10000, 100000 };
+	int						frames		= 300;
+	int						warmupFrames= 10;
+	int						threads		= 1;	//1 runs without a job system, 0 uses every core
+	bool					deterministic	= false;
+	int						rollbackFrames	= 0;
+	bool					packed			= false;
+	std::string				outputFile;
+	std::string				traceFile;
+};
+
+//Running totals for one measurement across every frame
+struct Measurement {
+	double	total	= 0.0;
+	double	max		= 0.0;
+	double	last	= 0.0;
+
+	void Add(double value) {
+		total	+= value;
+		max		= std::max(max, value);
+		last	= value;
+	}
+};
+
+struct SceneResult {
+	std::string	scene;
+	int			bodies			= 0;
+	int			constraints		= 0;
+	int			frames			= 0;
+	int			steps			= 0;
+	double		buildTime		= 0.0;
+	double		checksum		= 0.0;
+
+	Measurement frameTime;
+	Measurement integrateTime;
+	Measurement broadphaseTime;
+	Measurement narrowphaseTime;
+	Measurement solveTime;
+	Measurement collisionListTime;
+	Measurement snapshotTime;
+	Measurement rollbackTime;
+	Measurement packTime;
+	Measurement packDeltaTime;
+	Measurement unpackDeltaTime;
+
+	Measurement packedBytes;
+	Measurement packedDeltaBytes;
+
+	Measurement broadphasePairs;
+	Measurement contactPairs;
+	Measurement cachedPairs;
+	Measurement islands;
+};
+
+void PrintUsage() {
+	std::cerr << "Usage: SceneBenchmark [options]\n"
+		<< "  --scenes a,b,...    any of spheres, cubes, mixed, bridges (default: all of them)\n"
+		<< "  --bodies n,m,...    roughly how many bodies to build each scene with (default: 100,1000,10000,100000)\n"
+		<< "  --frames n          frames to measure (default: 300)\n"
+		<< "  --warmup n          frames to step before measuring (default: 10)\n"
+		<< "  --threads n         1 runs single threaded, 0 uses every core (default: 1)\n"
+		<< "  --out file          write the JSON here instead of to stdout\n"
+		<< "  --trace file        profile every frame, and save the last of them as a Chrome trace\n"
+		<< "  --deterministic     run the physics in deterministic mode\n"
+		<< "  --rollback n        deterministic, and every frame rolls back n frames and steps them again\n"
+		<< "  --packed            pack the world into a snapshot every frame, and a delta from the frame before\n";
+}
+
+std::vector<std::string> SplitList(const std::string& list) {
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.emplace_back(item);
+		}
+	}
+	return items;
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--deterministic") {
+			options.deterministic = true;
+			continue;
+		}
+		if (arg == "--packed") {
+			options.packed = true;
+			continue;
+		}
+		if (arg == "--help" || i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (arg == "--scenes") {
+			options.scenes.clear();
+			for (const std::string& name : SplitList(value)) {
+				SceneType type;
+				if (!GetSceneType(name, type)) {
+					std::cerr << "Unknown scene " << name << "\n";
+					return false;
+				}
+				options.scenes.emplace_back(type);
+			}
+		}
+		else if (arg == "--bodies") {
+			options.bodyCounts.clear();
+			for (const std::string& count : SplitList(value)) {
+				options.bodyCounts.emplace_back(std::max(1, atoi(count.c_str())));
+			}
+		}
+		else if (arg == "--frames") {
+			options.frames = std::max(1, atoi(value.c_str()));
+		}
+		else if (arg == "--warmup") {
+			options.warmupFrames = std::max(0, atoi(value.c_str()));
+		}
+		else if (arg == "--threads") {
+			options.threads = std::max(0, atoi(value.c_str()));
+		}
+		else if (arg == "--out") {
+			options.outputFile = value;
+		}
+		else if (arg == "--trace") {
+			options.traceFile = value;
+		}
+		else if (arg == "--rollback") {
+			options.rollbackFrames = std::max(0, atoi(value.c_str()));
+			options.deterministic = options.deterministic || options.rollbackFrames > 0;
+		}
+		else {
+			std::cerr << "Unknown option " << arg << "\n";
+			return false;
+		}
+	}
+	return !options.scenes.empty() && !options.bodyCounts.empty();
+}
+
+//Adds up every object's position, so runs that simulated something different can be spotted
+double PositionChecksum(GameWorld& world) {
+	double checksum = 0.0;
+
+	GameObjectIterator first;
+	GameObjectIterator last;
+	world.GetObjectIterators(first, last);
+	for (auto i = first; i != last; ++i) {
+		Vector3 p = (*i)->GetTransform().GetPosition();
+		checksum += (double)p.x + (double)p.y + (double)p.z;
+	}
+	return checksum;
+}
+
+SceneResult RunScene(SceneType type, int bodyCount, const BenchmarkOptions& options, JobSystem* jobs) {
+	SceneResult result;
+	result.scene = GetSceneName(type);
+
+	GameWorld		world;
+	PhysicsSystem	physics(world);
+	physics.UseGravity(true);
+	physics.SetFixedTimestep(BENCHMARK_HZ);
+	physics.UseDeterministicMode(options.deterministic);
+	world.SetJobSystem(jobs);
+	physics.SetJobSystem(jobs);
+
+	GameTimer timer;
+	result.bodies = BuildScene(world, type, bodyCount);
+	timer.Tick();
+	result.buildTime = timer.GetTimeDeltaMSec();
+
+	std::vector<Constraint*>::const_iterator firstConstraint;
+	std::vector<Constraint*>::const_iterator lastConstraint;
+	world.GetConstraintIterators(firstConstraint, lastConstraint);
+	result.constraints = (int)(lastConstraint - firstConstraint);
+
+	//Passing exactly the timestep in means every frame runs exactly one step
+	float dt = physics.GetTimestep();
+
+	/*
+	Rolling back keeps a snapshot of each of the last few frames, like a
+	rollback netcode would. As nothing's changed the inputs, stepping the
+	frames again has to end up in exactly the same place, so the checksum
+	should match a run without rolling back.
+	*/
+	std::vector<PhysicsSnapshot> snapshots(options.rollbackFrames + 1);
+
+	/*
+	Packing writes the whole world each frame, then again as a delta from
+	the frame before's, and reads the delta back, as a server sending the
+	world to a client would.
+	*/
+	PackedSnapshotWriter	packer;
+	std::vector<uint8_t>	packedFrames[2];
+	std::vector<uint8_t>	packedDelta;
+
+	for (int frame = 0; frame < options.warmupFrames + options.frames; ++frame) {
+		Profiler::NextFrame();
+		timer.Tick();
+		world.UpdateWorld(dt);
+		physics.Update(dt);
+		timer.Tick();
+		PhysicsStats stats = physics.GetStats();
+		float frameTime = timer.GetTimeDeltaMSec();
+
+		float snapshotTime = 0.0f;
+		float rollbackTime = 0.0f;
+		if (options.rollbackFrames > 0) {
+			physics.SaveSnapshot(snapshots[frame % snapshots.size()]);
+			timer.Tick();
+			snapshotTime = timer.GetTimeDeltaMSec();
+
+			if (frame >= options.rollbackFrames) {
+				if (!physics.RestoreSnapshot(snapshots[(frame - options.rollbackFrames) % snapshots.size()])) {
+					std::cerr << "Couldn't restore a snapshot!\n";
+				}
+				for (int i = 0; i < options.rollbackFrames; ++i) {
+					world.UpdateWorld(dt);
+					physics.Step();
+				}
+				timer.Tick();
+				rollbackTime = timer.GetTimeDeltaMSec();
+			}
+		}
+
+		float packTime			= 0.0f;
+		float packDeltaTime		= 0.0f;
+		float unpackDeltaTime	= 0.0f;
+		size_t deltaBytes		= 0;
+		std::vector<uint8_t>& current	= packedFrames[frame & 1];
+		std::vector<uint8_t>& previous	= packedFrames[(frame + 1) & 1];
+		if (options.packed) {
+			timer.Tick();
+			packer.WriteWorld(current, world, frame);
+			timer.Tick();
+			packTime = timer.GetTimeDeltaMSec();
+
+			if (frame > 0) {
+				PackedSnapshotReader writeBaseline(previous.data(), previous.size());
+				deltaBytes = packer.WriteWorld(packedDelta, world, frame, &writeBaseline);
+				timer.Tick();
+				packDeltaTime = timer.GetTimeDeltaMSec();
+
+				PackedSnapshotReader readBaseline(previous.data(), previous.size());
+				PackedSnapshotReader reader(packedDelta.data(), packedDelta.size(), &readBaseline);
+				PackedObjectState state;
+				int unpacked = 0;
+				while (reader.Next(state)) {
+					unpacked++;
+				}
+				timer.Tick();
+				unpackDeltaTime = timer.GetTimeDeltaMSec();
+				if (!reader.IsValid() || unpacked != reader.GetObjectCount()) {
+					std::cerr << "Couldn't read back a packed snapshot!\n";
+				}
+			}
+		}
+
+		if (frame < options.warmupFrames) {
+			continue;
+		}
+		result.frames++;
+		result.steps += stats.steps;
+
+		result.frameTime.Add(frameTime);
+		result.integrateTime.Add(stats.integrateTime);
+		result.broadphaseTime.Add(stats.broadphaseTime);
+		result.narrowphaseTime.Add(stats.narrowphaseTime);
+		result.solveTime.Add(stats.solveTime);
+		result.collisionListTime.Add(stats.collisionListTime);
+		result.snapshotTime.Add(snapshotTime);
+		result.rollbackTime.Add(rollbackTime);
+		if (options.packed) {
+			result.packTime.Add(packTime);
+			result.packDeltaTime.Add(packDeltaTime);
+			result.unpackDeltaTime.Add(unpackDeltaTime);
+			result.packedBytes.Add((double)current.size());
+			result.packedDeltaBytes.Add((double)deltaBytes);
+		}
+
+		result.broadphasePairs.Add(stats.broadphasePairs);
+		result.contactPairs.Add(stats.contactPairs);
+		result.cachedPairs.Add(stats.cachedPairs);
+		result.islands.Add(stats.islands);
+	}
+	result.checksum = PositionChecksum(world);
+
+	world.ClearAndErase();
+	physics.Clear();
+	return result;
+}
+
+void WriteTime(std::ostream& out, const char* name, const Measurement& m, int frames, bool last = false) {
+	out << "\t\t\t\t\"" << name << "\": { \"totalMs\": " << m.total
+		<< ", \"meanMs\": " << m.total / frames
+		<< ", \"maxMs\": " << m.max << " }" << (last ? "\n" : ",\n");
+}
+
+void WriteCount(std::ostream& out, const char* name, const Measurement& m, int frames, bool last = false) {
+	out << "\t\t\t\t\"" << name << "\": { \"mean\": " << m.total / frames
+		<< ", \"max\": " << m.max
+		<< ", \"final\": " << m.last << " }" << (last ? "\n" : ",\n");
+}
+
+void WriteJSON(std::ostream& out, const BenchmarkOptions& options, int threadCount, const std::vector<SceneResult>& results) {
+	out << std::fixed << std::setprecision(4);
+	out << "{\n";
+	out << "\t\"frames\": " << options.frames << ",\n";
+	out << "\t\"warmupFrames\": " << options.warmupFrames << ",\n";
+	out << "\t\"threads\": " << threadCount << ",\n";
+	out << "\t\"deterministic\": " << (options.deterministic ? "true" : "false") << ",\n";
+	out << "\t\"rollbackFrames\": " << options.rollbackFrames << ",\n";
+	out << "\t\"packed\": " << (options.packed ? "true" : "false") << ",\n";
+	out << "\t\"timestepHz\": " << BENCHMARK_HZ << ",\n";
+	out << "\t\"instructionSet\": \"" << IntegrationKernels::GetInstructionSetName(IntegrationKernels::GetInstructionSet()) << "\",\n";
+	out << "\t\"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const SceneResult& r = results[i];
+		int frames = std::max(1, r.frames);
+
+		out << "\t\t{\n";
+		out << "\t\t\t\"scene\": \"" << r.scene << "\",\n";
+		out << "\t\t\t\"bodies\": " << r.bodies << ",\n";
+		out << "\t\t\t\"constraints\": " << r.constraints << ",\n";
+		out << "\t\t\t\"frames\": " << r.frames << ",\n";
+		out << "\t\t\t\"steps\": " << r.steps << ",\n";
+		out << "\t\t\t\"buildMs\": " << r.buildTime << ",\n";
+		out << "\t\t\t\"totalMs\": " << r.frameTime.total << ",\n";
+		out << "\t\t\t\"meanFrameMs\": " << r.frameTime.total / frames << ",\n";
+		out << "\t\t\t\"maxFrameMs\": " << r.frameTime.max << ",\n";
+		out << "\t\t\t\"checksum\": " << r.checksum << ",\n";
+
+		out << "\t\t\t\"phases\": {\n";
+		WriteTime(out, "integrate",		r.integrateTime,		frames);
+		WriteTime(out, "broadphase",	r.broadphaseTime,		frames);
+		WriteTime(out, "narrowphase",	r.narrowphaseTime,		frames);
+		WriteTime(out, "solve",			r.solveTime,			frames);
+		WriteTime(out, "collisionList",	r.collisionListTime,	frames);
+		WriteTime(out, "snapshot",		r.snapshotTime,			frames);
+		WriteTime(out, "rollback",		r.rollbackTime,			frames);
+		WriteTime(out, "pack",			r.packTime,				frames);
+		WriteTime(out, "packDelta",		r.packDeltaTime,		frames);
+		WriteTime(out, "unpackDelta",	r.unpackDeltaTime,		frames, true);
+		out << "\t\t\t},\n";
+
+		out << "\t\t\t\"pairs\": {\n";
+		WriteCount(out, "broadphase",	r.broadphasePairs,	frames);
+		WriteCount(out, "contacts",		r.contactPairs,		frames);
+		WriteCount(out, "cached",		r.cachedPairs,		frames);
+		WriteCount(out, "islands",		r.islands,			frames, true);
+		out << "\t\t\t},\n";
+
+		out << "\t\t\t\"packedBytes\": {\n";
+		WriteCount(out, "full",			r.packedBytes,		frames);
+		WriteCount(out, "delta",		r.packedDeltaBytes,	frames, true);
+		out << "\t\t\t}\n";
+
+		out << "\t\t}" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "\t]\n";
+	out << "}\n";
+}
+
+int main(int argc, char** argv) {
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	JobSystem* jobs = (options.threads == 1) ? nullptr : new JobSystem(options.threads);
+	int threadCount = jobs ? jobs->GetThreadCount() : 1;
+
+	Profiler::SetEnabled(!options.traceFile.empty());
+
+	std::vector<SceneResult> results;
+	for (SceneType type : options.scenes) {
+		for (int bodyCount : options.bodyCounts) {
+			std::cerr << GetSceneName(type) << " x " << bodyCount << "..." << std::flush;
+
+			results.emplace_back(RunScene(type, bodyCount, options, jobs));
+
+			std::cerr << " " << std::fixed << std::setprecision(3)
+				<< results.back().frameTime.total / std::max(1, results.back().frames) << "ms per frame\n";
+		}
+	}
+	delete jobs;
+
+	if (!options.traceFile.empty() && !Profiler::ExportChromeTrace(options.traceFile)) {
+		std::cerr << "Couldn't write to " << options.traceFile << "\n";
+		return 1;
+	}
+
+	if (options.outputFile.empty()) {
+		WriteJSON(std::cout, options, threadCount, results);
+	}
+	else {
+		std::ofstream file(options.outputFile);
+		if (!file) {
+			std::cerr << "Couldn't write to " << options.outputFile << "\n";
+			return 1;
+		}
+		WriteJSON(file, options, threadCount, results);
+	}
+	return 0;
+}
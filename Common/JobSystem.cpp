@@ -0,0 +1,142 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+using namespace NCL;
+
+JobSystem::JobSystem(int numThreads) {
+	if (numThreads <= 0) {
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	jobFunc			= nullptr;
+	jobCount		= 0;
+	jobChunkSize	= 1;
+	jobGeneration	= 0;
+	busyWorkers		= 0;
+	shuttingDown	= false;
+	jobRunning		= false;
+
+	chunkRanges.reset(new std::atomic<uint64_t>[numThreads]);
+	for (int i = 0; i < numThreads; ++i) {
+		chunkRanges[i] = 0;
+	}
+
+	for (int i = 1; i < numThreads; ++i) {
+		workers.emplace_back(&JobSystem::WorkerThread, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		shuttingDown = true;
+	}
+	jobStarted.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+}
+
+void JobSystem::ParallelFor(int count, int chunkSize, const RangeFunc& func) {
+	if (count <= 0) {
+		return;
+	}
+	chunkSize = std::max(1, chunkSize);
+	jobRunning = true;
+	if (workers.empty() || count <= chunkSize) { //not worth waking anyone up
+		func(0, count, 0);
+		jobRunning = false;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobFunc			= &func;
+		jobCount		= count;
+		jobChunkSize	= chunkSize;
+		busyWorkers		= (int)workers.size();
+		jobGeneration++;
+
+		int threadCount	= GetThreadCount();
+		int chunkCount	= (count + chunkSize - 1) / chunkSize;
+		for (int i = 0; i < threadCount; ++i) {
+			chunkRanges[i] = PackRange(chunkCount * i / threadCount, chunkCount * (i + 1) / threadCount);
+		}
+	}
+	jobStarted.notify_all();
+
+	RunChunks(0);
+
+	std::unique_lock<std::mutex> lock(jobMutex);
+	jobFinished.wait(lock, [&] { return busyWorkers == 0; });
+	jobFunc		= nullptr;
+	jobRunning	= false;
+}
+
+void JobSystem::RunChunks(int threadIndex) {
+	while (true) {
+		int chunk = PopChunk(threadIndex);
+		if (chunk < 0) {
+			chunk = StealChunk(threadIndex);
+		}
+		if (chunk < 0) { //every thread's run is empty - runs never grow during a job, so we're done
+			return;
+		}
+		int start = chunk * jobChunkSize;
+		(*jobFunc)(start, std::min(start + jobChunkSize, jobCount), threadIndex);
+	}
+}
+
+//Takes the next chunk from the front of the thread's own run, or -1 if it's empty
+int JobSystem::PopChunk(int threadIndex) {
+	std::atomic<uint64_t>& range = chunkRanges[threadIndex];
+	uint64_t current = range.load();
+	while (true) {
+		uint32_t next	= (uint32_t)current;
+		uint32_t end	= (uint32_t)(current >> 32);
+		if (next >= end) {
+			return -1;
+		}
+		if (range.compare_exchange_weak(current, PackRange(next + 1, end))) {
+			return (int)next;
+		}
+	}
+}
+
+//Takes a chunk from the back of the first other thread's run that has any left, or -1 if none do
+int JobSystem::StealChunk(int threadIndex) {
+	int threadCount = GetThreadCount();
+	for (int i = 1; i < threadCount; ++i) {
+		std::atomic<uint64_t>& range = chunkRanges[(threadIndex + i) % threadCount];
+		uint64_t current = range.load();
+		while (true) {
+			uint32_t next	= (uint32_t)current;
+			uint32_t end	= (uint32_t)(current >> 32);
+			if (next >= end) {
+				break;
+			}
+			if (range.compare_exchange_weak(current, PackRange(next, end - 1))) {
+				return (int)end - 1;
+			}
+		}
+	}
+	return -1;
+}
+
+void JobSystem::WorkerThread(int threadIndex) {
+	int lastGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobStarted.wait(lock, [&] { return shuttingDown || jobGeneration != lastGeneration; });
+			if (shuttingDown) {
+				return;
+			}
+			lastGeneration = jobGeneration;
+		}
+		RunChunks(threadIndex);
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			busyWorkers--;
+		}
+		jobFinished.notify_one();
+	}
+}
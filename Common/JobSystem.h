@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+namespace NCL {
+	/*
+	A small pool of worker threads, that can split a loop up into chunks
+	and run them in parallel. The thread that calls ParallelFor works on
+	chunks too, and doesn't return until every chunk has been run, so the
+	function passed in can safely reference local variables.
+
+	Each thread starts off with its own run of neighbouring chunks, so it
+	mostly works through memory that's next to what it just did, without
+	fighting the other threads over a shared counter. A thread that runs
+	out steals chunks from the far end of another thread's run, so a few
+	slow chunks (an object doing a long path search, say) don't leave the
+	rest of the threads idle.
+
+	Each call is given the index of the thread running it (0 is always the
+	calling thread), so that results can be written into per-thread buffers
+	without any locking. Only one ParallelFor can be running at a time, so
+	code that might be run from inside a job can check IsRunningJob, and
+	do its work serially instead.
+	*/
+	class JobSystem {
+	public:
+		typedef std::function<void(int start, int end, int threadIndex)> RangeFunc;
+
+		JobSystem(int numThreads = 0); //0 uses one thread per hardware core
+		~JobSystem();
+
+		int GetThreadCount() const {
+			return (int)workers.size() + 1;
+		}
+
+		void ParallelFor(int count, int chunkSize, const RangeFunc& func);
+
+		bool IsRunningJob() const {
+			return jobRunning;
+		}
+
+	protected:
+		void WorkerThread(int threadIndex);
+		void RunChunks(int threadIndex);
+		int PopChunk(int threadIndex);
+		int StealChunk(int threadIndex);
+
+		//A thread's run of chunks - the next one to take from the front in the low half, the end in the high half
+		static uint64_t PackRange(uint32_t next, uint32_t end) {
+			return ((uint64_t)end << 32) | next;
+		}
+
+		std::vector<std::thread>	workers;
+		std::mutex					jobMutex;
+		std::condition_variable		jobStarted;
+		std::condition_variable		jobFinished;
+
+		const RangeFunc*	jobFunc;
+		int					jobCount;
+		int					jobChunkSize;
+		int					jobGeneration;
+		int					busyWorkers;
+		bool				shuttingDown;
+		std::atomic<bool>	jobRunning;
+
+		std::unique_ptr<std::atomic<uint64_t>[]> chunkRanges; //one per thread
+	};
+}
@@ -1,5 +1,6 @@
 #include "Mouse.h"
 #include <string>
+#include <cstring>
 
 using namespace NCL;
 